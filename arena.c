@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <arena.h>
+
+
+struct ArenaBlock {
+    ArenaBlock*     next;
+    char*           ptr;        /* Next free byte. */
+    char*           end;
+    char            data[];
+};
+
+
+static inline char* __align(char* p)
+{
+    uintptr_t v = (uintptr_t)p;
+    v = (v + (ARENA_ALIGNMENT - 1)) & ~(uintptr_t)(ARENA_ALIGNMENT - 1);
+    return (char*)v;
+}
+
+static ArenaBlock* __new_block(Arena* arena, size_t size)
+{
+    size_t block_size = sizeof(ArenaBlock) + size + ARENA_ALIGNMENT;
+    ArenaBlock* block = malloc(block_size);
+    if (block == NULL) return NULL;
+    block->next = NULL;
+    block->ptr = __align(block->data);
+    block->end = block->data + size + ARENA_ALIGNMENT;
+    arena->reserved += block_size;
+    return block;
+}
+
+
+Arena* arena_create(size_t block_size)
+{
+    Arena* arena = calloc(1, sizeof(Arena));
+    if (arena == NULL) return NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->next_size = ARENA_INITIAL_BLOCK_SIZE;
+    if (arena->next_size > arena->block_size) {
+        arena->next_size = arena->block_size;
+    }
+    arena->block = __new_block(arena, arena->next_size);
+    if (arena->block == NULL) {
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+void arena_destroy(Arena* arena)
+{
+    if (arena == NULL) return;
+    ArenaBlock* block = arena->block;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+    if (size == 0) size = 1;
+    ArenaBlock* block = arena->block;
+    char* p = __align(block->ptr);
+    if (p + size <= block->end) {
+        block->ptr = p + size;
+        arena->used += size;
+        return p;
+    }
+
+    if (size > arena->block_size / 4 || size > arena->next_size) {
+        /* Large allocation, give it a dedicated block and keep bumping
+        from the current block. */
+        ArenaBlock* large = __new_block(arena, size);
+        if (large == NULL) return NULL;
+        large->next = block->next;
+        block->next = large;
+        p = large->ptr;
+        large->ptr = p + size;
+        arena->used += size;
+        return p;
+    }
+
+    if (arena->next_size < arena->block_size) {
+        arena->next_size *= 2;
+        if (arena->next_size > arena->block_size) {
+            arena->next_size = arena->block_size;
+        }
+    }
+    block = __new_block(arena, arena->next_size);
+    if (block == NULL) return NULL;
+    block->next = arena->block;
+    arena->block = block;
+    p = block->ptr;
+    block->ptr = p + size;
+    arena->used += size;
+    return p;
+}
+
+void* arena_calloc(Arena* arena, size_t count, size_t size)
+{
+    void* p = arena_alloc(arena, count * size);
+    if (p) memset(p, 0, count * size);
+    return p;
+}
+
+void* arena_realloc(Arena* arena, void* ptr, size_t old_size, size_t new_size)
+{
+    if (ptr == NULL) return arena_alloc(arena, new_size);
+    if (new_size <= old_size) return ptr;
+
+    ArenaBlock* block = arena->block;
+    if ((char*)ptr + old_size == block->ptr
+            && (char*)ptr + new_size <= block->end) {
+        /* Most recent allocation, extend in place. */
+        block->ptr = (char*)ptr + new_size;
+        arena->used += new_size - old_size;
+        return ptr;
+    }
+    void* p = arena_alloc(arena, new_size);
+    if (p) memcpy(p, ptr, old_size);
+    return p;
+}
+
+char* arena_strndup(Arena* arena, const char* s, size_t length)
+{
+    char* p = arena_alloc(arena, length + 1);
+    if (p == NULL) return NULL;
+    memcpy(p, s, length);
+    p[length] = '\0';
+    return p;
+}
+
+char* arena_strdup(Arena* arena, const char* s)
+{
+    return arena_strndup(arena, s, strlen(s));
+}
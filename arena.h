@@ -0,0 +1,46 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define ARENA_INITIAL_BLOCK_SIZE    (4*1024)
+#define ARENA_DEFAULT_BLOCK_SIZE    (64*1024)
+#define ARENA_ALIGNMENT             16
+
+
+typedef struct ArenaBlock ArenaBlock;
+
+/* Bump allocator. Memory is handed out from a list of blocks and is only
+released, all at once, by arena_destroy(). Block sizes start small and
+double up to block_size, so small documents stay small. */
+typedef struct Arena {
+    ArenaBlock*     block;      /* Current block, head of the block list. */
+    size_t          block_size; /* Maximum block size. */
+    size_t          next_size;
+    size_t          used;       /* Bytes handed out. */
+    size_t          reserved;   /* Bytes obtained from malloc. */
+} Arena;
+
+
+Arena* arena_create(size_t block_size);
+void arena_destroy(Arena* arena);
+
+void* arena_alloc(Arena* arena, size_t size);
+void* arena_calloc(Arena* arena, size_t count, size_t size);
+/* Grows the most recent allocation in place when possible, otherwise a new
+region is allocated and the old content copied (the old region is not
+reclaimed until the arena is destroyed). */
+void* arena_realloc(Arena* arena, void* ptr, size_t old_size, size_t new_size);
+char* arena_strdup(Arena* arena, const char* s);
+char* arena_strndup(Arena* arena, const char* s, size_t length);
+
+
+#endif /* ARENA_H */
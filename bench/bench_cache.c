@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Startup with a cache file, compared with parsing.
+
+    bench_cache [-s size_mb] [-r repeat] [-d dir]
+
+A multi-document corpus is generated into a file (in dir, default /tmp).
+Reported are the times to parse the file, to open it through a cache which
+is rebuilt (parse, freeze and write), and through a cache which is fresh
+(mapped and validated), each followed by one path lookup. */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <simple_yaml.h>
+
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __generate(FILE* f, size_t size)
+{
+    for (uint32_t d = 0; (size_t)ftell(f) < size; d++) {
+        fprintf(f,
+            "---\n"
+            "apiVersion: v1\n"
+            "kind: Service\n"
+            "metadata:\n"
+            "  name: service-%u\n"
+            "  labels:\n"
+            "    app: app-%u\n"
+            "spec:\n"
+            "  ports:\n"
+            "    - protocol: TCP\n"
+            "      port: %u\n",
+            d, d % 97, 8000 + d % 1000);
+    }
+}
+
+static void __destroy(HashList* doc_list)
+{
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+    }
+    hashlist_destroy(doc_list);
+    free(doc_list);
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t size = 32;
+    uint32_t repeat = 3;
+    const char* dir = "/tmp";
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:d:")) != -1) {
+        switch (opt) {
+            case 's': size = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            case 'd': dir = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-s size_mb] [-r repeat] [-d dir]\n",
+                        argv[0]);
+                exit(1);
+        }
+    }
+    if (size == 0 || repeat == 0) exit(1);
+
+    char filename[4096], cache_filename[4096 + 8];
+    snprintf(filename, sizeof(filename), "%s/bench_cache_%d.yaml", dir, getpid());
+    snprintf(cache_filename, sizeof(cache_filename), "%s.cache", filename);
+    FILE* f = fopen(filename, "w");
+    if (f == NULL) {
+        perror("Error opening file");
+        exit(1);
+    }
+    __generate(f, size * 1000000);
+    size_t length = ftell(f);
+    fclose(f);
+
+    double parse = 0, rebuild = 0, open = 0;
+    uint32_t documents = 0;
+    for (uint32_t r = 0; r < repeat; r++) {
+        double start = __now();
+        HashList* doc_list = simple_yaml_parse_file(filename, NULL);
+        if (doc_list == NULL) exit(1);
+        SimpleYamlNode* doc = hashlist_get_at(doc_list, 0);
+        if (simple_yaml_find_node(doc, "spec/ports/0/port") == NULL) exit(1);
+        double elapsed = __now() - start;
+        if (r == 0 || elapsed < parse) parse = elapsed;
+        documents = hashlist_length(doc_list);
+        __destroy(doc_list);
+    }
+
+    size_t cache_size = 0;
+    for (uint32_t r = 0; r < repeat; r++) {
+        unlink(cache_filename);
+        SimpleYamlCache cache;
+        double start = __now();
+        if (simple_yaml_cache_open(&cache, filename, cache_filename, NULL)) exit(1);
+        SimpleYamlTapeRef doc = simple_yaml_tape_document(cache.tape, 0);
+        if (!simple_yaml_tape_find(cache.tape, doc, "spec/ports/0/port")) exit(1);
+        double elapsed = __now() - start;
+        if (!cache.rebuilt) exit(1);
+        if (r == 0 || elapsed < rebuild) rebuild = elapsed;
+        cache_size = simple_yaml_tape_size(cache.tape);
+        simple_yaml_cache_close(&cache);
+    }
+
+    for (uint32_t r = 0; r < repeat; r++) {
+        SimpleYamlCache cache;
+        double start = __now();
+        if (simple_yaml_cache_open(&cache, filename, cache_filename, NULL)) exit(1);
+        SimpleYamlTapeRef doc = simple_yaml_tape_document(cache.tape, 0);
+        if (!simple_yaml_tape_find(cache.tape, doc, "spec/ports/0/port")) exit(1);
+        double elapsed = __now() - start;
+        if (cache.rebuilt) exit(1);
+        if (r == 0 || elapsed < open) open = elapsed;
+        simple_yaml_cache_close(&cache);
+    }
+    unlink(cache_filename);
+    unlink(filename);
+
+    printf("source %.1f MB, %u documents, cache %.1f MB\n",
+            length / 1e6, documents, cache_size / 1e6);
+    printf("%-10s %10s\n", "", "ms");
+    printf("%-10s %10.1f\n", "parse", parse * 1e3);
+    printf("%-10s %10.1f\n", "rebuild", rebuild * 1e3);
+    printf("%-10s %10.1f\n", "cached", open * 1e3);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Emitter throughput, compared with parsing the same documents.
+
+    bench_emit [-s size_mb] [-r repeat] [file ...]
+
+Synthetic corpora (multi-document, wide and block scalar) are generated in
+memory, or the files given are used. Each corpus is parsed, then emitted into
+a buffer (reused between repeats) and to /dev/null. Throughput is reported
+in MB/s of the source, the best of the repeats. */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <simple_yaml.h>
+
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __generate_documents(FILE* f, size_t size)
+{
+    for (uint32_t d = 0; (size_t)ftell(f) < size; d++) {
+        fprintf(f,
+            "---\n"
+            "apiVersion: v1\n"
+            "kind: Service\n"
+            "metadata:\n"
+            "  name: service-%u\n"
+            "  labels:\n"
+            "    app: \"app-%u\"\n"
+            "spec:\n"
+            "  selector:\n"
+            "    app: app-%u\n"
+            "  ports:\n"
+            "    - protocol: TCP\n"
+            "      port: %u\n"
+            "      targetPort: %u\n",
+            d, d % 97, d % 97, 8000 + d % 1000, 9000 + d % 1000);
+    }
+}
+
+static void __generate_wide(FILE* f, size_t size)
+{
+    for (uint32_t k = 0; (size_t)ftell(f) < size; k++) {
+        fprintf(f, "key_%08u: value of key %u\n", k, k);
+    }
+}
+
+static void __generate_block(FILE* f, size_t size)
+{
+    for (uint32_t k = 0; (size_t)ftell(f) < size; k++) {
+        fprintf(f, "block_%u: |\n", k);
+        for (uint32_t l = 0; l < 64; l++) {
+            fprintf(f, "  line %02u of a literal block scalar, which is "
+                    "copied into a single value\n", l);
+        }
+    }
+}
+
+typedef struct Corpus {
+    const char* name;
+    void        (*generate)(FILE* f, size_t size);
+} Corpus;
+
+static const Corpus corpora[] = {
+    { "documents", __generate_documents },
+    { "wide", __generate_wide },
+    { "block", __generate_block },
+};
+#define BENCH_CORPORA   (sizeof(corpora) / sizeof(corpora[0]))
+
+
+static void __destroy(HashList* doc_list)
+{
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+    }
+    hashlist_destroy(doc_list);
+    free(doc_list);
+}
+
+static void __bench(const char* name, const char* data, size_t length,
+        uint32_t repeat)
+{
+    double parse = 0, emit = 0, emit_fd = 0;
+    HashList* doc_list = NULL;
+    for (uint32_t r = 0; r < repeat; r++) {
+        if (doc_list) __destroy(doc_list);
+        double start = __now();
+        doc_list = simple_yaml_parse_buffer(data, length, NULL, NULL);
+        double elapsed = __now() - start;
+        if (doc_list == NULL) exit(1);
+        if (r == 0 || elapsed < parse) parse = elapsed;
+    }
+
+    SimpleYamlBuffer buffer = { 0 };
+    for (uint32_t r = 0; r < repeat; r++) {
+        buffer.length = 0;
+        double start = __now();
+        if (simple_yaml_emit_documents_buffer(doc_list, &buffer)) exit(1);
+        double elapsed = __now() - start;
+        if (r == 0 || elapsed < emit) emit = elapsed;
+    }
+
+    int fd = open("/dev/null", O_WRONLY);
+    for (uint32_t r = 0; fd >= 0 && r < repeat; r++) {
+        double start = __now();
+        if (simple_yaml_emit_documents_fd(doc_list, fd)) exit(1);
+        double elapsed = __now() - start;
+        if (r == 0 || elapsed < emit_fd) emit_fd = elapsed;
+    }
+    if (fd >= 0) close(fd);
+
+    double mb = length / 1e6;
+    printf("%-12s %8.1f %8.1f %10.1f %10.1f %10.1f\n", name, mb,
+            buffer.length / 1e6, mb / parse, mb / emit, mb / emit_fd);
+    simple_yaml_buffer_release(&buffer);
+    __destroy(doc_list);
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t size = 8;
+    uint32_t repeat = 3;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:")) != -1) {
+        switch (opt) {
+            case 's': size = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-s size_mb] [-r repeat] "
+                        "[file ...]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (size == 0 || repeat == 0) exit(1);
+
+    printf("%-12s %8s %8s %10s %10s %10s\n", "corpus", "MB", "MB out",
+            "parse MB/s", "emit MB/s", "fd MB/s");
+    if (optind < argc) {
+        for (int i = optind; i < argc; i++) {
+            FILE* f = fopen(argv[i], "r");
+            if (f == NULL) {
+                perror("Error opening file");
+                exit(1);
+            }
+            fseek(f, 0, SEEK_END);
+            size_t length = ftell(f);
+            rewind(f);
+            char* data = malloc(length + 1);
+            if (data == NULL || fread(data, 1, length, f) != length) exit(1);
+            fclose(f);
+            __bench(argv[i], data, length, repeat);
+            free(data);
+        }
+        return 0;
+    }
+    for (size_t i = 0; i < BENCH_CORPORA; i++) {
+        char* data = NULL;
+        size_t length = 0;
+        FILE* f = open_memstream(&data, &length);
+        if (f == NULL) exit(1);
+        corpora[i].generate(f, size * 1000000);
+        fclose(f);
+        __bench(corpora[i].name, data, length, repeat);
+        free(data);
+    }
+    return 0;
+}
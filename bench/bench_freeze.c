@@ -0,0 +1,208 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Frozen tape, compared with the node tree it was frozen from.
+
+    bench_freeze [-s size_mb] [-r repeat] [-a]
+
+A multi-document corpus is generated in memory and parsed (with -a using
+SimpleYamlOptions.use_arena), then frozen. Reported are the memory used by
+the tree (heap in use, requires glibc) and the tape, the freeze time, and
+the time of path lookups and of a full traversal for each. */
+
+#define _GNU_SOURCE
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <simple_yaml.h>
+
+
+#define BENCH_FIND_COUNT    1000000
+
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t __heap(void)
+{
+#ifdef __GLIBC__
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+static void __generate(FILE* f, size_t size)
+{
+    for (uint32_t d = 0; (size_t)ftell(f) < size; d++) {
+        fprintf(f,
+            "---\n"
+            "apiVersion: v1\n"
+            "kind: Service\n"
+            "metadata:\n"
+            "  name: service-%u\n"
+            "  labels:\n"
+            "    app: app-%u\n"
+            "    tier: backend\n"
+            "spec:\n"
+            "  selector:\n"
+            "    app: app-%u\n"
+            "  ports:\n"
+            "    - protocol: TCP\n"
+            "      port: %u\n"
+            "      targetPort: %u\n"
+            "  sessionAffinity: None\n",
+            d, d % 97, d % 97, 8000 + d % 1000, 9000 + d % 1000);
+    }
+}
+
+static const char* paths[] = {
+    "metadata/name", "spec/ports/0/targetPort", "metadata/labels/tier",
+    "spec/sessionAffinity",
+};
+#define BENCH_PATHS     (sizeof(paths) / sizeof(paths[0]))
+
+/* Keeps the results of the timed loops. */
+static volatile uint64_t sink;
+
+static uint64_t __walk_tree(SimpleYamlNode* node)
+{
+    uint64_t sum = node->value_length;
+    if (node->node_type == YAML_MAPPING_NODE) {
+        for (uint32_t i = 0; i < node->mapping.count; i++) {
+            sum += __walk_tree(node->mapping.entries[i].node);
+        }
+    } else if (node->node_type == YAML_SEQUENCE_NODE) {
+        for (uint32_t i = 0; i < hashlist_length(&node->sequence); i++) {
+            sum += __walk_tree(hashlist_get_at(&node->sequence, i));
+        }
+    }
+    return sum;
+}
+
+static uint64_t __walk_tape(const SimpleYamlTape* tape, SimpleYamlTapeRef ref)
+{
+    size_t length = 0;
+    if (simple_yaml_tape_value(tape, ref, &length)) return length;
+    uint64_t sum = 0;
+    uint32_t count = simple_yaml_tape_length(tape, ref);
+    for (uint32_t i = 0; i < count; i++) {
+        sum += __walk_tape(tape, simple_yaml_tape_get_at(tape, ref, i, NULL));
+    }
+    return sum;
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t size = 32;
+    uint32_t repeat = 3;
+    SimpleYamlOptions options = { 0 };
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:a")) != -1) {
+        switch (opt) {
+            case 's': size = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            case 'a': options.use_arena = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-s size_mb] [-r repeat] [-a]\n",
+                        argv[0]);
+                exit(1);
+        }
+    }
+    if (size == 0 || repeat == 0) exit(1);
+
+    char* data = NULL;
+    size_t length = 0;
+    FILE* f = open_memstream(&data, &length);
+    if (f == NULL) exit(1);
+    __generate(f, size * 1000000);
+    fclose(f);
+
+    size_t heap = __heap();
+    HashList* doc_list = simple_yaml_parse_buffer(data, length, NULL, &options);
+    if (doc_list == NULL) exit(1);
+    size_t tree_bytes = __heap() - heap;
+    uint32_t documents = hashlist_length(doc_list);
+
+    double freeze = 0;
+    SimpleYamlTape* tape = NULL;
+    for (uint32_t r = 0; r < repeat; r++) {
+        simple_yaml_tape_destroy(tape);
+        double start = __now();
+        tape = simple_yaml_freeze(doc_list);
+        double elapsed = __now() - start;
+        if (tape == NULL) exit(1);
+        if (r == 0 || elapsed < freeze) freeze = elapsed;
+    }
+
+    double find_tree = 0, find_tape = 0, walk_tree = 0, walk_tape = 0;
+    uint64_t check = 0;
+    for (uint32_t r = 0; r < repeat; r++) {
+        double start = __now();
+        for (uint32_t i = 0; i < BENCH_FIND_COUNT; i++) {
+            SimpleYamlNode* doc = hashlist_get_at(doc_list,
+                    (i * 2654435761u) % documents);
+            check += simple_yaml_find_node(doc, paths[i % BENCH_PATHS]) != NULL;
+        }
+        double elapsed = __now() - start;
+        if (r == 0 || elapsed < find_tree) find_tree = elapsed;
+
+        start = __now();
+        for (uint32_t i = 0; i < BENCH_FIND_COUNT; i++) {
+            SimpleYamlTapeRef doc = simple_yaml_tape_document(tape,
+                    (i * 2654435761u) % documents);
+            check += simple_yaml_tape_find(tape, doc, paths[i % BENCH_PATHS])
+                    != SIMPLE_YAML_TAPE_NONE;
+        }
+        elapsed = __now() - start;
+        if (r == 0 || elapsed < find_tape) find_tape = elapsed;
+
+        start = __now();
+        for (uint32_t i = 0; i < documents; i++) {
+            check += __walk_tree(hashlist_get_at(doc_list, i));
+        }
+        elapsed = __now() - start;
+        if (r == 0 || elapsed < walk_tree) walk_tree = elapsed;
+
+        start = __now();
+        for (uint32_t i = 0; i < documents; i++) {
+            check += __walk_tape(tape, simple_yaml_tape_document(tape, i));
+        }
+        elapsed = __now() - start;
+        if (r == 0 || elapsed < walk_tape) walk_tape = elapsed;
+    }
+    sink = check;
+
+    printf("source %.1f MB, %u documents, freeze %.1f ms\n",
+            length / 1e6, documents, freeze * 1e3);
+    printf("%6s %10s %12s %12s\n", "", "MB", "find ns", "walk ms");
+    printf("%6s %10.1f %12.1f %12.1f\n", "tree", tree_bytes / 1e6,
+            find_tree * 1e9 / BENCH_FIND_COUNT, walk_tree * 1e3);
+    printf("%6s %10.1f %12.1f %12.1f\n", "tape",
+            simple_yaml_tape_size(tape) / 1e6,
+            find_tape * 1e9 / BENCH_FIND_COUNT, walk_tape * 1e3);
+
+    simple_yaml_tape_destroy(tape);
+    for (uint32_t i = 0; i < documents; i++) {
+        simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+    }
+    hashlist_destroy(doc_list);
+    free(doc_list);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* HashMap throughput, set/get/remove over N distinct keys.
+
+    bench_hashmap [-n keys] [-r repeat] [-k key_length] [-f]
+
+Keys are generated up front, the map copies them (hashmap_set) as the
+mapping index does when it is not borrowing keys. With -f the map uses the
+FNV-1a hash (hashmap_init_alt) instead of the default hash. */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <hashmap.h>
+
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char** __generate(uint32_t count, uint32_t key_length)
+{
+    char** keys = calloc(count, sizeof(char*));
+    if (keys == NULL) return NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        keys[i] = malloc(key_length + 16);
+        if (keys[i] == NULL) exit(1);
+        int n = snprintf(keys[i], key_length + 16, "key-%u-", i);
+        /* Pad to the requested length, keys share a prefix as config keys do. */
+        for (; (uint32_t)n < key_length; n++) keys[i][n] = 'a' + (i + n) % 26;
+        keys[i][n] = '\0';
+    }
+    return keys;
+}
+
+static void __shuffle(char** keys, uint32_t count)
+{
+    srand(42);
+    for (uint32_t i = count - 1; i > 0; i--) {
+        uint32_t j = rand() % (i + 1);
+        char* t = keys[i];
+        keys[i] = keys[j];
+        keys[j] = t;
+    }
+}
+
+static void __report(const char* op, uint32_t size, uint64_t ops, double best)
+{
+    printf("%8s %10u %12.1f %10.1f\n", op, size, ops / best / 1e6,
+            best * 1e9 / ops);
+}
+
+static hashmap_hash_function hash_function = NULL;
+
+static void __run(char** keys, char** lookup, uint32_t size, uint32_t repeat)
+{
+    double set = 0, get = 0, miss = 0, remove = 0;
+    uint64_t ops = size < 1000000 ? 1000000 : size;
+    uint64_t found = 0;
+    for (uint32_t r = 0; r < repeat; r++) {
+        HashMap h;
+        hashmap_init_alt(&h, 1024, hash_function);
+
+        double start = __now();
+        for (uint32_t i = 0; i < size; i++) {
+            hashmap_set(&h, keys[i], keys[i]);
+        }
+        double elapsed = __now() - start;
+        if (r == 0 || elapsed < set) set = elapsed;
+
+        /* Lookups cycle over the keys in a different order to the inserts. */
+        start = __now();
+        for (uint64_t i = 0; i < ops; i++) {
+            if (hashmap_get(&h, lookup[i % size])) found++;
+        }
+        elapsed = (__now() - start) / ((double)ops / size);
+        if (r == 0 || elapsed < get) get = elapsed;
+
+        /* Misses, the keys are not in the map (the following block). */
+        start = __now();
+        for (uint64_t i = 0; i < ops; i++) {
+            if (hashmap_get(&h, keys[size + i % size])) found++;
+        }
+        elapsed = (__now() - start) / ((double)ops / size);
+        if (r == 0 || elapsed < miss) miss = elapsed;
+
+        start = __now();
+        for (uint32_t i = 0; i < size; i++) {
+            hashmap_remove(&h, lookup[i]);
+        }
+        elapsed = __now() - start;
+        if (r == 0 || elapsed < remove) remove = elapsed;
+
+        hashmap_destroy(&h);
+    }
+    if (found != ops * repeat) {
+        fprintf(stderr, "unexpected lookup count %lu\n", (unsigned long)found);
+    }
+    __report("set", size, size, set);
+    __report("get", size, size, get);
+    __report("miss", size, size, miss);
+    __report("remove", size, size, remove);
+}
+
+
+int main(int argc, char** argv)
+{
+    uint32_t max_keys = 1000000;
+    uint32_t repeat = 3;
+    uint32_t key_length = 12;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:k:f")) != -1) {
+        switch (opt) {
+            case 'n': max_keys = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            case 'k': key_length = atoi(optarg); break;
+            case 'f': hash_function = hashmap_fnv1a_hash; break;
+            default:
+                fprintf(stderr, "usage: %s [-n keys] [-r repeat] "
+                        "[-k key_length] [-f]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (max_keys < 8 || repeat == 0) exit(1);
+
+    /* Twice as many keys, the second half is used for misses. */
+    char** keys = __generate(max_keys * 2, key_length);
+    char** lookup = malloc(max_keys * sizeof(char*));
+    if (keys == NULL || lookup == NULL) {
+        perror("Error generating keys");
+        exit(1);
+    }
+
+    printf("%8s %10s %12s %10s\n", "op", "keys", "Mops/s", "ns/op");
+    for (uint32_t size = 8; size <= max_keys; size *= 8) {
+        memcpy(lookup, keys, size * sizeof(char*));
+        __shuffle(lookup, size);
+        __run(keys, lookup, size, repeat);
+        if (size < max_keys && size * 8 > max_keys) size = max_keys / 8;
+    }
+
+    for (uint32_t i = 0; i < max_keys * 2; i++) free(keys[i]);
+    free(keys);
+    free(lookup);
+    return 0;
+}
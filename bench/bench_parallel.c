@@ -0,0 +1,154 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Parallel parse scaling, parses a multi-document stream with 1 to N threads.
+
+    bench_parallel [-t max_threads] [-r repeat] [-d documents] [file]
+
+Without a file a stream of generated documents is parsed. */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <simple_yaml.h>
+
+
+static char* __generate(uint32_t documents, size_t* length)
+{
+    size_t capacity = 1024 * 1024;
+    char* buffer = malloc(capacity);
+    size_t used = 0;
+    for (uint32_t i = 0; buffer && i < documents; i++) {
+        if (capacity - used < 1024) {
+            capacity *= 2;
+            char* p = realloc(buffer, capacity);
+            if (p == NULL) {
+                free(buffer);
+                return NULL;
+            }
+            buffer = p;
+        }
+        used += snprintf(buffer + used, capacity - used,
+            "---\n"
+            "apiVersion: v1\n"
+            "kind: Service\n"
+            "metadata:\n"
+            "  name: service-%u\n"
+            "  labels:\n"
+            "    app: app-%u\n"
+            "    tier: backend\n"
+            "spec:\n"
+            "  selector:\n"
+            "    app: app-%u\n"
+            "  ports:\n"
+            "    - name: http\n"
+            "      protocol: TCP\n"
+            "      port: %u\n"
+            "      targetPort: %u\n"
+            "    - name: metrics\n"
+            "      protocol: TCP\n"
+            "      port: 9090\n"
+            "      targetPort: 9090\n",
+            i, i % 97, i % 97, 8000 + i % 1000, 9000 + i % 1000);
+    }
+    *length = used;
+    return buffer;
+}
+
+static char* __read_file(const char* filename, size_t* length)
+{
+    FILE* f = fopen(filename, "rb");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* buffer = malloc(size > 0 ? size : 1);
+    if (buffer && fread(buffer, 1, size, f) != (size_t)size) {
+        free(buffer);
+        buffer = NULL;
+    }
+    fclose(f);
+    *length = size;
+    return buffer;
+}
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __destroy(HashList* doc_list)
+{
+    if (doc_list == NULL) return;
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+    }
+    hashlist_destroy(doc_list);
+    free(doc_list);
+}
+
+
+int main(int argc, char** argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t max_threads = cpus > 0 ? cpus : 1;
+    uint32_t repeat = 5;
+    uint32_t documents = 20000;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:r:d:")) != -1) {
+        switch (opt) {
+            case 't': max_threads = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            case 'd': documents = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-t max_threads] [-r repeat] "
+                        "[-d documents] [file]\n", argv[0]);
+                exit(1);
+        }
+    }
+
+    size_t length = 0;
+    char* buffer = (optind < argc) ? __read_file(argv[optind], &length)
+            : __generate(documents, &length);
+    if (buffer == NULL) {
+        perror("Error loading input");
+        exit(1);
+    }
+
+    printf("input %.1f MB, %ld cpus\n", length / 1e6, cpus);
+    printf("%8s %10s %10s %10s %8s\n",
+            "threads", "documents", "seconds", "MB/s", "speedup");
+    double base = 0;
+    for (uint32_t threads = 1; threads <= max_threads; threads *= 2) {
+        SimpleYamlOptions options = { .use_arena = true, .threads = threads };
+        double best = 0;
+        uint32_t count = 0;
+        for (uint32_t r = 0; r < repeat; r++) {
+            double start = __now();
+            HashList* doc_list = simple_yaml_parse_buffer(
+                    buffer, length, NULL, &options);
+            double elapsed = __now() - start;
+            count = doc_list ? hashlist_length(doc_list) : 0;
+            __destroy(doc_list);
+            if (r == 0 || elapsed < best) best = elapsed;
+        }
+        if (threads == 1) base = best;
+        printf("%8u %10u %10.3f %10.1f %7.2fx\n", threads, count, best,
+                length / 1e6 / best, base / best);
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+
+    free(buffer);
+    return 0;
+}
@@ -0,0 +1,426 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Parser benchmark, generates synthetic corpora and measures parse, find and
+destroy for each.
+
+    bench_parse [-s size_mb] [-r repeat] [-a] [-i] [-k] [file ...]
+
+    -s  size of each generated corpus in MB (default 8)
+    -r  repetitions, the best time is reported (default 3)
+    -a  parse with SimpleYamlOptions.use_arena
+    -i  intern keys (SimpleYamlOptions.keys), a table per parse
+    -k  keep the generated corpora (the directory is printed)
+
+Files given on the command line are benchmarked instead of the generated
+corpora. Each corpus is measured in its own process so that peak RSS is
+reported per corpus. Allocation counts require glibc. */
+
+#define _GNU_SOURCE
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <simple_yaml.h>
+
+
+#define BENCH_FIND_COUNT    200000
+#define BENCH_FIND_PATHS    4096    /* Distinct paths, cycled. */
+#define BENCH_PATH_LEN      512
+#define BENCH_DEEP_LEVELS   32
+
+
+/* Allocation counters, malloc is interposed (glibc). */
+typedef struct AllocStats {
+    uint64_t    allocs;
+    uint64_t    bytes;
+} AllocStats;
+
+static AllocStats alloc_stats;
+
+#ifdef __GLIBC__
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+void* malloc(size_t size)
+{
+    alloc_stats.allocs++;
+    alloc_stats.bytes += size;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    alloc_stats.allocs++;
+    alloc_stats.bytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    alloc_stats.allocs++;
+    alloc_stats.bytes += size;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+#endif
+
+
+/* Corpus generators, each writes documents until size bytes are written and
+formats the path of the i'th find (returning the document to search). */
+typedef void (*GenerateFunc)(FILE* f, size_t size);
+typedef uint32_t (*FindPathFunc)(uint32_t i, uint32_t documents, char* path);
+
+typedef struct Corpus {
+    const char*     name;
+    GenerateFunc    generate;
+    FindPathFunc    find_path;
+} Corpus;
+
+
+static void __generate_deep(FILE* f, size_t size)
+{
+    for (uint32_t d = 0; (size_t)ftell(f) < size; d++) {
+        fprintf(f, "---\n");
+        for (uint32_t l = 0; l < BENCH_DEEP_LEVELS; l++) {
+            fprintf(f, "%*sname_%u: level %u of document %u\n",
+                    l * 2, "", l, l, d);
+            fprintf(f, "%*slevel_%u:\n", l * 2, "", l);
+        }
+        fprintf(f, "%*svalue: %u\n", BENCH_DEEP_LEVELS * 2, "", d);
+    }
+}
+
+static uint32_t __find_deep(uint32_t i, uint32_t documents, char* path)
+{
+    size_t length = 0;
+    for (uint32_t l = 0; l < BENCH_DEEP_LEVELS; l++) {
+        length += sprintf(path + length, "level_%u/", l);
+    }
+    sprintf(path + length, "value");
+    return i % documents;
+}
+
+static uint32_t wide_keys;
+
+static void __generate_wide(FILE* f, size_t size)
+{
+    wide_keys = 0;
+    while ((size_t)ftell(f) < size) {
+        fprintf(f, "key_%08u: value of key %u\n", wide_keys, wide_keys);
+        wide_keys++;
+    }
+}
+
+static uint32_t __find_wide(uint32_t i, uint32_t documents, char* path)
+{
+    sprintf(path, "key_%08u", (uint32_t)((i * 2654435761u) % wide_keys));
+    return documents - 1;
+}
+
+static uint32_t sequence_items;
+
+static void __generate_sequence(FILE* f, size_t size)
+{
+    sequence_items = 0;
+    while ((size_t)ftell(f) < size) {
+        fprintf(f, "- item %u\n", sequence_items++);
+    }
+}
+
+static uint32_t __find_sequence(uint32_t i, uint32_t documents, char* path)
+{
+    sprintf(path, "%u", (uint32_t)((i * 2654435761u) % sequence_items));
+    return documents - 1;
+}
+
+static void __generate_documents(FILE* f, size_t size)
+{
+    for (uint32_t d = 0; (size_t)ftell(f) < size; d++) {
+        fprintf(f,
+            "---\n"
+            "apiVersion: v1\n"
+            "kind: Service\n"
+            "metadata:\n"
+            "  name: service-%u\n"
+            "  labels:\n"
+            "    app: app-%u\n"
+            "spec:\n"
+            "  selector:\n"
+            "    app: app-%u\n"
+            "  ports:\n"
+            "    - protocol: TCP\n"
+            "      port: %u\n"
+            "      targetPort: %u\n",
+            d, d % 97, d % 97, 8000 + d % 1000, 9000 + d % 1000);
+    }
+}
+
+static uint32_t __find_documents(uint32_t i, uint32_t documents, char* path)
+{
+    sprintf(path, (i % 2) ? "spec/ports/0/targetPort" : "metadata/name");
+    return i % documents;
+}
+
+static uint32_t block_keys;
+
+static void __generate_block(FILE* f, size_t size)
+{
+    block_keys = 0;
+    while ((size_t)ftell(f) < size) {
+        fprintf(f, "block_%u: |\n", block_keys++);
+        for (uint32_t l = 0; l < 64; l++) {
+            fprintf(f, "  line %02u of a literal block scalar, which is "
+                    "copied into a single value\n", l);
+        }
+    }
+}
+
+static uint32_t __find_block(uint32_t i, uint32_t documents, char* path)
+{
+    sprintf(path, "block_%u", i % block_keys);
+    return documents - 1;
+}
+
+static uint32_t __find_root(uint32_t i, uint32_t documents, char* path)
+{
+    path[0] = '\0';
+    return i % documents;
+}
+
+static const Corpus corpora[] = {
+    { "deep", __generate_deep, __find_deep },
+    { "wide", __generate_wide, __find_wide },
+    { "sequence", __generate_sequence, __find_sequence },
+    { "documents", __generate_documents, __find_documents },
+    { "block", __generate_block, __find_block },
+};
+#define BENCH_CORPORA   (sizeof(corpora) / sizeof(corpora[0]))
+
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t __count_nodes(SimpleYamlNode* node)
+{
+    uint64_t count = 1;
+    if (node->node_type == YAML_MAPPING_NODE) {
+        for (uint32_t i = 0; i < simple_yaml_mapping_length(node); i++) {
+            count += __count_nodes(simple_yaml_mapping_get_at(node, i)->node);
+        }
+    } else if (node->node_type == YAML_SEQUENCE_NODE) {
+        for (uint32_t i = 0; i < hashlist_length(&node->sequence); i++) {
+            count += __count_nodes(hashlist_get_at(&node->sequence, i));
+        }
+    }
+    return count;
+}
+
+static void __destroy(HashList* doc_list)
+{
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+    }
+    hashlist_destroy(doc_list);
+    free(doc_list);
+}
+
+/* Benchmark one corpus, run in a child process. */
+static int __bench(const char* name, const char* filename,
+        FindPathFunc find_path, const SimpleYamlOptions* _options,
+        uint32_t repeat, bool intern)
+{
+    SimpleYamlOptions options = *_options;
+    struct stat st;
+    if (stat(filename, &st) == -1) {
+        perror("Error opening file");
+        return 1;
+    }
+    double mb = st.st_size / 1e6;
+
+    double parse = 0, destroy = 0;
+    uint64_t nodes = 0, allocs = 0, alloc_bytes = 0;
+    uint32_t documents = 0;
+    HashList* doc_list = NULL;
+    SimpleYamlStats stats;
+    for (uint32_t r = 0; r < repeat; r++) {
+        simple_yaml_stats_reset();
+        AllocStats start_stats = alloc_stats;
+        double start = __now();
+        if (intern) options.keys = simple_yaml_keys_create();
+        doc_list = simple_yaml_parse_file_alt(filename, NULL, &options);
+        double elapsed = __now() - start;
+        if (doc_list == NULL || hashlist_length(doc_list) == 0) {
+            fprintf(stderr, "%s: no documents\n", filename);
+            return 1;
+        }
+        simple_yaml_stats_get(&stats);
+        allocs = alloc_stats.allocs - start_stats.allocs;
+        alloc_bytes = alloc_stats.bytes - start_stats.bytes;
+        if (r == 0 || elapsed < parse) parse = elapsed;
+        if (r == repeat - 1) break;
+
+        start = __now();
+        __destroy(doc_list);
+        simple_yaml_keys_destroy(options.keys);
+        elapsed = __now() - start;
+        if (r == 0 || elapsed < destroy) destroy = elapsed;
+    }
+    documents = hashlist_length(doc_list);
+    for (uint32_t i = 0; i < documents; i++) {
+        nodes += __count_nodes(hashlist_get_at(doc_list, i));
+    }
+
+    /* Find, paths are formatted before timing. */
+    char (*paths)[BENCH_PATH_LEN] = malloc(BENCH_FIND_PATHS * BENCH_PATH_LEN);
+    uint32_t* docs = malloc(BENCH_FIND_PATHS * sizeof(uint32_t));
+    if (paths == NULL || docs == NULL) {
+        perror("Error allocating paths");
+        return 1;
+    }
+    for (uint32_t i = 0; i < BENCH_FIND_PATHS; i++) {
+        docs[i] = find_path(i, documents, paths[i]);
+    }
+    uint32_t found = 0;
+    double start = __now();
+    for (uint32_t i = 0; i < BENCH_FIND_COUNT; i++) {
+        uint32_t p = i % BENCH_FIND_PATHS;
+        SimpleYamlNode* doc = hashlist_get_at(doc_list, docs[p]);
+        if (simple_yaml_find_node(doc, paths[p])) found++;
+    }
+    double find = __now() - start;
+    free(paths);
+    free(docs);
+
+    start = __now();
+    __destroy(doc_list);
+    simple_yaml_keys_destroy(options.keys);
+    double elapsed = __now() - start;
+    if (repeat == 1 || elapsed < destroy) destroy = elapsed;
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("%-10s %8.1f %6u %9lu %8.3f %8.1f %9.2f %10lu %9.1f %9.2f "
+            "%9.3f %8.1f\n",
+            name, mb, documents, (unsigned long)nodes, parse, mb / parse,
+            nodes / parse / 1e6, (unsigned long)allocs, alloc_bytes / 1e6,
+            found / find / 1e6, destroy, ru.ru_maxrss / 1024.0);
+    if (stats.events) {
+        /* Library built with SIMPLE_YAML_STATS (make STATS=1). */
+        double ns = stats.parse_ns + stats.build_ns;
+        printf("%-10s events %lu, libyaml %.0f%%, build %.0f%%, "
+                "copied %.1f MB, hashmap resizes %lu, probes %.2f (max %lu)\n",
+                "", (unsigned long)stats.events,
+                100 * stats.parse_ns / ns, 100 * stats.build_ns / ns,
+                (stats.key_bytes + stats.scalar_bytes) / 1e6,
+                (unsigned long)stats.hashmap_resizes,
+                stats.hashmap_lookups ? (double)stats.hashmap_probes
+                        / stats.hashmap_lookups : 0.0,
+                (unsigned long)stats.hashmap_max_probe);
+    }
+    fflush(stdout);
+    return 0;
+}
+
+static int __run(const char* name, const char* filename,
+        FindPathFunc find_path, const SimpleYamlOptions* options,
+        uint32_t repeat, bool intern)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("Error starting benchmark");
+        return 1;
+    }
+    if (pid == 0) {
+        /* exit(), not _exit(), so that profiles are written (make pgo). */
+        exit(__bench(name, filename, find_path, options, repeat, intern));
+    }
+    int status;
+    if (waitpid(pid, &status, 0) == -1) return 1;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : 1;
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t size = 8;
+    uint32_t repeat = 3;
+    bool keep = false;
+    bool intern = false;
+    SimpleYamlOptions options = { 0 };
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:aik")) != -1) {
+        switch (opt) {
+            case 's': size = strtoul(optarg, NULL, 10); break;
+            case 'r': repeat = strtoul(optarg, NULL, 10); break;
+            case 'a': options.use_arena = true; break;
+            case 'i': intern = true; break;
+            case 'k': keep = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-s size_mb] [-r repeat] [-a] "
+                        "[-i] [-k] [file ...]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (repeat == 0) repeat = 1;
+
+    printf("%-10s %8s %6s %9s %8s %8s %9s %10s %9s %9s %9s %8s\n",
+            "corpus", "MB", "docs", "nodes", "parse_s", "MB/s", "Mnodes/s",
+            "allocs", "alloc_MB", "Mfinds/s", "destroy_s", "rss_MB");
+    int rc = 0;
+    if (optind < argc) {
+        for (int i = optind; i < argc; i++) {
+            const char* name = strrchr(argv[i], '/');
+            name = name ? name + 1 : argv[i];
+            rc |= __run(name, argv[i], __find_root, &options, repeat, intern);
+        }
+        exit(rc);
+    }
+
+    char dir[] = "/tmp/simple_yaml_bench.XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror("Error creating corpus directory");
+        exit(1);
+    }
+    for (size_t c = 0; c < BENCH_CORPORA; c++) {
+        char filename[BENCH_PATH_LEN];
+        snprintf(filename, sizeof(filename), "%s/%s.yaml",
+                dir, corpora[c].name);
+        FILE* f = fopen(filename, "w");
+        if (f == NULL) {
+            perror("Error creating corpus");
+            exit(1);
+        }
+        corpora[c].generate(f, size * 1000 * 1000);
+        fclose(f);
+        rc |= __run(corpora[c].name, filename, corpora[c].find_path,
+                &options, repeat, intern);
+        if (!keep) unlink(filename);
+    }
+    if (keep) {
+        printf("corpora kept in %s\n", dir);
+    } else {
+        rmdir(dir);
+    }
+    exit(rc);
+}
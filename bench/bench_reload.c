@@ -0,0 +1,134 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Reload of a stream with one changed document, compared with parsing.
+
+    bench_reload [-s size_mb] [-r repeat] [-a]
+
+A multi-document corpus is generated in memory and loaded, then one
+document (in the middle of the stream) is edited. Reported are the times to
+parse the edited stream, and to reload it (with -a using
+SimpleYamlOptions.use_arena). */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <simple_yaml.h>
+
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __generate(FILE* f, size_t size)
+{
+    for (uint32_t d = 0; (size_t)ftell(f) < size; d++) {
+        fprintf(f,
+            "---\n"
+            "apiVersion: v1\n"
+            "kind: Service\n"
+            "metadata:\n"
+            "  name: service-%u\n"
+            "  labels:\n"
+            "    app: app-%u\n"
+            "spec:\n"
+            "  ports:\n"
+            "    - protocol: TCP\n"
+            "      port: %u\n",
+            d, d % 97, 8000 + d % 1000);
+    }
+}
+
+static void __destroy(HashList* doc_list)
+{
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+    }
+    hashlist_destroy(doc_list);
+    free(doc_list);
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t size = 32;
+    uint32_t repeat = 3;
+    SimpleYamlOptions options = { 0 };
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:a")) != -1) {
+        switch (opt) {
+            case 's': size = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            case 'a': options.use_arena = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-s size_mb] [-r repeat] [-a]\n",
+                        argv[0]);
+                exit(1);
+        }
+    }
+    if (size == 0 || repeat == 0) exit(1);
+
+    char* data = NULL;
+    size_t length = 0;
+    FILE* f = open_memstream(&data, &length);
+    if (f == NULL) exit(1);
+    __generate(f, size * 1000000);
+    fclose(f);
+
+    /* The edited stream, the "TCP" of a document in the middle. */
+    char* edited = malloc(length);
+    if (edited == NULL) exit(1);
+    memcpy(edited, data, length);
+    char* tcp = strstr(edited + length / 2, "TCP");
+    if (tcp == NULL) exit(1);
+    memcpy(tcp, "UDP", 3);
+
+    double parse = 0, reload = 0;
+    uint32_t documents = 0, reused = 0;
+    for (uint32_t r = 0; r < repeat; r++) {
+        double start = __now();
+        HashList* doc_list = simple_yaml_parse_buffer(
+                edited, length, NULL, &options);
+        double elapsed = __now() - start;
+        if (doc_list == NULL) exit(1);
+        if (r == 0 || elapsed < parse) parse = elapsed;
+        documents = hashlist_length(doc_list);
+        __destroy(doc_list);
+    }
+
+    for (uint32_t r = 0; r < repeat; r++) {
+        SimpleYamlReload state = { 0 };
+        HashList* previous = simple_yaml_reload_buffer(
+                &state, NULL, data, length, &options);
+        if (previous == NULL) exit(1);
+        double start = __now();
+        HashList* doc_list = simple_yaml_reload_buffer(
+                &state, previous, edited, length, &options);
+        double elapsed = __now() - start;
+        if (doc_list == NULL || state.replaced_count != 1) exit(1);
+        if (r == 0 || elapsed < reload) reload = elapsed;
+        reused = state.reused;
+        __destroy(previous);
+        __destroy(doc_list);
+        simple_yaml_reload_release(&state);
+    }
+    free(edited);
+    free(data);
+
+    printf("source %.1f MB, %u documents, %u reused\n",
+            length / 1e6, documents, reused);
+    printf("%-10s %10s\n", "", "ms");
+    printf("%-10s %10.1f\n", "parse", parse * 1e3);
+    printf("%-10s %10.1f\n", "reload", reload * 1e3);
+    return 0;
+}
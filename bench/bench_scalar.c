@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Scalar resolution throughput, for int, float and mixed scalars.
+
+    bench_scalar [-n scalars] [-r repeat] [-m none|sse2|avx2]
+
+Mixed scalars are ints, floats, strings and bools. The resolution of each
+node is cleared before each repeat. For reference the same values are also
+converted with strtoll/strtod. With -m the classifier implementation is
+limited (see SIMPLE_YAML_SIMD). */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <simple_yaml.h>
+
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __value(char* buffer, size_t size, const char* kind, uint32_t i)
+{
+    if (strcmp(kind, "mixed") == 0) {
+        const char* kinds[] = { "int", "float", "string", "bool" };
+        kind = kinds[i % 4];
+    }
+    if (strcmp(kind, "int") == 0) {
+        snprintf(buffer, size, "%d", (int)(rand() % 2000000) - 1000000);
+    } else if (strcmp(kind, "int64") == 0) {
+        /* i.e. timestamps in nanoseconds. */
+        snprintf(buffer, size, "%lld",
+                1600000000000000000LL + (long long)rand() * rand());
+    } else if (strcmp(kind, "float") == 0) {
+        snprintf(buffer, size, "%.*f", 1 + rand() % 6, rand() / 1000.0);
+    } else if (strcmp(kind, "bool") == 0) {
+        snprintf(buffer, size, "%s", (i & 1) ? "true" : "false");
+    } else {
+        snprintf(buffer, size, "service-%u", i);
+    }
+}
+
+/* Keeps the results of the timed loops. */
+static volatile uint64_t sink;
+
+static void __run(const char* kind, uint32_t count, uint32_t repeat)
+{
+    SimpleYamlNode** nodes = calloc(count, sizeof(SimpleYamlNode*));
+    if (nodes == NULL) exit(1);
+    char buffer[64];
+    srand(42);
+    for (uint32_t i = 0; i < count; i++) {
+        __value(buffer, sizeof(buffer), kind, i);
+        nodes[i] = simple_yaml_create_node(NULL, NULL);
+        simple_yaml_set_scalar(nodes[i], buffer);
+    }
+
+    double resolve = 0, libc = 0;
+    uint64_t check = 0;
+    for (uint32_t r = 0; r < repeat; r++) {
+        for (uint32_t i = 0; i < count; i++) {
+            nodes[i]->scalar.type = SIMPLE_YAML_SCALAR_UNRESOLVED;
+        }
+        double start = __now();
+        for (uint32_t i = 0; i < count; i++) {
+            check += simple_yaml_resolve_scalar(nodes[i])->type;
+        }
+        double elapsed = __now() - start;
+        if (r == 0 || elapsed < resolve) resolve = elapsed;
+
+        start = __now();
+        for (uint32_t i = 0; i < count; i++) {
+            char* end;
+            const char* value = nodes[i]->value;
+            long long v = strtoll(value, &end, 10);
+            if (*end) v = strtod(value, &end);
+            check += (uint64_t)v;
+        }
+        elapsed = __now() - start;
+        if (r == 0 || elapsed < libc) libc = elapsed;
+    }
+    sink = check;
+    printf("%8s %10u %12.1f %10.1f %12.1f %10.1f\n", kind, count,
+            count / resolve / 1e6, resolve * 1e9 / count,
+            count / libc / 1e6, libc * 1e9 / count);
+
+    for (uint32_t i = 0; i < count; i++) simple_yaml_destroy_node(nodes[i]);
+    free(nodes);
+}
+
+
+int main(int argc, char** argv)
+{
+    uint32_t count = 1000000;
+    uint32_t repeat = 5;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:m:")) != -1) {
+        switch (opt) {
+            case 'n': count = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            case 'm': setenv("SIMPLE_YAML_SIMD", optarg, 1); break;
+            default:
+                fprintf(stderr, "usage: %s [-n scalars] [-r repeat] "
+                        "[-m none|sse2|avx2]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (count == 0 || repeat == 0) exit(1);
+
+    printf("%8s %10s %12s %10s %12s %10s\n", "kind", "scalars",
+            "Mresolve/s", "ns/scalar", "Mstrto*/s", "ns/scalar");
+    const char* kinds[] = { "int", "int64", "float", "mixed", NULL };
+    for (const char** kind = kinds; *kind; kind++) {
+        __run(*kind, count, repeat);
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Lookups from several threads on shared documents.
+
+    bench_shared [-s size_mb] [-t threads] [-d duration_ms]
+
+A multi-document corpus is generated in memory, loaded (with resolved
+scalars) and shared. Each thread repeatedly acquires the current snapshot,
+looks up a path of one document, reads its value and releases the snapshot.
+Reported is the lookup rate with the documents unchanged, then while a
+reloader edits one document and publishes the reloaded doc_list in a loop. */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <simple_yaml.h>
+
+
+static double __now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __generate(FILE* f, size_t size, uint32_t edit)
+{
+    for (uint32_t d = 0; (size_t)ftell(f) < size; d++) {
+        fprintf(f,
+            "---\n"
+            "apiVersion: v1\n"
+            "kind: Service\n"
+            "metadata:\n"
+            "  name: service-%u\n"
+            "  generation: %u\n"
+            "spec:\n"
+            "  ports:\n"
+            "    - protocol: TCP\n"
+            "      port: %u\n",
+            d, d == edit ? edit : 0, 8000 + d % 1000);
+    }
+}
+
+typedef struct Bench {
+    SimpleYamlShared*   shared;
+    uint32_t            stop;       /* Atomic. */
+} Bench;
+
+typedef struct Reader {
+    Bench*              bench;
+    pthread_t           thread;
+    uint64_t            lookups;
+    uint64_t            errors;
+} Reader;
+
+static void* __reader(void* data)
+{
+    Reader* r = data;
+    uint32_t seed = (uint32_t)(uintptr_t)r;
+    while (!__atomic_load_n(&r->bench->stop, __ATOMIC_RELAXED)) {
+        const SimpleYamlSnapshot* s = simple_yaml_shared_acquire(r->bench->shared);
+        seed = seed * 1103515245 + 12345;
+        uint32_t index = seed % hashlist_length(s->doc_list);
+        SimpleYamlNode* port = simple_yaml_find_node(
+                hashlist_get_at(s->doc_list, index), "spec/ports/0/port");
+        int64_t value = 0;
+        if (port == NULL || simple_yaml_get_value_as_int64(port, &value)
+                || value != 8000 + index % 1000) {
+            r->errors++;
+        }
+        simple_yaml_snapshot_release(s);
+        r->lookups++;
+    }
+    return NULL;
+}
+
+/* Run the readers for duration, publishing reloads when reload is set.
+Returns lookups per second. */
+static double __run(Bench* bench, uint32_t threads, uint32_t duration,
+        SimpleYamlReload* reload, size_t size, const SimpleYamlOptions* options,
+        uint32_t* publishes)
+{
+    Reader* readers = calloc(threads, sizeof(Reader));
+    if (readers == NULL) exit(1);
+    __atomic_store_n(&bench->stop, 0, __ATOMIC_RELAXED);
+    double start = __now();
+    for (uint32_t i = 0; i < threads; i++) {
+        readers[i].bench = bench;
+        if (pthread_create(&readers[i].thread, NULL, __reader, &readers[i])) exit(1);
+    }
+    *publishes = 0;
+    while (__now() - start < duration / 1e3) {
+        if (reload == NULL) {
+            nanosleep(&(struct timespec){ .tv_nsec = 1000000 }, NULL);
+            continue;
+        }
+        const SimpleYamlSnapshot* s = simple_yaml_shared_acquire(bench->shared);
+        char* data = NULL;
+        size_t length = 0;
+        FILE* f = open_memstream(&data, &length);
+        if (f == NULL) exit(1);
+        __generate(f, size, 1 + *publishes % 100);
+        fclose(f);
+        HashList* doc_list = simple_yaml_reload_buffer(
+                reload, s->doc_list, data, length, options);
+        free(data);
+        simple_yaml_snapshot_release(s);
+        if (doc_list == NULL) exit(1);
+        if (simple_yaml_shared_publish(bench->shared, doc_list)) exit(1);
+        (*publishes)++;
+    }
+    __atomic_store_n(&bench->stop, 1, __ATOMIC_RELAXED);
+    uint64_t lookups = 0, errors = 0;
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_join(readers[i].thread, NULL);
+        lookups += readers[i].lookups;
+        errors += readers[i].errors;
+    }
+    double elapsed = __now() - start;
+    free(readers);
+    if (errors) {
+        fprintf(stderr, "%lu lookup errors\n", (unsigned long)errors);
+        exit(1);
+    }
+    return lookups / elapsed;
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t size = 4;
+    uint32_t threads = 8;
+    uint32_t duration = 2000;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:d:")) != -1) {
+        switch (opt) {
+            case 's': size = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'd': duration = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-s size_mb] [-t threads] "
+                        "[-d duration_ms]\n", argv[0]);
+                exit(1);
+        }
+    }
+    if (size == 0 || threads == 0 || duration == 0) exit(1);
+    size *= 1000000;
+
+    char* data = NULL;
+    size_t length = 0;
+    FILE* f = open_memstream(&data, &length);
+    if (f == NULL) exit(1);
+    __generate(f, size, 0);
+    fclose(f);
+
+    SimpleYamlOptions options = { .resolve_scalars = true };
+    SimpleYamlReload reload = { 0 };
+    HashList* doc_list = simple_yaml_reload_buffer(
+            &reload, NULL, data, length, &options);
+    free(data);
+    if (doc_list == NULL) exit(1);
+    Bench bench = { .shared = simple_yaml_shared_create(doc_list) };
+    if (bench.shared == NULL) exit(1);
+
+    uint32_t publishes = 0;
+    printf("%u documents, %u threads\n", hashlist_length(doc_list), threads);
+    printf("%-10s %12s %10s\n", "", "lookups/s", "publishes");
+    double rate = __run(&bench, threads, duration, NULL, size, &options,
+            &publishes);
+    printf("%-10s %12.0f %10u\n", "unchanged", rate, publishes);
+    rate = __run(&bench, threads, duration, &reload, size, &options,
+            &publishes);
+    printf("%-10s %12.0f %10u\n", "reloading", rate, publishes);
+
+    simple_yaml_shared_destroy(bench.shared);
+    simple_yaml_reload_release(&reload);
+    return 0;
+}
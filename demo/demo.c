@@ -0,0 +1,45 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <simple_yaml.h>
+
+
+int main(void)
+{
+    HashList* doc_list;
+    doc_list = simple_yaml_parse_file("sample.yaml", NULL);
+    SimpleYamlPath* target_port_path = simple_yaml_path_compile("spec/ports/*/targetPort");
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        SimpleYamlNode* doc = hashlist_get_at(doc_list, i);
+        SimpleYamlNode* kind_node = simple_yaml_find_node(doc, "kind");
+        SimpleYamlNode* name_node = simple_yaml_find_node(doc, "metadata/name");
+        SimpleYamlNode* app_node = simple_yaml_find_node(doc, "spec/selector/app");
+        printf("Document %d\n", i);
+        printf("  %s = %s\n", kind_node->name, kind_node->value);
+        printf("  %s = %s\n", name_node->name, name_node->value);
+        if (app_node) printf("  %s = %s\n", app_node->name, app_node->value);
+
+        HashList port_list;
+        hashlist_init(&port_list);
+        simple_yaml_find_all(doc, target_port_path, &port_list);
+        for (uint32_t port_index = 0; port_index < hashlist_length(&port_list); port_index++) {
+            SimpleYamlNode* _n = hashlist_get_at(&port_list, port_index);
+            printf("  %s = %s\n", _n->name, _n->value);
+        }
+        hashlist_destroy(&port_list);
+    }
+    simple_yaml_path_destroy(target_port_path);
+
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        SimpleYamlNode* doc = hashlist_get_at(doc_list, i);
+        simple_yaml_destroy_node(doc);
+    }
+    hashlist_destroy(doc_list);
+    free(doc_list);
+
+    exit(0);
+}
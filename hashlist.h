@@ -8,44 +8,74 @@ MIT License
 
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <arena.h>
 #include <hashmap.h>
 
 
-#define HASHLIST_KEY_LEN        (10+1)
+#define HASHLIST_INITIAL_CAPACITY   4
 
+/* Growable array of pointers (the name is historical, items were once
+stored in a HashMap keyed by their index). */
 typedef struct HashList {
-    HashMap     hash;
+    void**      items;
+    uint32_t    length;
+    uint32_t    capacity;
+    Arena*      arena;      /* if set, the item array is allocated from the arena */
 } HashList;
 
 
+static __inline__ int hashlist_init_arena(HashList *h, Arena *arena) {
+    assert(h);
+    h->items = NULL;  /* Allocated with the first append. */
+    h->length = 0;
+    h->capacity = 0;
+    h->arena = arena;
+    return HASHMAP_SUCCESS;
+}
+
 static __inline__ int hashlist_init(HashList *h) {
-    return hashmap_init(&h->hash);
+    return hashlist_init_arena(h, NULL);
 }
 
 static __inline__ void hashlist_destroy(HashList *h) {
     assert(h);
-    hashmap_destroy(&h->hash);
+    if (h->arena == NULL) free(h->items);
+    h->items = NULL;
+    h->length = 0;
+    h->capacity = 0;
 }
 
 static __inline__ uint32_t hashlist_length(HashList *h) {
     assert(h);
-    return h->hash.used_nodes;
+    return h->length;
 }
 
-static __inline__ void hashlist_append(HashList *h, void *value) {
+static __inline__ int hashlist_append(HashList *h, void *value) {
     assert(h);
-    char key[HASHLIST_KEY_LEN];
-    snprintf(key, HASHLIST_KEY_LEN, "%i", hashlist_length(h));
-    hashmap_set(&h->hash, key, value);
+    if (h->length == h->capacity) {
+        uint32_t capacity = h->capacity ? h->capacity * 2 : HASHLIST_INITIAL_CAPACITY;
+        void** items;
+        if (h->arena) {
+            items = (void**)arena_realloc(h->arena, h->items,
+                    h->capacity * sizeof(void*), capacity * sizeof(void*));
+        } else {
+            items = (void**)realloc(h->items, capacity * sizeof(void*));
+        }
+        if (items == NULL) return HASHMAP_FAILURE;
+        h->items = items;
+        h->capacity = capacity;
+    }
+    h->items[h->length++] = value;
+    return HASHMAP_SUCCESS;
 }
 
 static __inline__ void* hashlist_get_at(HashList *h, uint32_t index) {
     assert(h);
-    char key[HASHLIST_KEY_LEN];
-    snprintf(key, HASHLIST_KEY_LEN, "%i", index);
-    return hashmap_get(&h->hash, key);
+    if (index >= h->length) return NULL;
+    return h->items[index];
 }
 
 #endif /* HASHLIST_H */
@@ -14,20 +14,35 @@
 #include "hashmap.h"
 
 
-#define MAX_FULLNESS_PERCENT 0.25       /* arbitrary */
+/*  Open addressing with robin-hood probing; entries are stored inline in a
+    power of two sized array and the map grows once it is 3/4 full */
+#define MAX_FULLNESS_NUMERATOR      3
+#define MAX_FULLNESS_DENOMINATOR    4
+#define MIN_NUMBER_NODES            8
+
+/*  operation counters of the calling thread, when set (hashmap_set_counters) */
+static __thread HashMapCounters *counters = NULL;
+static inline void __count_lookup(uint64_t probes) {
+    ++counters->lookups;
+    counters->probes += probes;
+    if (probes > counters->max_probe) {counters->max_probe = probes;}
+}
+#define COUNTER_ADD(field, n) do {if (counters) {counters->field += (n);}} while (0)
+#define COUNTER_LOOKUP(probes) do {if (counters) {__count_lookup(probes);}} while (0)
 
 
 /*******************************************************************************
 ***        PRIVATE FUNCTIONS
 *******************************************************************************/
-static uint64_t default_hash(const char *key);
+static uint64_t default_hash(const char *key, size_t length);
+static inline uint64_t __hash(HashMap *h, const char *key, size_t length);
 static inline float __get_fullness(HashMap *h);
-static inline int __calc_big_o(uint64_t num_nodes, uint64_t i, uint64_t idx);
 static int   __allocate_hashmap(HashMap *h, uint64_t num_els);
-static int   __relayout_nodes(HashMap *h, uint64_t loc, short end_on_null);
-static void* __get_node(HashMap *h, const char *key, uint64_t hash, uint64_t *i, int *error);
-static void  __assign_node(HashMap *h, const char *key, void *value, short mallocd, uint64_t i, uint64_t hash);
-static void* __hashmap_set(HashMap *h, const char *key, void *value, short mallocd);
+static hashmap_node* __get_node(HashMap *h, const char *key, size_t length, uint64_t hash);
+static void  __insert_node(HashMap *h, hashmap_node *node);
+static void  __remove_node(HashMap *h, hashmap_node *node);
+static void  __free_node(HashMap *h, hashmap_node *node);
+static void* __hashmap_set(HashMap *h, const char *key, size_t length, uint64_t hash, void *value, short mallocd);
 static void  __calc_stats(HashMap *h, uint64_t *worst_case, uint64_t *max_big_o, float *avg_big_o, float *avg_used_big_o, unsigned int *hash, unsigned int *idx);
 static void __merge_sort(uint64_t *arr, uint64_t length);
 static void __m_sort_merge(uint64_t *arr, uint64_t length, uint64_t mid);
@@ -37,67 +52,116 @@ static void __m_sort_merge(uint64_t *arr, uint64_t length, uint64_t mid);
 *******************************************************************************/
 
 int hashmap_init_alt(HashMap *h,  uint64_t num_els, hashmap_hash_function hash_function) {
-    h->nodes = (hashmap_node**)calloc(num_els, sizeof(hashmap_node*));
+    return hashmap_init_arena(h, num_els, hash_function, NULL);
+}
+
+int hashmap_init_arena(HashMap *h, uint64_t num_els, hashmap_hash_function hash_function, Arena *arena) {
+    int r = hashmap_init_length(h, num_els, NULL, arena);
+    h->hash_function = hash_function;
+    return r;
+}
+
+int hashmap_init_length(HashMap *h, uint64_t num_els, hashmap_hash_length_function hash_function, Arena *arena) {
+    uint64_t number_nodes = MIN_NUMBER_NODES;
+    while (number_nodes < num_els) {
+        number_nodes <<= 1;
+    }
+    if (arena != NULL) {
+        h->nodes = (hashmap_node*)arena_calloc(arena, number_nodes, sizeof(hashmap_node));
+    } else {
+        h->nodes = (hashmap_node*)calloc(number_nodes, sizeof(hashmap_node));
+    }
     if (h->nodes == NULL) {return HASHMAP_FAILURE;}
-    h->number_nodes = num_els;
+    h->number_nodes = number_nodes;
     h->used_nodes = 0;
-    h->hash_function = (hash_function == NULL) ? &default_hash : hash_function;
+    h->hash_function = NULL;
+    h->hash_length_function = (hash_function == NULL) ? &default_hash : hash_function;
+    h->arena = arena;
+    h->borrowed_keys = 0;
     return HASHMAP_SUCCESS;
 }
 
 void hashmap_destroy(HashMap *h) {
     hashmap_clear(h);
-    free(h->nodes);
-    h->used_nodes = 0;
+    if (h->arena == NULL) {
+        free(h->nodes);
+    }
+    h->nodes = NULL;
+    h->number_nodes = 0;
     h->hash_function = NULL;
+    h->hash_length_function = NULL;
 }
 
 void hashmap_clear(HashMap *h) {
     uint64_t i;
     for (i = 0; i < h->number_nodes; ++i) {
-        if (h->nodes[i] != NULL) {
-            free(h->nodes[i]->key);
-            if (h->nodes[i]->mallocd == 0) {
-                free(h->nodes[i]->value);
+        if (h->nodes[i].distance != 0) {
+            if (h->nodes[i].mallocd == 0) {
+                free(h->nodes[i].value);
             }
-            free(h->nodes[i]);
-            h->nodes[i] = NULL;
+            __free_node(h, &h->nodes[i]);
+            memset(&h->nodes[i], 0, sizeof(hashmap_node));
         }
     }
     h->used_nodes = 0;
 }
 
 void* hashmap_set(HashMap *h, const char *key, void *value) {
-    return __hashmap_set(h, key, value, -1);
+    size_t length = strlen(key);
+    return __hashmap_set(h, key, length, __hash(h, key, length), value, -1);
+}
+
+void* hashmap_set_hashed(HashMap *h, const char *key, size_t length, uint64_t hash, void *value) {
+    return __hashmap_set(h, key, length, hash, value, -1);
 }
 
 void* hashmap_set_alt(HashMap *h, const char *key, void * value) {
-    return __hashmap_set(h, key, value, 0);
+    size_t length = strlen(key);
+    return __hashmap_set(h, key, length, __hash(h, key, length), value, 0);
 }
 
 void* hashmap_get(HashMap *h, const char *key) {
-    uint64_t i, hash = h->hash_function(key);
-    int e;
-    i = hash % h->number_nodes;
-    return __get_node(h, key, hash, &i, &e);
+    size_t length = strlen(key);
+    hashmap_node *node = __get_node(h, key, length, __hash(h, key, length));
+    return (node != NULL) ? node->value : NULL;
+}
+
+void* hashmap_get_hashed(HashMap *h, const char *key, size_t length, uint64_t hash) {
+    hashmap_node *node = __get_node(h, key, length, hash);
+    return (node != NULL) ? node->value : NULL;
+}
+
+uint64_t hashmap_default_hash_length(const char *key, size_t length) {
+    return default_hash(key, length);
+}
+
+uint64_t hashmap_default_hash(const char *key) {
+    return default_hash(key, strlen(key));
+}
+
+uint64_t hashmap_fnv1a_hash(const char *key) { // FNV-1a hash (http://www.isthe.com/chongo/tech/comp/fnv/)
+    int i, len = strlen(key);
+    uint64_t h = 14695981039346656037ULL; // FNV_OFFSET 64 bit
+    for (i = 0; i < len; ++i){
+        h = h ^ (unsigned char) key[i];
+        h = h * 1099511628211ULL; // FNV_PRIME 64 bit
+    }
+    return h;
 }
 
 void* hashmap_remove(HashMap *h, const char *key) {
-    uint64_t i, hash = h->hash_function(key);
-    i = hash % h->number_nodes;
-    int e;
-    void* ret = __get_node(h, key, hash, &i, &e);
-    if (ret != NULL) {
-        free(h->nodes[i]->key);
-        if (h->nodes[i]->mallocd == 0) {
-            free(h->nodes[i]->value);
-            ret = NULL;
-        }
-        free(h->nodes[i]);
-        h->nodes[i] = NULL;
-        h->used_nodes--;
-        __relayout_nodes(h, i, 0);
+    size_t length = strlen(key);
+    hashmap_node *node = __get_node(h, key, length, __hash(h, key, length));
+    if (node == NULL) {
+        return NULL;
+    }
+    void* ret = node->value;
+    if (node->mallocd == 0) {
+        free(node->value);
+        ret = NULL;
     }
+    __free_node(h, node);
+    __remove_node(h, node);
     return ret;
 }
 
@@ -111,10 +175,9 @@ void hashmap_stats(HashMap *h) {
     unsigned int hc, ic;
     __calc_stats(h, &wc, &max, &avg, &avg_used, &hc, &ic);
     /* size is the size of a single hashmap
-       plus the size of the array of pointers
-       plus the size of the number of allocated nodes
+       plus the size of the array of nodes
        NOTE: this does NOT include the key and value sizes */
-    uint64_t size = sizeof(HashMap) + (sizeof(hashmap_node*) * h->number_nodes) + (sizeof(hashmap_node) * h->used_nodes);
+    uint64_t size = sizeof(HashMap) + (sizeof(hashmap_node) * h->number_nodes);
     printf("HashMap:\n\
     Number Nodes: %" PRIu64 "\n\
     Used Nodes: %" PRIu64 "\n\
@@ -129,14 +192,18 @@ void hashmap_stats(HashMap *h) {
     __get_fullness(h) * 100.0, avg, avg_used, max, wc, hc, ic, size);
 }
 
+void hashmap_set_counters(HashMapCounters *c) {
+    counters = c;
+}
+
 char** hashmap_keys(HashMap *h) {
     char** keys = (char**)calloc(h->used_nodes, sizeof(char*));
     uint64_t i, j = 0;
     for (i = 0; i < h->number_nodes; ++i) {
-        if (h->nodes[i] != NULL) {
-            int len = strlen(h->nodes[i]->key);
+        if (h->nodes[i].distance != 0) {
+            int len = h->nodes[i].length;
             keys[j] = (char*)calloc(len + 1, sizeof(char));
-            memcpy(keys[j], h->nodes[i]->key, len);
+            memcpy(keys[j], h->nodes[i].key, len);
             ++j;
         }
     }
@@ -150,144 +217,265 @@ char** hashmap_keys(HashMap *h) {
 int* hashmap_set_int(HashMap *h, const char *key, int value) {
     int *ptr = (int*)malloc(sizeof(int));
     *ptr = value;
-    return (int*)__hashmap_set(h, key, (void*)ptr, 0);
+    return (int*)hashmap_set_alt(h, key, (void*)ptr);
 }
 
 long* hashmap_set_long(HashMap *h, const char *key, long value) {
     long *ptr = (long*)malloc(sizeof(long));
     *ptr = value;
-    return (long*)__hashmap_set(h, key, (void*)ptr, 0);
+    return (long*)hashmap_set_alt(h, key, (void*)ptr);
 }
 
 char* hashmap_set_string(HashMap *h, const char *key, char *value) {
     int len = strlen(value);
     char *ptr = (char*)calloc(len + 1, sizeof(char));
     memcpy(ptr, value, len);
-    return (char*)__hashmap_set(h, key, (void*)ptr, 0);
+    return (char*)hashmap_set_alt(h, key, (void*)ptr);
 }
 
 float* hashmap_set_float(HashMap *h, const char *key, float value) {
     float *ptr = (float*)malloc(sizeof(float));
     *ptr = value;
-    return (float*)__hashmap_set(h, key, (void*)ptr, 0);
+    return (float*)hashmap_set_alt(h, key, (void*)ptr);
 }
 
 double* hashmap_set_double(HashMap *h, const char *key, double value) {
     double *ptr = (double*)malloc(sizeof(double));
     *ptr = value;
-    return (double*)__hashmap_set(h, key, ptr, 0);
+    return (double*)hashmap_set_alt(h, key, ptr);
 }
 
 /*******************************************************************************
 ***        PRIVATE FUNCTIONS
 *******************************************************************************/
-static uint64_t default_hash(const char *key) { // FNV-1a hash (http://www.isthe.com/chongo/tech/comp/fnv/)
-    int i, len = strlen(key);
-    uint64_t h = 14695981039346656037ULL; // FNV_OFFSET 64 bit
-    for (i = 0; i < len; ++i){
-        h = h ^ (unsigned char) key[i];
-        h = h * 1099511628211ULL; // FNV_PRIME 64 bit
+/*  wyhash (final version 4, https://github.com/wangyi-fudan/wyhash) reading
+    the key 8 bytes at a time; keys are read in host byte order so hashes are
+    only comparable on machines of the same endianness */
+static const uint64_t wyp[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+static inline void __wymum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t __wymix(uint64_t a, uint64_t b) {
+    __wymum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t __wyr8(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t __wyr4(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t __wyr3(const uint8_t *p, size_t k) {
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+static uint64_t default_hash(const char *key, size_t length) {
+    const uint8_t *p = (const uint8_t*)key;
+    uint64_t seed = __wymix(wyp[0], wyp[1]);
+    uint64_t a, b;
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (__wyr4(p) << 32) | __wyr4(p + ((length >> 3) << 2));
+            b = (__wyr4(p + length - 4) << 32) | __wyr4(p + length - 4 - ((length >> 3) << 2));
+        } else if (length > 0) {
+            a = __wyr3(p, length);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = length;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = __wymix(__wyr8(p) ^ wyp[1], __wyr8(p + 8) ^ seed);
+                see1 = __wymix(__wyr8(p + 16) ^ wyp[2], __wyr8(p + 24) ^ see1);
+                see2 = __wymix(__wyr8(p + 32) ^ wyp[3], __wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = __wymix(__wyr8(p) ^ wyp[1], __wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = __wyr8(p + i - 16);
+        b = __wyr8(p + i - 8);
     }
-    return h;
+    a ^= wyp[1];
+    b ^= seed;
+    __wymum(&a, &b);
+    return __wymix(a ^ wyp[0] ^ length, b ^ wyp[1]);
+}
+
+static inline uint64_t __hash(HashMap *h, const char *key, size_t length) {
+    if (h->hash_function != NULL) {
+        return h->hash_function(key);
+    }
+    return h->hash_length_function(key, length);
 }
 
+/* rehash all nodes into a new array, in a single pass */
 static int  __allocate_hashmap(HashMap *h, uint64_t num_els) {
-    hashmap_node** tmp = (hashmap_node**)realloc(h->nodes, num_els * sizeof(hashmap_node*));
+    hashmap_node* tmp;
+    if (h->arena != NULL) {
+        tmp = (hashmap_node*)arena_calloc(h->arena, num_els, sizeof(hashmap_node));
+    } else {
+        tmp = (hashmap_node*)calloc(num_els, sizeof(hashmap_node));
+    }
     if (tmp == NULL) {return HASHMAP_FAILURE;}
+    COUNTER_ADD(resizes, 1);
+    hashmap_node* nodes = h->nodes;
+    uint64_t number_nodes = h->number_nodes;
     h->nodes = tmp;
-    uint64_t orig_num_els = h->number_nodes;
-    for (uint64_t i = orig_num_els; i < num_els; ++i) {
-        h->nodes[i] = NULL;
-    }
     h->number_nodes = num_els;
-    int q = 0;
-    // TODO: The math to see if this ever needs to be done more than once
-    while (q == 0) {
-        q = __relayout_nodes(h, 0, 1);
+    for (uint64_t i = 0; i < number_nodes; ++i) {
+        if (nodes[i].distance != 0) {
+            __insert_node(h, &nodes[i]);
+        }
+    }
+    if (h->arena == NULL) {
+        free(nodes);
     }
     return HASHMAP_SUCCESS;
 }
 
-static int __relayout_nodes(HashMap *h, uint64_t loc, short end_on_null) {
-    int moved_one = 1;
-    uint64_t i;
-    for (i = loc; i < h->number_nodes; ++i) {
-        if(h->nodes[i] != NULL) {
-            uint64_t id;
-            int error;
-            // ignore the return since we do not need it
-            __get_node(h, h->nodes[i]->key, h->nodes[i]->hash, &id, &error);
-
-            if (id != i) {
-                moved_one = 0;
-                h->nodes[id] = h->nodes[i];
-                h->nodes[i] = NULL;
-            }
-        } else if (end_on_null == 0 && i != loc) {
-            break;
+static hashmap_node* __get_node(HashMap *h, const char *key, size_t length, uint64_t hash) {
+    uint64_t mask = h->number_nodes - 1;
+    uint64_t i = hash & mask;
+    uint32_t distance = 1;
+    while (1) {
+        hashmap_node *node = &h->nodes[i];
+        // robin-hood: the key would have displaced any node closer to its home
+        if (node->distance < distance) {
+            COUNTER_LOOKUP(distance);
+            return NULL;
+        }
+        if (node->hash == hash && node->length == length
+                && memcmp(key, node->key, length) == 0) {
+            COUNTER_LOOKUP(distance);
+            return node;
         }
+        i = (i + 1) & mask;
+        ++distance;
     }
-    return moved_one;
 }
 
-static void* __get_node(HashMap *h, const char *key, uint64_t hash, uint64_t *i, int *error) {
-    *error = 0; // no errors
-    uint64_t idx = *i = hash % h->number_nodes;
-    size_t len = strlen(key);
-    while (1) {
-        if (h->nodes[*i] == NULL) { //not found
-            return NULL;
-        } else if (h->nodes[*i]->hash == hash && len == strlen(h->nodes[*i]->key) && strncmp(key, h->nodes[*i]->key, len) == 0) {
-            return  h->nodes[*i]->value;
-        } else {
-            // lets see if we need to continue or if we have already gone all the way around
-            *i = (*i + 1 == h->number_nodes) ? 0 : *i + 1;
-            if (*i == idx) {    // This can only have this happen if there are NO open locations
-                *error = -1;    // which signifies that the hashmap is full
-                return NULL;
-            }
+/* insert a node which is not in the map, there must be an empty slot */
+static void  __insert_node(HashMap *h, hashmap_node *node) {
+    uint64_t mask = h->number_nodes - 1;
+    uint64_t i = node->hash & mask;
+    hashmap_node insert = *node;
+    insert.distance = 1;
+    while (h->nodes[i].distance != 0) {
+        if (h->nodes[i].distance < insert.distance) {
+            // take the slot from the richer node, then place that node
+            hashmap_node tmp = h->nodes[i];
+            h->nodes[i] = insert;
+            insert = tmp;
+            COUNTER_ADD(relayouts, 1);
         }
+        i = (i + 1) & mask;
+        ++insert.distance;
     }
+    h->nodes[i] = insert;
 }
 
-static void* __hashmap_set(HashMap *h, const char *key, void *value, short mallocd) {
-    // check to see if we need to expand the hashmap
-    if (__get_fullness(h) >= MAX_FULLNESS_PERCENT) {
-        uint64_t num_nodes = h->number_nodes;
-        __allocate_hashmap(h, num_nodes * 2);
+/* backward shift deletion, the following nodes move one slot closer to home */
+static void  __remove_node(HashMap *h, hashmap_node *node) {
+    uint64_t mask = h->number_nodes - 1;
+    uint64_t i = node - h->nodes;
+    uint64_t next = (i + 1) & mask;
+    while (h->nodes[next].distance > 1) {
+        h->nodes[i] = h->nodes[next];
+        --h->nodes[i].distance;
+        COUNTER_ADD(relayouts, 1);
+        i = next;
+        next = (next + 1) & mask;
     }
-    // get the hash value
-    uint64_t hash = h->hash_function(key);  // TODO: move out of this function to better parallelize
-    uint64_t i;
-    int error;
-    void * tmp = __get_node(h, key, hash, &i, &error);
-    if (tmp == NULL && error == -1) {
-        fprintf(stderr, "Error: Unable to insert due to the hashmap being full\n");
-        return NULL;
-    } else  if (tmp != NULL) {
-        if (h->nodes[i]->mallocd != 0) {
-            void* v = h->nodes[i]->value;
-            h->nodes[i]->value = value;
+    memset(&h->nodes[i], 0, sizeof(hashmap_node));
+    --h->used_nodes;
+}
+
+static void* __hashmap_set(HashMap *h, const char *key, size_t length, uint64_t hash, void *value, short mallocd) {
+    hashmap_node *tmp = __get_node(h, key, length, hash);
+    if (tmp != NULL) {
+        if (h->borrowed_keys) {
+            tmp->key = (char*)key;  // the previous key may not outlive its value
+        }
+        if (tmp->mallocd != 0) {
+            void* v = tmp->value;
+            tmp->value = value;
             return v;
         } else {
-            free(h->nodes[i]->value);
-            h->nodes[i]->value = value;
+            free(tmp->value);
+            tmp->value = value;
         }
+        return value;
+    }
+
+    // check to see if we need to expand the hashmap
+    if ((h->used_nodes + 1) * MAX_FULLNESS_DENOMINATOR > h->number_nodes * MAX_FULLNESS_NUMERATOR) {
+        if (__allocate_hashmap(h, h->number_nodes * 2) != HASHMAP_SUCCESS) {
+            fprintf(stderr, "Error: Unable to insert due to the hashmap being full\n");
+            return NULL;
+        }
+    }
+    hashmap_node node;
+    if (h->borrowed_keys) {
+        node.key = (char*)key;
     } else {
-        __assign_node(h, key, value, mallocd, i, hash);
+        if (h->arena != NULL) {
+            node.key = (char*)arena_alloc(h->arena, length + 1);
+        } else {
+            node.key = (char*)malloc(length + 1);
+        }
+        if (node.key == NULL) {
+            return NULL;
+        }
+        memcpy(node.key, key, length);
+        node.key[length] = '\0';
     }
+    node.value = value;
+    node.hash = hash;
+    node.length = length;
+    node.mallocd = mallocd;
+    __insert_node(h, &node);
+    ++h->used_nodes;
     return value;
 }
 
-static void  __assign_node(HashMap *h, const char *key, void *value, short mallocd, uint64_t i, uint64_t hash) {
-    int len = strlen(key);
-    h->nodes[i] = (hashmap_node*)malloc(sizeof(hashmap_node));
-    h->nodes[i]->key = (char*)calloc(len + 1, sizeof(char));
-    memcpy(h->nodes[i]->key, key, len);
-    h->nodes[i]->value = value;
-    h->nodes[i]->hash = hash;
-    h->nodes[i]->mallocd = mallocd;
-    ++h->used_nodes;
+static void  __free_node(HashMap *h, hashmap_node *node) {
+    if (h->arena != NULL || h->borrowed_keys) {
+        return;  // released with the arena, or owned by the caller
+    }
+    free(node->key);
 }
 
 static inline float __get_fullness(HashMap *h) {
@@ -302,17 +490,16 @@ static void __calc_stats(HashMap *h, uint64_t *worst_case, uint64_t *max_big_o,
         uint64_t *hashes = (uint64_t*)calloc(h->used_nodes, sizeof(uint64_t));
         uint64_t *idxs = (uint64_t*)calloc(h->used_nodes, sizeof(uint64_t));
         for (uint64_t i = 0; i < h->number_nodes; ++i) {
-            if (h->nodes[i] != NULL) {
+            if (h->nodes[i].distance != 0) {
                 ++cur;
-                uint64_t _idx = h->nodes[i]->hash % h->number_nodes;
-                uint64_t O = __calc_big_o(h->number_nodes, i, _idx);
+                uint64_t O = h->nodes[i].distance;
                 sum_used += O;
                 sum += O;
                 if (O > max) {
                     max = O;
                 }
-                hashes[j] = h->nodes[i]->hash;
-                idxs[j] = _idx;
+                hashes[j] = h->nodes[i].hash;
+                idxs[j] = h->nodes[i].hash & (h->number_nodes - 1);
                 ++j;
             } else {
                 sum += 1;
@@ -320,6 +507,7 @@ static void __calc_stats(HashMap *h, uint64_t *worst_case, uint64_t *max_big_o,
                 cur = 0;
             }
         }
+        if (wc < cur) { wc = cur; }
 
         // sort the results
         __merge_sort(hashes, h->used_nodes);
@@ -351,10 +539,6 @@ static void __calc_stats(HashMap *h, uint64_t *worst_case, uint64_t *max_big_o,
     *idx = idx_col;
 }
 
-static inline int __calc_big_o(uint64_t num_nodes, uint64_t i, uint64_t idx) {
-    return (i < idx) ? i + num_nodes - idx + 1 : 1 + i - idx;
-}
-
 static void __merge_sort(uint64_t *arr, uint64_t length) {
     if (length < 2) {
         return;
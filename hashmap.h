@@ -19,6 +19,8 @@ extern "C" {
 #endif
 
 #include <inttypes.h>       /* PRIu64 */
+#include <stddef.h>         /* size_t */
+#include <arena.h>
 
 #ifdef __APPLE__
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -42,6 +44,7 @@ extern "C" {
 
 
 typedef uint64_t (*hashmap_hash_function) (const char *key);
+typedef uint64_t (*hashmap_hash_length_function) (const char *key, size_t length);
 
 /*******************************************************************************
 ***    Data structures
@@ -50,19 +53,48 @@ typedef struct hashmap_node {
     char *key;
     void *value;
     uint64_t hash;
+    uint32_t length;   /* of the key, compared before the key itself */
+    uint32_t distance; /* probe distance + 1 from the home slot, 0 when empty */
     short mallocd; /* signals if need to deallocate the memory */
 } hashmap_node;
 
+/*  open addressing with robin-hood probing, nodes are stored inline and
+    number_nodes is a power of two */
 typedef struct hashmap {
-    hashmap_node **nodes;
+    hashmap_node *nodes;
     uint64_t number_nodes;
     uint64_t used_nodes;
-    hashmap_hash_function hash_function;
+    hashmap_hash_function hash_function;    /* a custom hash (hashmap_init_alt) */
+    hashmap_hash_length_function hash_length_function;  /* otherwise, length aware */
+    Arena *arena;   /* if set, nodes and keys are allocated from the arena */
+    short borrowed_keys;    /* if set, keys are referenced rather than copied
+                               and must outlive the hashmap */
 } HashMap;
 
 
-/* initialize the hashmap using the provided hashing function */
+/*  operation counters, collected for the threads which set them (see
+    hashmap_set_counters) */
+typedef struct hashmap_counters {
+    uint64_t resizes;       /* rehashes by __allocate_hashmap */
+    uint64_t relayouts;     /* nodes displaced by inserts or shifted by removals */
+    uint64_t lookups;       /* calls to __get_node */
+    uint64_t probes;        /* buckets visited by lookups */
+    uint64_t max_probe;     /* the longest lookup */
+} HashMapCounters;
+
+
+/*  initialize the hashmap using the provided hashing function, the length
+    aware hashmap_default_hash_length is used when it is NULL */
 int hashmap_init_alt(HashMap *h,  uint64_t num_els, hashmap_hash_function hash_function);
+
+/*  initialize the hashmap using a length aware hashing function (which saves
+    a strlen when the caller already knows the key length) */
+int hashmap_init_length(HashMap *h, uint64_t num_els, hashmap_hash_length_function hash_function, Arena *arena);
+
+/*  initialize the hashmap with storage allocated from an arena; the bucket
+    array, nodes and key copies are then released with the arena and
+    hashmap_destroy only releases values marked for de-allocation */
+int hashmap_init_arena(HashMap *h, uint64_t num_els, hashmap_hash_function hash_function, Arena *arena);
 static __inline__ int hashmap_init(HashMap *h) {
     return hashmap_init_alt(h, 1024, NULL);
 }
@@ -80,6 +112,10 @@ void hashmap_clear(HashMap *h);
     pointer to the new value. Returns NULL if there is an error. */
 void* hashmap_set(HashMap *h, const char *key, void *value);
 
+/*  As hashmap_set, with the length and hash of the key already calculated
+    (using the hash function of the hashmap) */
+void* hashmap_set_hashed(HashMap *h, const char *key, size_t length, uint64_t hash, void *value);
+
 /*  Adds the key to the hashmap or updates the key if already present. Also
     signals to the system to do a simple 'free' command on the value on
     destruction. */
@@ -88,6 +124,18 @@ void* hashmap_set_alt(HashMap *h, const char *key, void * value);
 /* Returns the pointer to the value of the found key, or NULL if not found */
 void* hashmap_get(HashMap *h, const char *key);
 
+/*  As hashmap_get, with the length and hash of the key already calculated
+    (using the hash function of the hashmap) */
+void* hashmap_get_hashed(HashMap *h, const char *key, size_t length, uint64_t hash);
+
+/*  The hash function used when none is provided, a word at a time hash
+    (wyhash); hashmap_default_hash(key) is the same hash of strlen(key) bytes */
+uint64_t hashmap_default_hash_length(const char *key, size_t length);
+uint64_t hashmap_default_hash(const char *key);
+
+/* The previous default, byte at a time FNV-1a, for use with hashmap_init_alt */
+uint64_t hashmap_fnv1a_hash(const char *key);
+
 /*  Removes a key from the hashmap. NULL will be returned if it is not present.
     If it is designated to be cleaned up, the memory will be free'd and NULL
     returned. Otherwise, the pointer to the value will be returned.
@@ -102,6 +150,10 @@ char** hashmap_keys(HashMap *h);
 /* Prints out some basic stats about the hashmap */
 void hashmap_stats(HashMap *h);
 
+/*  Count the operations of the calling thread in c (which must outlive its
+    use by the thread), or stop counting when c is NULL */
+void hashmap_set_counters(HashMapCounters *c);
+
 /*  Easily add an int, this will malloc everything for the user and will signal
     to de-allocate the memory on destruction */
 int* hashmap_set_int(HashMap *h, const char *key, int value);
@@ -15,59 +15,417 @@ MIT License
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <yaml.h>
 #include <simple_yaml.h>
 
 
-SimpleYamlNode* simple_yaml_create_node(char* name, SimpleYamlNode* parent)
+
+
+static uint32_t mapping_index_threshold = SIMPLE_YAML_MAPPING_INDEX_THRESHOLD;
+
+
+#ifdef SIMPLE_YAML_STATS
+static __thread SimpleYamlStats stats;
+static __thread HashMapCounters hashmap_counters;
+#define STATS_ADD(field, n)     (stats.field += (n))
+/* The HashMap operations of a thread are counted once it parses (or reads
+its stats). */
+#define STATS_THREAD()          hashmap_set_counters(&hashmap_counters)
+
+static inline uint64_t __stats_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#else
+#define STATS_ADD(field, n)     ((void)0)
+#define STATS_THREAD()          ((void)0)
+#endif
+
+
+void simple_yaml_stats_get(SimpleYamlStats* s)
+{
+    memset(s, 0, sizeof(SimpleYamlStats));
+#ifdef SIMPLE_YAML_STATS
+    STATS_THREAD();
+    *s = stats;
+    s->hashmap_resizes = hashmap_counters.resizes;
+    s->hashmap_relayouts = hashmap_counters.relayouts;
+    s->hashmap_lookups = hashmap_counters.lookups;
+    s->hashmap_probes = hashmap_counters.probes;
+    s->hashmap_max_probe = hashmap_counters.max_probe;
+#endif
+}
+
+void simple_yaml_stats_reset(void)
+{
+#ifdef SIMPLE_YAML_STATS
+    STATS_THREAD();
+    memset(&stats, 0, sizeof(SimpleYamlStats));
+    memset(&hashmap_counters, 0, sizeof(HashMapCounters));
+#endif
+}
+
+
+void simple_yaml_set_mapping_index_threshold(uint32_t threshold)
+{
+    mapping_index_threshold = threshold;
+}
+
+uint32_t simple_yaml_get_mapping_index_threshold(void)
+{
+    return mapping_index_threshold;
+}
+
+/* When interned is set, key and all the keys of the mapping are interned, and
+so are only compared by pointer. */
+static SimpleYamlMappingEntry* __mapping_find(SimpleYamlMapping* mapping,
+        const char* key, size_t length, bool interned)
+{
+    for (uint32_t i = 0; i < mapping->count; i++) {
+        SimpleYamlMappingEntry* entry = &mapping->entries[i];
+        if (entry->key == key) return entry;
+        if (interned || entry->length != length) continue;
+        if (memcmp(entry->key, key, length) == 0) return entry;
+    }
+    return NULL;
+}
+
+static int __mapping_build_index(SimpleYamlNode* node)
+{
+    SimpleYamlMapping* mapping = &node->mapping;
+    HashMap* index;
+    if (node->arena) {
+        index = arena_alloc(node->arena, sizeof(HashMap));
+    } else {
+        index = malloc(sizeof(HashMap));
+    }
+    if (index == NULL) return ENOMEM;
+    /* The HashMap doubles once it is 3/4 full, start with room. */
+    uint64_t size = 16;
+    while (size < (uint64_t)mapping->count * 2) size *= 2;
+    if (hashmap_init_arena(index, size, NULL, node->arena) != HASHMAP_SUCCESS) {
+        if (node->arena == NULL) free(index);
+        return ENOMEM;
+    }
+    /* Keys are owned by the child nodes (or the interning table). */
+    index->borrowed_keys = 1;
+    bool interned = (node->flags & SIMPLE_YAML_NODE_KEYS_INTERNED);
+    for (uint32_t i = 0; i < mapping->count; i++) {
+        SimpleYamlMappingEntry* entry = &mapping->entries[i];
+        if (interned) {
+            hashmap_set_hashed(index, entry->key, entry->length,
+                    simple_yaml_keys_hash(entry->key), entry->node);
+        } else {
+            hashmap_set_hashed(index, entry->key, entry->length,
+                    hashmap_default_hash_length(entry->key, entry->length),
+                    entry->node);
+        }
+    }
+    mapping->index = index;
+    return 0;
+}
+
+static int __mapping_append(SimpleYamlNode* node, const char* key,
+        size_t length, uint64_t hash, SimpleYamlNode* child)
+{
+    SimpleYamlMapping* mapping = &node->mapping;
+    if (mapping->count == mapping->capacity) {
+        uint32_t capacity = mapping->capacity ? mapping->capacity * 2 : 4;
+        SimpleYamlMappingEntry* entries;
+        if (node->arena) {
+            entries = arena_realloc(node->arena, mapping->entries,
+                    mapping->capacity * sizeof(SimpleYamlMappingEntry),
+                    capacity * sizeof(SimpleYamlMappingEntry));
+        } else {
+            entries = realloc(mapping->entries,
+                    capacity * sizeof(SimpleYamlMappingEntry));
+        }
+        if (entries == NULL) return ENOMEM;
+        mapping->entries = entries;
+        mapping->capacity = capacity;
+    }
+    SimpleYamlMappingEntry* entry = &mapping->entries[mapping->count++];
+    entry->key = key;
+    entry->length = length;
+    entry->node = child;
+
+    /* Maintain, or create, the hashed index. On error the entry is removed,
+    the mapping is unchanged. */
+    int rc = 0;
+    if (mapping->index) {
+        if (hashmap_set_hashed(mapping->index, key, length, hash, child) == NULL) {
+            rc = ENOMEM;
+        }
+    } else if (mapping->count > mapping_index_threshold) {
+        rc = __mapping_build_index(node);
+    }
+    if (rc) mapping->count--;
+    return rc;
+}
+
+/* The key is the name of child, or a copy owned by the mapping when child is
+shared (an alias). A duplicate key replaces the node of the existing entry. */
+static int __mapping_put(SimpleYamlNode* node, const char* key,
+        bool interned, SimpleYamlNode* child)
+{
+    SimpleYamlMapping* mapping = &node->mapping;
+    size_t length = interned ? simple_yaml_keys_length(key) : strlen(key);
+    uint64_t hash = 0;
+    if (interned) {
+        hash = simple_yaml_keys_hash(key);
+        if (mapping->count == 0) node->flags |= SIMPLE_YAML_NODE_KEYS_INTERNED;
+    } else {
+        node->flags &= ~SIMPLE_YAML_NODE_KEYS_INTERNED;
+        if (mapping->index) hash = hashmap_default_hash_length(key, length);
+    }
+    interned = (node->flags & SIMPLE_YAML_NODE_KEYS_INTERNED);
+
+    /* Duplicate key, the new node replaces the existing node. */
+    SimpleYamlMappingEntry* entry = NULL;
+    if (mapping->index == NULL
+            || hashmap_get_hashed(mapping->index, key, length, hash)) {
+        entry = __mapping_find(mapping, key, length, interned);
+    }
+    if (entry) {
+        SimpleYamlNode* replaced = entry->node;
+        const char* replaced_key = entry->key;
+        entry->key = key;
+        entry->node = child;
+        if (mapping->index) {
+            hashmap_set_hashed(mapping->index, key, length, hash, child);
+        }
+        if (node->arena == NULL && replaced_key != replaced->name) {
+            free((char*)replaced_key);
+        }
+        simple_yaml_destroy_node(replaced);
+        return 0;
+    }
+    return __mapping_append(node, key, length, hash, child);
+}
+
+static int __mapping_set(SimpleYamlNode* node, SimpleYamlNode* child)
+{
+    return __mapping_put(node, child->name,
+            child->flags & SIMPLE_YAML_NODE_NAME_INTERNED, child);
+}
+
+/* Merge keys (<<) are kept as entries, in document order, and are not
+replaced by later merge keys. The keys of the merged mappings are found by
+lookups (on a miss), they are not copied. */
+static int __mapping_merge(
+        SimpleYamlNode* node, const char* key, SimpleYamlNode* child)
 {
-    SimpleYamlNode* node = calloc(1, sizeof(SimpleYamlNode));
+    uint64_t hash = 0;
+    node->flags &= ~SIMPLE_YAML_NODE_KEYS_INTERNED;
+    node->flags |= SIMPLE_YAML_NODE_MERGE;
+    if (node->mapping.index) hash = hashmap_default_hash_length(key, 2);
+    return __mapping_append(node, key, 2, hash, child);
+}
+
+static bool __is_merge_entry(const SimpleYamlMappingEntry* entry)
+{
+    return entry->length == 2 && memcmp(entry->key, "<<", 2) == 0;
+}
+
+static SimpleYamlNode* __mapping_lookup(SimpleYamlNode* node,
+        const char* key, size_t length, uint64_t hash, bool hashed);
+
+/* Lookup a key in the merged mappings, in order (the first has priority). */
+static SimpleYamlNode* __merge_lookup(SimpleYamlNode* node,
+        const char* key, size_t length, uint64_t hash, bool hashed)
+{
+    SimpleYamlMapping* mapping = &node->mapping;
+    for (uint32_t i = 0; i < mapping->count; i++) {
+        SimpleYamlMappingEntry* entry = &mapping->entries[i];
+        if (!__is_merge_entry(entry)) continue;
+        SimpleYamlNode* merge = entry->node;
+        SimpleYamlNode* found = NULL;
+        if (merge->node_type == YAML_MAPPING_NODE) {
+            found = __mapping_lookup(merge, key, length, hash, hashed);
+        } else if (merge->node_type == YAML_SEQUENCE_NODE) {
+            for (uint32_t j = 0; !found && j < hashlist_length(&merge->sequence); j++) {
+                SimpleYamlNode* item = hashlist_get_at(&merge->sequence, j);
+                if (item->node_type != YAML_MAPPING_NODE) continue;
+                found = __mapping_lookup(item, key, length, hash, hashed);
+            }
+        }
+        if (found) return found;
+    }
+    return NULL;
+}
+
+/* Lookup a key of a mapping, hash is calculated (if required) unless hashed
+is set. */
+static SimpleYamlNode* __mapping_lookup(SimpleYamlNode* node,
+        const char* key, size_t length, uint64_t hash, bool hashed)
+{
+    SimpleYamlMapping* mapping = &node->mapping;
+    SimpleYamlNode* found;
+    if (mapping->index) {
+        if (!hashed) hash = hashmap_default_hash_length(key, length);
+        hashed = true;
+        found = hashmap_get_hashed(mapping->index, key, length, hash);
+    } else {
+        SimpleYamlMappingEntry* entry = __mapping_find(
+                mapping, key, length, false);
+        found = entry ? entry->node : NULL;
+    }
+    if (found || !(node->flags & SIMPLE_YAML_NODE_MERGE)) return found;
+    return __merge_lookup(node, key, length, hash, hashed);
+}
+
+SimpleYamlNode* simple_yaml_mapping_get(SimpleYamlNode* node, const char* key)
+{
+    if (node == NULL || node->node_type != YAML_MAPPING_NODE) return NULL;
+    return __mapping_lookup(node, key, strlen(key), 0, false);
+}
+
+uint32_t simple_yaml_mapping_length(SimpleYamlNode* node)
+{
+    if (node == NULL || node->node_type != YAML_MAPPING_NODE) return 0;
+    return node->mapping.count;
+}
+
+const SimpleYamlMappingEntry* simple_yaml_mapping_get_at(
+        SimpleYamlNode* node, uint32_t index)
+{
+    if (index >= simple_yaml_mapping_length(node)) return NULL;
+    return &node->mapping.entries[index];
+}
+
+/* An interned name is referenced, otherwise the name is copied. Returns NULL
+(with errno set) if the node can not be created, or added to parent. */
+static SimpleYamlNode* __create_node(
+        char* name, SimpleYamlNode* parent, Arena* arena, bool interned)
+{
+    SimpleYamlNode* node;
+    if (arena) {
+        node = arena_calloc(arena, 1, sizeof(SimpleYamlNode));
+    } else {
+        node = calloc(1, sizeof(SimpleYamlNode));
+    }
+    if (node == NULL) return NULL;
+    STATS_ADD(nodes, 1);
+    if (name && interned) {
+        node->name = name;
+        node->flags |= SIMPLE_YAML_NODE_NAME_INTERNED;
+    } else if (name) {
+        node->name = arena ? arena_strdup(arena, name) : strdup(name);
+        STATS_ADD(key_bytes, strlen(name) + 1);
+    }
     node->parent = parent;
+    node->arena = arena;
     node->node_type = YAML_NO_NODE;
-    if (name) node->name = strdup(name);
-    if (parent) {
+    int rc = (name && node->name == NULL) ? ENOMEM : 0;
+    if (rc == 0 && parent) {
         if (parent->node_type == YAML_MAPPING_NODE) {
             assert(node->name);
-            hashmap_set(&parent->mapping, node->name, node);
+            rc = __mapping_set(parent, node);
         } else if (parent->node_type == YAML_SEQUENCE_NODE) {
-            hashlist_append(&parent->sequence, node);
+            if (hashlist_append(&parent->sequence, node) != HASHMAP_SUCCESS) {
+                rc = ENOMEM;
+            }
         }
     }
+    if (rc) {
+        /* Arena nodes are released with their document. */
+        if (arena == NULL) simple_yaml_destroy_node(node);
+        errno = rc;
+        return NULL;
+    }
     return node;
 }
 
+SimpleYamlNode* simple_yaml_create_node(char* name, SimpleYamlNode* parent)
+{
+    /* Child nodes are allocated from the same storage as their parent. */
+    return __create_node(name, parent, parent ? parent->arena : NULL, false);
+}
+
+SimpleYamlNode* simple_yaml_create_root_node(Arena* arena)
+{
+    /* The root node takes ownership of the arena. */
+    return __create_node(NULL, NULL, arena, false);
+}
+
 void simple_yaml_set_mapping(SimpleYamlNode* node)
 {
     assert(node->node_type == YAML_NO_NODE);
     node->node_type = YAML_MAPPING_NODE;
-    hashmap_init(&node->mapping);
+    STATS_ADD(mappings, 1);
+    /* Entry storage is allocated with the first key. */
+    memset(&node->mapping, 0, sizeof(SimpleYamlMapping));
 }
 
 void simple_yaml_set_sequence(SimpleYamlNode* node)
 {
     assert(node->node_type == YAML_NO_NODE);
     node->node_type = YAML_SEQUENCE_NODE;
-    hashlist_init(&node->sequence);
+    STATS_ADD(sequences, 1);
+    hashlist_init_arena(&node->sequence, node->arena);
 }
 
 void simple_yaml_set_scalar(SimpleYamlNode* node, const char* value)
 {
     assert(node->node_type == YAML_NO_NODE);
     node->node_type = YAML_SCALAR_NODE;
-    node->value = strdup(value);
+    node->value_length = strlen(value);
+    STATS_ADD(scalars, 1);
+    STATS_ADD(scalar_bytes, node->value_length + 1);
+    if (node->arena) {
+        node->value = arena_strndup(node->arena, value, node->value_length);
+    } else {
+        node->value = strdup(value);
+    }
+}
+
+void simple_yaml_set_scalar_view(
+        SimpleYamlNode* node, const char* value, size_t length)
+{
+    assert(node->node_type == YAML_NO_NODE);
+    node->node_type = YAML_SCALAR_NODE;
+    node->flags |= SIMPLE_YAML_NODE_VALUE_VIEW;
+    STATS_ADD(scalars, 1);
+    STATS_ADD(scalar_views, 1);
+    node->value = (char*)value;
+    node->value_length = length;
 }
 
 void simple_yaml_destroy_node(SimpleYamlNode* node)
 {
     if (node == NULL) return;
+    /* A shared node (or document) is destroyed with its last reference. A
+document may be shared by doc_lists destroyed by different threads. */
+    uint32_t refs = __atomic_load_n(&node->refs, __ATOMIC_ACQUIRE);
+    while (refs) {
+        if (__atomic_compare_exchange_n(&node->refs, &refs, refs - 1, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return;
+    }
+    if (node->arena) {
+        /* Arena nodes are released, all at once, with their document. */
+        if (node->parent == NULL) arena_destroy(node->arena);
+        return;
+    }
     /* Destroy any contained nodes. */
     if (node->node_type == YAML_MAPPING_NODE) {
-        for (uint32_t i = 0; i < node->mapping.number_nodes; ++i) {
-            if (node->mapping.nodes[i]) {
-                simple_yaml_destroy_node(node->mapping.nodes[i]->value);
-            }
+        for (uint32_t i = 0; i < node->mapping.count; i++) {
+            SimpleYamlMappingEntry* entry = &node->mapping.entries[i];
+            /* Keys of aliases are owned by the entry. */
+            if (entry->key != entry->node->name) free((char*)entry->key);
+            simple_yaml_destroy_node(entry->node);
         }
-        hashmap_destroy(&node->mapping);
+        if (node->mapping.index) {
+            hashmap_destroy(node->mapping.index);
+            free(node->mapping.index);
+        }
+        free(node->mapping.entries);
     }
     if (node->node_type == YAML_SEQUENCE_NODE) {
         for (uint32_t i = 0; i < hashlist_length(&node->sequence); i++) {
@@ -76,232 +434,1386 @@ void simple_yaml_destroy_node(SimpleYamlNode* node)
         hashlist_destroy(&node->sequence);
     }
     /* Destroy _this_ node. */
-    free(node->name);
-    free(node->value);
+    if (!(node->flags & SIMPLE_YAML_NODE_NAME_INTERNED)) free(node->name);
+    if (!(node->flags & SIMPLE_YAML_NODE_VALUE_VIEW)) free(node->value);
     free(node);
 }
 
 HashList* simple_yaml_parse_file(const char* filename, HashList* doc_list)
 {
-    errno = 0;
+    return simple_yaml_parse_file_alt(filename, doc_list, NULL);
+}
 
-    /* Open the file containing the YAML stream. */
-    FILE *file_handle = fopen(filename, "r");
-    if (file_handle == NULL) {
-        if (errno==0) errno = EINVAL;
-        perror("Error opening file");
-        return doc_list;
+static SimpleYamlNode* __create_document(const SimpleYamlOptions* options)
+{
+    Arena* arena = NULL;
+    if (options && options->use_arena) {
+        arena = arena_create(options->arena_block_size);
+        if (arena == NULL) return NULL;
     }
+    SimpleYamlNode* doc = simple_yaml_create_root_node(arena);
+    if (doc == NULL) arena_destroy(arena);
+    return doc;
+}
 
-    /* Setup the YAML parser. */
-    yaml_parser_t parser;
-    if (!yaml_parser_initialize(&parser)) {
-        if (errno==0) errno = ECANCELED;
-        perror("Error initializing parser");
-        return doc_list;
+/* Selective parsing state, a position (segment) within a selected path. */
+typedef struct SelectState {
+    uint32_t                    path;
+    uint32_t                    segment;
+} SelectState;
+
+typedef struct SelectFrame {
+    uint32_t                    start;  /* States of the node (state stack). */
+    uint32_t                    count;
+    bool                        all;    /* Matched, select the entire node. */
+} SelectFrame;
+
+typedef struct AnchorEntry {
+    SimpleYamlNode*             node;
+    uint64_t                    size;   /* Nodes, when expanded. */
+} AnchorEntry;
+
+typedef struct AnchorFrame {
+    char*                       name;
+    SimpleYamlNode*             node;   /* The anchored collection. */
+    uint64_t                    start;  /* Expanded node count at the start. */
+} AnchorFrame;
+
+typedef struct SimpleYamlParser {
+    yaml_parser_t               parser;
+    const SimpleYamlOptions*    options;
+    /* Source buffer for zero-copy scalars (NULL when copying). */
+    const char*                 source;
+    size_t                      source_length;
+    /* libyaml marks count characters, track the byte offset of a mark. */
+    size_t                      mark_index;
+    size_t                      mark_offset;
+    /* Selective parsing, states of the collections being built. */
+    SimpleYamlPath**            select;
+    uint32_t                    select_count;
+    SelectState*                states;
+    uint32_t                    state_count;
+    uint32_t                    state_capacity;
+    SelectFrame*                frames;
+    uint32_t                    frame_count;
+    uint32_t                    frame_capacity;
+    SelectFrame                 pending;
+    /* Anchors of the current document, name -> index + 1 of the entry. An
+    entry holds a reference of its node, which a duplicate key may otherwise
+    destroy while the anchor can still be aliased. */
+    HashMap                     anchor_index;
+    bool                        anchor_index_init;
+    AnchorEntry*                anchors;
+    uint32_t                    anchor_count;
+    uint32_t                    anchor_capacity;
+    AnchorFrame*                anchor_frames;
+    uint32_t                    anchor_frame_count;
+    uint32_t                    anchor_frame_capacity;
+    uint64_t                    expanded;   /* Nodes, with aliases expanded. */
+    uint64_t                    aliased;    /* Nodes added by aliases. */
+    bool                        stream_end;
+#ifdef SIMPLE_YAML_STATS
+    uint64_t                    stats_clock;    /* End of the last event. */
+#endif
+} SimpleYamlParser;
+
+static void __parser_delete(SimpleYamlParser* p);
+static void __anchor_unset(SimpleYamlParser* p, const char* name);
+
+/* Parse the next event, time is split between libyaml (parsing) and the
+time since the previous event (building). */
+static int __next_event(SimpleYamlParser* p, yaml_event_t* event)
+{
+#ifdef SIMPLE_YAML_STATS
+    uint64_t start = __stats_clock();
+    stats.build_ns += start - p->stats_clock;
+    int rc = yaml_parser_parse(&p->parser, event);
+    p->stats_clock = __stats_clock();
+    stats.parse_ns += p->stats_clock - start;
+    stats.events++;
+    return rc;
+#else
+    return yaml_parser_parse(&p->parser, event);
+#endif
+}
+
+static void __parser_set_source(
+        SimpleYamlParser* p, const char* source, size_t length)
+{
+    p->source = source;
+    p->source_length = length;
+    p->mark_index = 0;
+    p->mark_offset = 0;
+    if (length >= 3 && memcmp(source, "\xEF\xBB\xBF", 3) == 0) {
+        p->mark_offset = 3;  /* The BOM is not counted by libyaml. */
+    } else if (length >= 2 && (source[0] == '\0' || source[1] == '\0'
+            || (unsigned char)source[0] == 0xFE
+            || (unsigned char)source[0] == 0xFF)) {
+        p->source = NULL;  /* UTF-16, scalars can not reference the source. */
     }
-    yaml_parser_set_input_file(&parser, file_handle);
+}
 
-    /* Create the document list for parsed YAML documents. */
-    if (doc_list == NULL) {
-        doc_list = calloc(1, sizeof(HashList));
-        if (doc_list == NULL) {
-            perror("Error creating document list");
-            return doc_list;  /* NULL */
+static size_t __source_offset(SimpleYamlParser* p, size_t index)
+{
+    if (index < p->mark_index) {
+        /* Marks only move forward, but be safe. */
+        __parser_set_source(p, p->source, p->source_length);
+    }
+    const unsigned char* s = (const unsigned char*)p->source;
+    while (p->mark_index < index && p->mark_offset < p->source_length) {
+        /* Step over one UTF-8 encoded character. */
+        unsigned char c = s[p->mark_offset];
+        p->mark_offset += (c < 0x80) ? 1 : (c < 0xE0) ? 2 : (c < 0xF0) ? 3 : 4;
+        p->mark_index++;
+    }
+    return p->mark_offset;
+}
+
+/* Returns 0, or ENOMEM if the value can not be copied. */
+static int __set_scalar_event(
+        SimpleYamlParser* p, SimpleYamlNode* node, yaml_event_t* event)
+{
+    const char* value = (const char*)event->data.scalar.value;
+    size_t length = event->data.scalar.length;
+    /* Only plain (untagged) scalars resolve to types other than string. */
+    if (!event->data.scalar.plain_implicit) {
+        node->flags |= SIMPLE_YAML_NODE_QUOTED;
+    }
+    if (p->source) {
+        /* When the scalar appears, unchanged, in the source then reference
+        it rather than making a copy. */
+        size_t quote = 0;
+        switch (event->data.scalar.style) {
+            case YAML_PLAIN_SCALAR_STYLE:
+                break;
+            case YAML_SINGLE_QUOTED_SCALAR_STYLE:
+            case YAML_DOUBLE_QUOTED_SCALAR_STYLE:
+                quote = 1;
+                break;
+            default:
+                quote = SIZE_MAX;
+                break;
         }
-        if (hashlist_init(doc_list) != HASHMAP_SUCCESS) {
-            if (errno==0) errno = ECANCELED;
-            perror("Error creating document list");
-            free(doc_list);
-            return(NULL);
+        if (quote != SIZE_MAX) {
+            size_t start = __source_offset(p, event->start_mark.index);
+            size_t end = __source_offset(p, event->end_mark.index);
+            if (end - start == length + 2 * quote && end <= p->source_length
+                    && memcmp(p->source + start + quote, value, length) == 0) {
+                simple_yaml_set_scalar_view(
+                        node, p->source + start + quote, length);
+                return 0;
+            }
+        }
+    }
+    simple_yaml_set_scalar(node, value);
+    return node->value ? 0 : ENOMEM;
+}
+
+/* Consume the events of the node which starts with event (a scalar, alias or
+the start of a collection). */
+static int __skip_node(SimpleYamlParser* p, yaml_event_t* event)
+{
+    int level = 0;
+    do {
+        yaml_char_t* anchor = NULL;
+        switch (event->type) {
+            case YAML_SCALAR_EVENT:
+                anchor = event->data.scalar.anchor;
+                break;
+            case YAML_MAPPING_START_EVENT:
+                anchor = event->data.mapping_start.anchor;
+                level++;
+                break;
+            case YAML_SEQUENCE_START_EVENT:
+                anchor = event->data.sequence_start.anchor;
+                level++;
+                break;
+            case YAML_MAPPING_END_EVENT:
+            case YAML_SEQUENCE_END_EVENT:
+                level--;
+                break;
+            default:
+                break;
+        }
+        /* An anchor of a node which is not selected (it may redefine a
+        selected anchor) can not be aliased. */
+        if (anchor && p->select_count) __anchor_unset(p, (char*)anchor);
+        yaml_event_delete(event);
+        if (level == 0) return 0;
+        if (!__next_event(p, event)) return -1;
+    } while (true);
+}
+
+static int __select_add(
+        SimpleYamlParser* p, SelectFrame* frame, uint32_t path, uint32_t segment)
+{
+    const SimpleYamlPath* select = p->select[path];
+    for (; segment < select->count; segment++) {
+        uint32_t i = frame->start + frame->count;
+        if (i == p->state_capacity) {
+            uint32_t capacity = p->state_capacity ? p->state_capacity * 2 : 64;
+            SelectState* states = realloc(
+                    p->states, capacity * sizeof(SelectState));
+            if (states == NULL) return ENOMEM;
+            p->states = states;
+            p->state_capacity = capacity;
+        }
+        p->states[i].path = path;
+        p->states[i].segment = segment;
+        frame->count++;
+        /* A "**" segment also matches nothing, continue with the next. */
+        if (select->segments[segment].type != SIMPLE_YAML_PATH_DESCEND) return 0;
+    }
+    frame->all = true;  /* The path is matched. */
+    return 0;
+}
+
+/* Calculate the selection states of a child node (key, or index when key is
+NULL) into p->pending. The child, or one of its descendants, is selected when
+pending.all is set or pending.count is non-zero (the document root always is).
+Returns 0 or ENOMEM. */
+static int __select_child(
+        SimpleYamlParser* p, const char* key, size_t length, uint32_t index)
+{
+    SelectFrame* pending = &p->pending;
+    pending->start = p->state_count;
+    pending->count = 0;
+    pending->all = false;
+    if (p->frame_count == 0) {
+        /* The document root. */
+        for (uint32_t i = 0; i < p->select_count; i++) {
+            int rc = __select_add(p, pending, i, 0);
+            if (rc) return rc;
+        }
+        return 0;
+    }
+    SelectFrame* parent = &p->frames[p->frame_count - 1];
+    if (parent->all) {
+        pending->all = true;
+        return 0;
+    }
+    for (uint32_t i = parent->start; i < parent->start + parent->count; i++) {
+        SelectState state = p->states[i];
+        const SimpleYamlPathSegment* segment =
+                &p->select[state.path]->segments[state.segment];
+        int rc = 0;
+        switch (segment->type) {
+            case SIMPLE_YAML_PATH_DESCEND:
+                rc = __select_add(p, pending, state.path, state.segment);
+                break;
+            case SIMPLE_YAML_PATH_ANY:
+                rc = __select_add(p, pending, state.path, state.segment + 1);
+                break;
+            default:
+                if (key ? (segment->length == length
+                        && memcmp(segment->key, key, length) == 0)
+                        : (segment->index == index)) {
+                    rc = __select_add(p, pending, state.path, state.segment + 1);
+                }
+                break;
+        }
+        if (rc) return rc;
+    }
+    return 0;
+}
+
+static int __select_push(SimpleYamlParser* p)
+{
+    if (p->frame_count == p->frame_capacity) {
+        uint32_t capacity = p->frame_capacity ? p->frame_capacity * 2 : 16;
+        SelectFrame* frames = realloc(p->frames, capacity * sizeof(SelectFrame));
+        if (frames == NULL) return ENOMEM;
+        p->frames = frames;
+        p->frame_capacity = capacity;
+    }
+    p->frames[p->frame_count++] = p->pending;
+    p->state_count = p->pending.start + p->pending.count;
+    return 0;
+}
+
+/* Returns true when the node was entirely selected (built). */
+static bool __select_pop(SimpleYamlParser* p)
+{
+    if (p->frame_count == 0) return true;
+    SelectFrame* frame = &p->frames[--p->frame_count];
+    p->state_count = frame->start;
+    return frame->all;
+}
+
+static int __anchor_set(SimpleYamlParser* p, const char* name,
+        SimpleYamlNode* node, uint64_t size)
+{
+    if (!p->anchor_index_init) {
+        if (hashmap_init_alt(&p->anchor_index, 64, NULL) != HASHMAP_SUCCESS) {
+            return ENOMEM;
+        }
+        p->anchor_index_init = true;
+    }
+    if (p->anchor_count == p->anchor_capacity) {
+        uint32_t capacity = p->anchor_capacity ? p->anchor_capacity * 2 : 16;
+        AnchorEntry* anchors = realloc(
+                p->anchors, capacity * sizeof(AnchorEntry));
+        if (anchors == NULL) return ENOMEM;
+        p->anchors = anchors;
+        p->anchor_capacity = capacity;
+    }
+    /* A redefined anchor replaces the earlier definition. */
+    p->anchors[p->anchor_count].node = node;
+    p->anchors[p->anchor_count].size = size;
+    p->anchor_count++;
+    node->refs++;
+    if (hashmap_set(&p->anchor_index, name,
+            (void*)(uintptr_t)p->anchor_count) == NULL) return ENOMEM;
+    return 0;
+}
+
+static void __anchor_unset(SimpleYamlParser* p, const char* name)
+{
+    if (p->anchor_index_init) hashmap_remove(&p->anchor_index, name);
+}
+
+static AnchorEntry* __anchor_get(SimpleYamlParser* p, const char* name)
+{
+    if (!p->anchor_index_init) return NULL;
+    uintptr_t i = (uintptr_t)hashmap_get(&p->anchor_index, name);
+    return i ? &p->anchors[i - 1] : NULL;
+}
+
+/* Anchored collections are registered when they end, an alias can not
+reference the collection which contains it. */
+static int __anchor_push(
+        SimpleYamlParser* p, const char* name, SimpleYamlNode* node)
+{
+    if (p->anchor_frame_count == p->anchor_frame_capacity) {
+        uint32_t capacity = p->anchor_frame_capacity
+                ? p->anchor_frame_capacity * 2 : 16;
+        AnchorFrame* frames = realloc(
+                p->anchor_frames, capacity * sizeof(AnchorFrame));
+        if (frames == NULL) return ENOMEM;
+        p->anchor_frames = frames;
+        p->anchor_frame_capacity = capacity;
+    }
+    char* copy = strdup(name);
+    if (copy == NULL) return ENOMEM;
+    AnchorFrame* frame = &p->anchor_frames[p->anchor_frame_count++];
+    frame->name = copy;
+    frame->node = node;
+    frame->start = p->expanded - 1;     /* Including node. */
+    return 0;
+}
+
+/* A collection which was only partly built (parsing selectively) is not
+registered, an alias of it is skipped rather than referencing part of the
+collection. */
+static int __anchor_pop(SimpleYamlParser* p, SimpleYamlNode* node,
+        bool complete)
+{
+    if (p->anchor_frame_count == 0) return 0;
+    AnchorFrame* frame = &p->anchor_frames[p->anchor_frame_count - 1];
+    if (frame->node != node) return 0;
+    p->anchor_frame_count--;
+    int rc = 0;
+    if (complete) {
+        rc = __anchor_set(p, frame->name, node, p->expanded - frame->start);
+    } else {
+        __anchor_unset(p, frame->name);
+    }
+    free(frame->name);
+    return rc;
+}
+
+/* Release the anchors, before the document is returned (or destroyed). */
+static void __anchor_reset(SimpleYamlParser* p)
+{
+    for (uint32_t i = 0; i < p->anchor_frame_count; i++) {
+        free(p->anchor_frames[i].name);
+    }
+    p->anchor_frame_count = 0;
+    for (uint32_t i = 0; i < p->anchor_count; i++) {
+        simple_yaml_destroy_node(p->anchors[i].node);
+    }
+    if (p->anchor_count) hashmap_clear(&p->anchor_index);
+    p->anchor_count = 0;
+    p->expanded = p->aliased = 0;
+}
+
+/* Calculate the selection of a value (in parent, with key or as the next
+sequence item), selected is false when the value is not selected. Returns 0
+or ENOMEM. */
+static int __select_value(SimpleYamlParser* p, SimpleYamlNode* parent,
+        yaml_event_t* key, bool scalar, bool* selected)
+{
+    int rc;
+    if (key) {
+        rc = __select_child(p, (const char*)key->data.scalar.value,
+                key->data.scalar.length, 0);
+    } else {
+        rc = __select_child(p, NULL, 0, hashlist_length(&parent->sequence));
+    }
+    if (rc) return rc;
+    *selected = p->pending.all || (!scalar && p->pending.count);
+    if (!*selected) {
+        /* Keep the position of later sequence items. */
+        if (key == NULL && simple_yaml_create_node(NULL, parent) == NULL) {
+            return ENOMEM;
+        }
+    }
+    return 0;
+}
+
+/* A plain "<<" key, a merge key. */
+static bool __is_merge_key(yaml_event_t* key)
+{
+    return key && key->data.scalar.plain_implicit
+            && key->data.scalar.length == 2
+            && memcmp(key->data.scalar.value, "<<", 2) == 0;
+}
+
+/* Create the node for a value (scalar or collection start) event. Returns 0
+with node NULL when the node is not selected, the events of the node are then
+skipped, or ENOMEM. */
+static int __create_value_node(SimpleYamlParser* p, SimpleYamlNode** doc,
+        SimpleYamlNode* parent, yaml_event_t* key, bool scalar,
+        SimpleYamlNode** node)
+{
+    *node = NULL;
+    if (parent == NULL) {
+        /* This is the root node of the document. */
+        assert(*doc == NULL);
+        if (p->select_count) {
+            int rc = __select_child(p, NULL, 0, 0);
+            if (rc) return rc;
+        }
+        *doc = __create_document(p->options);
+        if (*doc == NULL) return ENOMEM;
+        *node = *doc;
+        return 0;
+    }
+    if (p->select_count) {
+        bool selected;
+        int rc = __select_value(p, parent, key, scalar, &selected);
+        if (rc || !selected) return rc;
+    }
+    if (!scalar && __is_merge_key(key)) {
+        /* Inline merge, i.e. "<<: {a: 1}" or "<<: [*a, *b]". */
+        SimpleYamlNode* merge = __create_node(
+                (char*)"<<", NULL, parent->arena, false);
+        if (merge == NULL) return ENOMEM;
+        merge->parent = parent;
+        if (__mapping_merge(parent, merge->name, merge)) {
+            if (merge->arena == NULL) simple_yaml_destroy_node(merge);
+            return ENOMEM;
+        }
+        *node = merge;
+        return 0;
+    }
+    char* name = key ? (char*)key->data.scalar.value : NULL;
+    if (name && p->options && p->options->keys) {
+        const char* interned = simple_yaml_keys_intern(p->options->keys, name);
+        if (interned) {
+            *node = __create_node(
+                    (char*)interned, parent, parent->arena, true);
+            return *node ? 0 : ENOMEM;
+        }
+    }
+    *node = simple_yaml_create_node(name, parent);
+    return *node ? 0 : ENOMEM;
+}
+
+/* Add the node referenced by an alias event to parent (with key, or as the
+next sequence item). The anchored node is shared, not copied. */
+static int __alias(SimpleYamlParser* p, SimpleYamlNode* parent,
+        yaml_event_t* key, yaml_event_t* event)
+{
+    if (parent == NULL) return EINVAL;
+    if (p->select_count) {
+        bool selected;
+        int rc = __select_value(p, parent, key, false, &selected);
+        if (rc || !selected) return rc;
+    }
+    AnchorEntry* anchor = __anchor_get(p, (char*)event->data.alias.anchor);
+    if (anchor == NULL) {
+        if (p->select_count == 0) return EINVAL;
+        /* The anchor was not selected, an unresolved alias is skipped. */
+        if (key == NULL && simple_yaml_create_node(NULL, parent) == NULL) {
+            return ENOMEM;
+        }
+        return 0;
+    }
+    uint64_t limit = SIMPLE_YAML_ALIAS_LIMIT;
+    if (p->options && p->options->alias_limit) limit = p->options->alias_limit;
+    if (p->aliased + anchor->size > limit) return EOVERFLOW;
+    p->aliased += anchor->size;
+    p->expanded += anchor->size;
+
+    SimpleYamlNode* target = anchor->node;
+    if (parent->node_type == YAML_SEQUENCE_NODE) {
+        if (hashlist_append(&parent->sequence, target) != HASHMAP_SUCCESS) {
+            return ENOMEM;
         }
+        target->refs++;
+        return 0;
     }
+    /* The key is owned by the mapping entry. */
+    const char* name = (const char*)key->data.scalar.value;
+    size_t length = key->data.scalar.length;
+    char* copy = parent->arena ? arena_strndup(parent->arena, name, length)
+            : strndup(name, length);
+    if (copy == NULL) return ENOMEM;
+    STATS_ADD(key_bytes, length + 1);
+    target->refs++;
+    int rc;
+    if (__is_merge_key(key) && (target->node_type == YAML_MAPPING_NODE
+            || target->node_type == YAML_SEQUENCE_NODE)) {
+        rc = __mapping_merge(parent, copy, target);
+    } else {
+        rc = __mapping_put(parent, copy, false, target);
+    }
+    if (rc) {
+        target->refs--;
+        if (parent->arena == NULL) free(copy);
+    }
+    return rc;
+}
 
-    /* Parse the YAML documents contained in the file stream. */
+/* Parse the next document of the stream. Returns 1 when a document is parsed
+(doc may be NULL if the document is empty), 0 at the end of the stream, or -1
+on error. */
+static int __parse_document(SimpleYamlParser* p, SimpleYamlNode** document)
+{
     SimpleYamlNode* doc = NULL;
-    SimpleYamlNode* node = NULL;
+    SimpleYamlNode* node = NULL;    /* The current collection. */
+    yaml_event_t key;               /* Mapping key, until the value event. */
+    bool has_key = false;
     yaml_event_t event;
+    *document = NULL;
+    if (p->stream_end) return 0;
+#ifdef SIMPLE_YAML_STATS
+    p->stats_clock = __stats_clock();
+#endif
     do {
         /* Parse the next event. */
-        if (!yaml_parser_parse(&parser, &event)) {
-            if (errno==0) errno = ECANCELED;
+        if (!__next_event(p, &event)) {
+            if (has_key) yaml_event_delete(&key);
+            __anchor_reset(p);
+            simple_yaml_destroy_node(doc);  /* Partly parsed document. */
+            int rc = errno ? errno : ECANCELED;
+            errno = rc;
             perror("Error while parsing YAML file stream");
-            if (hashlist_length(doc_list)) {
-                return doc_list;  /* Return the partly scanned doc_list. */
-            } else {
-                free(doc_list);
-                return(NULL);
-            }
+            errno = rc;
+            return -1;
         }
 
         /* Process the event. */
+        SimpleYamlNode* child;
+        int error = 0;
         switch (event.type) {
             /* Document events. */
             case YAML_DOCUMENT_START_EVENT:
                 assert(doc == NULL);
+                __anchor_reset(p);
                 break;
             case YAML_DOCUMENT_END_EVENT:
-                if (doc) {
-                    hashlist_append(doc_list, doc);
+                yaml_event_delete(&event);
+                __anchor_reset(p);
+                if (doc && p->options && p->options->resolve_scalars) {
+                    doc->flags |= SIMPLE_YAML_NODE_RESOLVED;
                 }
-                doc = node = NULL;  /* Reset the document pointers. */
-                break;
+                p->frame_count = p->state_count = 0;
+                *document = doc;
+                return 1;
             /* Node events. */
             case YAML_SCALAR_EVENT:
-                if (node->node_type == YAML_MAPPING_NODE
-                        || node->node_type == YAML_SEQUENCE_NODE) {
-                    /* Create a child node (will be attached to the collection),
-                    and set the key. At this point the node_type is not known. */
-                    node = simple_yaml_create_node(
-                            (char*)event.data.scalar.value, node);
-                } else {
-                    /* The child node is scalar, set the node_type and value. */
-                    simple_yaml_set_scalar(node, (char*)event.data.scalar.value);
-                    node = node->parent;
-                }
-                break;
             case YAML_MAPPING_START_EVENT:
-                if (node == NULL) {
-                    /* This is the root node of the document. */
-                    assert(doc == NULL);
-                    node = simple_yaml_create_node(NULL, node);
-                    doc = node;
+            case YAML_SEQUENCE_START_EVENT:
+            case YAML_ALIAS_EVENT:
+                if (node && node->node_type == YAML_MAPPING_NODE && !has_key) {
+                    if (event.type == YAML_SCALAR_EVENT) {
+                        /* Mapping key, the child node is created (with the
+                        key) when the value event arrives. */
+                        key = event;
+                        has_key = true;
+                        continue;
+                    }
+                    /* Complex keys are not supported, skip the key and the
+                    value. */
+                    if (__skip_node(p, &event)
+                            || !__next_event(p, &event)
+                            || __skip_node(p, &event)) {
+                        __anchor_reset(p);
+                        simple_yaml_destroy_node(doc);
+                        return -1;
+                    }
+                    continue;
                 }
-                if (node->node_type == YAML_SEQUENCE_NODE) {
-                    /* This mapping is an item of the parent sequence, create
-                    a node and append to the sequence. */
-                    node = simple_yaml_create_node(NULL, node);
+                if (event.type == YAML_ALIAS_EVENT) {
+                    error = __alias(p, node, has_key ? &key : NULL, &event);
+                    if (has_key) {
+                        yaml_event_delete(&key);
+                        has_key = false;
+                    }
+                    break;
                 }
-                simple_yaml_set_mapping(node);
-                break;
-            case YAML_SEQUENCE_START_EVENT:
-                if (node == NULL) {
-                    /* This is the root node of the document. */
-                    assert(doc == NULL);
-                    node = simple_yaml_create_node(NULL, node);
-                    doc = node;
+                error = __create_value_node(p, &doc, node,
+                        has_key ? &key : NULL, event.type == YAML_SCALAR_EVENT,
+                        &child);
+                if (has_key) {
+                    yaml_event_delete(&key);
+                    has_key = false;
+                }
+                if (error) break;
+                if (child == NULL) {
+                    /* Not selected. */
+                    if (__skip_node(p, &event)) {
+                        __anchor_reset(p);
+                        simple_yaml_destroy_node(doc);
+                        return -1;
+                    }
+                    continue;
+                }
+                p->expanded++;
+                yaml_char_t* anchor;
+                if (event.type == YAML_SCALAR_EVENT) {
+                    error = __set_scalar_event(p, child, &event);
+                    if (error) break;
+                    if (p->options && p->options->resolve_scalars) {
+                        simple_yaml_resolve_scalar(child);
+                    }
+                    anchor = event.data.scalar.anchor;
+                    if (anchor) error = __anchor_set(p, (char*)anchor, child, 1);
+                    break;
+                }
+                if (event.type == YAML_MAPPING_START_EVENT) {
+                    simple_yaml_set_mapping(child);
+                    anchor = event.data.mapping_start.anchor;
+                } else {
+                    simple_yaml_set_sequence(child);
+                    anchor = event.data.sequence_start.anchor;
+                }
+                if (p->select_count) error = __select_push(p);
+                if (anchor && !error) {
+                    error = __anchor_push(p, (char*)anchor, child);
                 }
-                simple_yaml_set_sequence(node);
+                node = child;
                 break;
             case YAML_MAPPING_END_EVENT:
             case YAML_SEQUENCE_END_EVENT:
+                /* Pop the selection of the node (was it entirely built). */
+                error = __anchor_pop(p, node,
+                        p->select_count ? __select_pop(p) : true);
                 node = node->parent;
                 break;
+            case YAML_STREAM_END_EVENT:
+                yaml_event_delete(&event);
+                p->stream_end = true;
+                return 0;
             /* Other events, ignored. */
             case YAML_STREAM_START_EVENT:
-            case YAML_STREAM_END_EVENT:
             case YAML_NO_NODE:
             default:
                 break;
         }
-        if (event.type == YAML_STREAM_END_EVENT) break;
         yaml_event_delete(&event);
+        if (error) {
+            __anchor_reset(p);
+            p->frame_count = p->state_count = 0;
+            simple_yaml_destroy_node(doc);
+            errno = error;
+            perror("Error building YAML document");
+            errno = error;
+            return -1;
+        }
     } while (true);
+}
+
+static HashList* __parse(SimpleYamlParser* p, HashList* doc_list)
+{
+    /* Create the document list for parsed YAML documents. */
+    if (doc_list == NULL) {
+        doc_list = calloc(1, sizeof(HashList));
+        if (doc_list == NULL) {
+            perror("Error creating document list");
+            return doc_list;  /* NULL */
+        }
+        if (hashlist_init(doc_list) != HASHMAP_SUCCESS) {
+            if (errno==0) errno = ECANCELED;
+            perror("Error creating document list");
+            free(doc_list);
+            return(NULL);
+        }
+    }
+
+    /* Parse the YAML documents contained in the stream. */
+    SimpleYamlNode* doc;
+    int rc;
+    while ((rc = __parse_document(p, &doc)) > 0) {
+        if (doc && hashlist_append(doc_list, doc) != HASHMAP_SUCCESS) {
+            simple_yaml_destroy_node(doc);
+            errno = ENOMEM;
+            perror("Error creating document list");
+            rc = -1;
+            break;
+        }
+    }
+    if (rc < 0 && hashlist_length(doc_list) == 0) {
+        hashlist_destroy(doc_list);
+        free(doc_list);
+        return(NULL);
+    }
+
+    /* Return the parsed YAML documents (or the partly scanned doc_list). */
+    return doc_list;
+}
+
+static int __parser_init(SimpleYamlParser* p, const SimpleYamlOptions* options)
+{
+    memset(p, 0, sizeof(SimpleYamlParser));
+    p->options = options;
+    STATS_THREAD();
+    if (!yaml_parser_initialize(&p->parser)) {
+        if (errno==0) errno = ECANCELED;
+        perror("Error initializing parser");
+        return -1;
+    }
+
+    /* Compile the selected paths. */
+    if (options && options->select) {
+        uint32_t count = 0;
+        while (options->select[count]) count++;
+        p->select = calloc(count, sizeof(SimpleYamlPath*));
+        if (p->select == NULL) count = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            p->select[i] = simple_yaml_path_compile(options->select[i]);
+            if (p->select[i] == NULL) {
+                __parser_delete(p);
+                return -1;
+            }
+            p->select_count++;
+        }
+    }
+    return 0;
+}
+
+static void __parser_delete(SimpleYamlParser* p)
+{
+    yaml_parser_delete(&p->parser);
+    for (uint32_t i = 0; i < p->select_count; i++) {
+        simple_yaml_path_destroy(p->select[i]);
+    }
+    free(p->select);
+    free(p->states);
+    free(p->frames);
+    __anchor_reset(p);
+    if (p->anchor_index_init) hashmap_destroy(&p->anchor_index);
+    free(p->anchors);
+    free(p->anchor_frames);
+}
+
+HashList* simple_yaml_parse_file_alt(const char* filename, HashList* doc_list,
+        const SimpleYamlOptions* options)
+{
+    errno = 0;
+    if (options && options->threads > 1) {
+        return simple_yaml_parse_mmap(filename, doc_list, options, NULL);
+    }
+
+    /* Open the file containing the YAML stream. */
+    FILE *file_handle = fopen(filename, "r");
+    if (file_handle == NULL) {
+        if (errno==0) errno = EINVAL;
+        perror("Error opening file");
+        return doc_list;
+    }
+
+    /* Setup the YAML parser. */
+    SimpleYamlParser parser;
+    if (__parser_init(&parser, options)) {
+        fclose(file_handle);
+        return doc_list;
+    }
+    yaml_parser_set_input_file(&parser.parser, file_handle);
+
+    doc_list = __parse(&parser, doc_list);
 
     /* Release the parsing objects. */
-    yaml_event_delete(&event);
-    yaml_parser_delete(&parser);
+    __parser_delete(&parser);
     fclose(file_handle);
 
-    /* Return the parsed YAML documents. */
     return doc_list;
 }
 
-SimpleYamlNode* simple_yaml_find_node(SimpleYamlNode* parent, const char* path)
+HashList* simple_yaml_parse_buffer(const char* buffer, size_t length,
+        HashList* doc_list, const SimpleYamlOptions* options)
 {
-    SimpleYamlNode* node = parent;
-    char* _path = strdup(path);  /* strtok() is destructive, work from copy. */
-    char* token = strtok(_path, "/");
+    errno = 0;
+    if (options && options->threads > 1) {
+        return simple_yaml_parse_buffer_parallel(
+                buffer, length, doc_list, options);
+    }
 
-    while (token && node) {
-        if (node->node_type == YAML_SEQUENCE_NODE) {
-            free(_path);
-            return NULL;
+    SimpleYamlParser parser;
+    if (__parser_init(&parser, options)) return doc_list;
+    if (buffer == NULL) buffer = "";  /* Empty input, e.g. an empty file. */
+    yaml_parser_set_input_string(
+            &parser.parser, (const unsigned char*)buffer, length);
+    if (options && options->zero_copy) {
+        __parser_set_source(&parser, buffer, length);
+    }
+
+    doc_list = __parse(&parser, doc_list);
+
+    __parser_delete(&parser);
+    return doc_list;
+}
+
+HashList* simple_yaml_parse_mmap(const char* filename, HashList* doc_list,
+        const SimpleYamlOptions* options, SimpleYamlMmap* map)
+{
+    errno = 0;
+
+    /* Map the file containing the YAML stream. */
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        perror("Error opening file");
+        return doc_list;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("Error opening file");
+        close(fd);
+        return doc_list;
+    }
+    size_t length = st.st_size;
+    void* data = NULL;
+    if (length) {
+        data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("Error mapping file");
+            close(fd);
+            return doc_list;
         }
-        if (node->node_type == YAML_MAPPING_NODE) {
-            node = hashmap_get(&node->mapping, token);
+    }
+    close(fd);
+
+    /* Parse, scalars reference the mapping when it is kept by the caller. */
+    SimpleYamlOptions _options = { 0 };
+    if (options) _options = *options;
+    _options.zero_copy = (map != NULL);
+    if (length) posix_madvise(data, length, POSIX_MADV_SEQUENTIAL);
+    doc_list = simple_yaml_parse_buffer(data, length, doc_list, &_options);
+
+    if (map) {
+        map->data = data;
+        map->length = length;
+    } else if (length) {
+        munmap(data, length);
+    }
+    return doc_list;
+}
+
+void simple_yaml_munmap(SimpleYamlMmap* map)
+{
+    if (map == NULL || map->data == NULL) return;
+    munmap(map->data, map->length);
+    map->data = NULL;
+    map->length = 0;
+}
+
+struct SimpleYamlStream {
+    SimpleYamlParser    parser;
+    SimpleYamlOptions   options;
+    FILE*               file;
+};
+
+static SimpleYamlStream* __stream_create(const SimpleYamlOptions* options)
+{
+    SimpleYamlStream* stream = calloc(1, sizeof(SimpleYamlStream));
+    if (stream == NULL) {
+        perror("Error creating stream");
+        return NULL;
+    }
+    if (options) stream->options = *options;
+    if (__parser_init(&stream->parser, &stream->options)) {
+        free(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+SimpleYamlStream* simple_yaml_stream_open(
+        const char* filename, const SimpleYamlOptions* options)
+{
+    errno = 0;
+    FILE *file_handle = fopen(filename, "r");
+    if (file_handle == NULL) {
+        if (errno==0) errno = EINVAL;
+        perror("Error opening file");
+        return NULL;
+    }
+    SimpleYamlStream* stream = __stream_create(options);
+    if (stream == NULL) {
+        fclose(file_handle);
+        return NULL;
+    }
+    stream->file = file_handle;
+    yaml_parser_set_input_file(&stream->parser.parser, file_handle);
+    return stream;
+}
+
+SimpleYamlStream* simple_yaml_stream_open_buffer(const char* buffer,
+        size_t length, const SimpleYamlOptions* options)
+{
+    errno = 0;
+    SimpleYamlStream* stream = __stream_create(options);
+    if (stream == NULL) return NULL;
+    if (buffer == NULL) buffer = "";
+    yaml_parser_set_input_string(
+            &stream->parser.parser, (const unsigned char*)buffer, length);
+    if (stream->options.zero_copy) {
+        __parser_set_source(&stream->parser, buffer, length);
+    }
+    return stream;
+}
+
+SimpleYamlNode* simple_yaml_stream_next_document(SimpleYamlStream* stream)
+{
+    errno = 0;
+    SimpleYamlNode* doc = NULL;
+    while (__parse_document(&stream->parser, &doc) > 0) {
+        if (doc) return doc;
+    }
+    return NULL;
+}
+
+void simple_yaml_stream_close(SimpleYamlStream* stream)
+{
+    if (stream == NULL) return;
+    __parser_delete(&stream->parser);
+    if (stream->file) fclose(stream->file);
+    free(stream);
+}
+
+static uint32_t __parse_index(const char* token, size_t length)
+{
+    /* Decimal sequence index, otherwise SIMPLE_YAML_PATH_NO_INDEX. */
+    if (length == 0 || length > 9) return SIMPLE_YAML_PATH_NO_INDEX;
+    uint32_t index = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (token[i] < '0' || token[i] > '9') return SIMPLE_YAML_PATH_NO_INDEX;
+        index = index * 10 + (token[i] - '0');
+    }
+    return index;
+}
+
+SimpleYamlPath* simple_yaml_path_compile(const char* path)
+{
+    /* Count the segments, empty segments (i.e. "//") are skipped. */
+    uint32_t count = 0;
+    size_t length = strlen(path);
+    for (const char* p = path; *p; p++) {
+        if (*p != '/' && (p == path || p[-1] == '/')) count++;
+    }
+
+    /* Allocate the path, segments and keys as a single block. */
+    SimpleYamlPath* compiled = malloc(sizeof(SimpleYamlPath)
+            + count * sizeof(SimpleYamlPathSegment) + length + 1);
+    if (compiled == NULL) return NULL;
+    char* keys = (char*)&compiled->segments[count];
+    memcpy(keys, path, length + 1);
+
+    /* Split the keys, and classify/hash each. */
+    uint32_t i = 0;
+    char* key = keys;
+    for (uint32_t n = 0; n < count; n++) {
+        while (*key == '/') key++;
+        char* end = strchr(key, '/');
+        if (end) *end = '\0';
+        SimpleYamlPathSegment* segment = &compiled->segments[i];
+        segment->key = key;
+        segment->length = strlen(key);
+        segment->hash = hashmap_default_hash_length(key, segment->length);
+        segment->index = __parse_index(key, segment->length);
+        segment->type = SIMPLE_YAML_PATH_KEY;
+        if (strcmp(key, "*") == 0) segment->type = SIMPLE_YAML_PATH_ANY;
+        if (strcmp(key, "**") == 0) segment->type = SIMPLE_YAML_PATH_DESCEND;
+        key += segment->length + 1;
+        /* Consecutive "**" segments are equivalent to one. */
+        if (segment->type == SIMPLE_YAML_PATH_DESCEND && i
+                && compiled->segments[i-1].type == SIMPLE_YAML_PATH_DESCEND) {
+            continue;
         }
-        token = strtok(NULL, "/");
+        i++;
     }
-    free(_path);
-    return node;
+    compiled->count = i;
+    compiled->wildcards = 0;
+    compiled->descend = 0;
+    for (uint32_t n = 0; i < 64 && n < i; n++) {
+        if (compiled->segments[n].type != SIMPLE_YAML_PATH_KEY) {
+            compiled->wildcards |= (uint64_t)1 << n;
+        }
+        if (compiled->segments[n].type == SIMPLE_YAML_PATH_DESCEND) {
+            compiled->descend |= (uint64_t)1 << n;
+        }
+    }
+    return compiled;
 }
 
-int simple_yaml_get_value_as_bool(SimpleYamlNode* node, bool* value)
+void simple_yaml_path_destroy(SimpleYamlPath* path)
 {
-    assert(node);
-    assert(value);
-    if (node->node_type != YAML_SCALAR_NODE) return EINVAL;
-    const char** p;
-    /* Bool true? */
-    const char* bool_true[] = {
-        "y", "Y", "yes", "Yes", "YES", "true", "True", "TRUE", "on", "On", "ON", NULL};
-    for (p = bool_true; *p; p++) {
-        if (strcmp(*p, node->value)) continue;
-        *value = true;
-        return 0;
+    free(path);
+}
+
+static SimpleYamlNode* __get_child(
+        SimpleYamlNode* node, const SimpleYamlPathSegment* segment)
+{
+    if (node->node_type == YAML_MAPPING_NODE) {
+        return __mapping_lookup(node, segment->key, segment->length,
+                segment->hash, true);
     }
-    /* Bool false? */
-    const char* bool_false[] = {
-        "n", "N", "no", "No", "NO", "false", "False", "FALSE", "off", "Off", "OFF", NULL};
-    for (p = bool_false; *p; p++) {
-        if (strcmp(*p, node->value)) continue;
-        *value = false;
-        return 0;
+    if (node->node_type == YAML_SEQUENCE_NODE) {
+        if (segment->index == SIMPLE_YAML_PATH_NO_INDEX) return NULL;
+        return hashlist_get_at(&node->sequence, segment->index);
+    }
+    return NULL;
+}
+
+/* Paths are matched with a set of states (positions in the path, count
+when the path is matched) for each node, so a node which several "**"
+segments reach is matched once. */
+typedef struct SimpleYamlMatch {
+    const SimpleYamlPath*       path;
+    SimpleYamlMatchCallback     callback;
+    void*                       data;
+    uint32_t                    count;
+    uint32_t                    words;  /* Of a state set, one bit each. */
+} SimpleYamlMatch;
+
+static bool __state_test(const uint64_t* states, uint32_t i)
+{
+    return states[i / 64] & ((uint64_t)1 << (i % 64));
+}
+
+/* A "**" segment also matches nothing, the next state is added. */
+static void __state_add(SimpleYamlMatch* m, uint64_t* states, uint32_t i)
+{
+    do {
+        states[i / 64] |= (uint64_t)1 << (i % 64);
+    } while (i < m->path->count
+            && m->path->segments[i++].type == SIMPLE_YAML_PATH_DESCEND);
+}
+
+/* Calculate the states of a child (key, or index when key is NULL) into next,
+returns false when there are none. */
+static bool __match_step(SimpleYamlMatch* m, const uint64_t* states,
+        uint64_t* next, const char* key, size_t length, uint32_t index)
+{
+    if (m->words == 1) {
+        /* Wildcard states by mask, only the key states are compared. */
+        uint64_t word = states[0];
+        uint64_t matched = (uint64_t)1 << m->path->count;
+        uint64_t keys = word & ~(m->path->wildcards | matched);
+        uint64_t result = (word & m->path->descend)
+                | ((word & m->path->wildcards & ~m->path->descend) << 1);
+        for (; keys; keys &= keys - 1) {
+            uint32_t i = __builtin_ctzll(keys);
+            const SimpleYamlPathSegment* segment = &m->path->segments[i];
+            if (key ? (segment->length == length
+                    && memcmp(segment->key, key, length) == 0)
+                    : (segment->index == index)) {
+                result |= (uint64_t)1 << (i + 1);
+            }
+        }
+        /* Consecutive "**" are compiled as one, a single closure step. */
+        next[0] = result | ((result & m->path->descend) << 1);
+        return next[0] != 0;
+    }
+    memset(next, 0, m->words * sizeof(uint64_t));
+    bool found = false;
+    for (uint32_t i = 0; i < m->path->count; i++) {
+        if (!__state_test(states, i)) continue;
+        const SimpleYamlPathSegment* segment = &m->path->segments[i];
+        switch (segment->type) {
+            case SIMPLE_YAML_PATH_DESCEND:
+                __state_add(m, next, i);
+                break;
+            case SIMPLE_YAML_PATH_ANY:
+                __state_add(m, next, i + 1);
+                break;
+            default:
+                if (key ? (segment->length != length
+                        || memcmp(segment->key, key, length) != 0)
+                        : (segment->index != index)) continue;
+                __state_add(m, next, i + 1);
+                break;
+        }
+        found = true;
+    }
+    return found;
+}
+
+static int __match(SimpleYamlMatch* m, SimpleYamlNode* node,
+        const uint64_t* states);
+static int __match_segment(SimpleYamlMatch* m, SimpleYamlNode* node,
+        uint32_t i);
+
+static int __match_child(SimpleYamlMatch* m, SimpleYamlNode* child,
+        const char* key, size_t length, uint32_t index,
+        const uint64_t* states, uint64_t* next)
+{
+    if (!__match_step(m, states, next, key, length, index)) return 0;
+    /* A matched child without other states (most matches) is not searched,
+    nor is a scalar (most children) which is not matched. */
+    if (m->words == 1 && next[0] == (uint64_t)1 << m->path->count) {
+        m->count++;
+        return m->callback ? m->callback(child, m->data) : 0;
     }
-    /* Bool conversion failed. */
-    return EINVAL;
+    if (child->node_type != YAML_MAPPING_NODE
+            && child->node_type != YAML_SEQUENCE_NODE
+            && !__state_test(next, m->path->count)) return 0;
+    return __match(m, child, next);
 }
 
-int simple_yaml_get_value_as_int(SimpleYamlNode* node, int32_t* value)
+/* Match the entries of the mappings merged into top, only those entries
+which a lookup of top would return (i.e. not overridden). The entries are
+matched at segment i, or with states when not NULL. */
+static int __match_merged(SimpleYamlMatch* m, SimpleYamlNode* top,
+        SimpleYamlNode* node, uint32_t i, const uint64_t* states,
+        uint64_t* next)
 {
-    assert(node);
-    assert(value);
-    if (node->node_type != YAML_SCALAR_NODE) return 1;
-    *value = strtol(node->value, NULL, 10);
+    if (node->node_type == YAML_SEQUENCE_NODE) {
+        for (uint32_t j = 0; j < hashlist_length(&node->sequence); j++) {
+            SimpleYamlNode* item = hashlist_get_at(&node->sequence, j);
+            if (__match_merged(m, top, item, i, states, next)) return 1;
+        }
+        return 0;
+    }
+    if (node->node_type != YAML_MAPPING_NODE) return 0;
+    for (uint32_t j = 0; j < node->mapping.count; j++) {
+        SimpleYamlMappingEntry* entry = &node->mapping.entries[j];
+        if (__is_merge_entry(entry)) {
+            if (__match_merged(m, top, entry->node, i, states, next)) return 1;
+        } else if (__mapping_lookup(top, entry->key, entry->length, 0, false)
+                != entry->node) {
+            continue;
+        } else if (states) {
+            if (__match_child(m, entry->node, entry->key, entry->length, 0,
+                    states, next)) return 1;
+        } else {
+            if (__match_segment(m, entry->node, i)) return 1;
+        }
+    }
     return 0;
 }
 
-int simple_yaml_get_value_as_uint(SimpleYamlNode* node, uint32_t* value)
+/* A path without "**" has a single state at each depth (its segment i),
+nodes are matched once each and in document order. */
+static int __match_segment(SimpleYamlMatch* m, SimpleYamlNode* node,
+        uint32_t i)
 {
-    assert(node);
-    assert(value);
-    if (node->node_type != YAML_SCALAR_NODE) return 1;
-    *value = strtoul(node->value, NULL, 10);
+    if (i == m->path->count) {
+        m->count++;
+        return m->callback ? m->callback(node, m->data) : 0;
+    }
+    const SimpleYamlPathSegment* segment = &m->path->segments[i];
+    if (segment->type == SIMPLE_YAML_PATH_KEY) {
+        SimpleYamlNode* child = __get_child(node, segment);
+        return child ? __match_segment(m, child, i + 1) : 0;
+    }
+    if (node->node_type == YAML_MAPPING_NODE) {
+        bool merge = (node->flags & SIMPLE_YAML_NODE_MERGE);
+        for (uint32_t j = 0; j < node->mapping.count; j++) {
+            SimpleYamlMappingEntry* entry = &node->mapping.entries[j];
+            if (merge && __is_merge_entry(entry)) continue;
+            if (__match_segment(m, entry->node, i + 1)) return 1;
+        }
+        for (uint32_t j = 0; merge && j < node->mapping.count; j++) {
+            SimpleYamlMappingEntry* entry = &node->mapping.entries[j];
+            if (!__is_merge_entry(entry)) continue;
+            if (__match_merged(m, node, entry->node, i + 1, NULL, NULL)) {
+                return 1;
+            }
+        }
+    } else if (node->node_type == YAML_SEQUENCE_NODE) {
+        for (uint32_t j = 0; j < hashlist_length(&node->sequence); j++) {
+            if (__match_segment(m, hashlist_get_at(&node->sequence, j), i + 1)) {
+                return 1;
+            }
+        }
+    }
     return 0;
 }
 
+/* Without wildcards, the children are found by lookup (once each, several
+key segments may find the same child). */
+static int __match_keys(SimpleYamlMatch* m, SimpleYamlNode* node,
+        const uint64_t* states, uint64_t* next)
+{
+    const SimpleYamlPathSegment* segments = m->path->segments;
+    for (uint32_t i = 0; i < m->path->count; i++) {
+        if (!__state_test(states, i)) continue;
+        SimpleYamlNode* child = __get_child(node, &segments[i]);
+        if (child == NULL) continue;
+        memset(next, 0, m->words * sizeof(uint64_t));
+        bool found = false;
+        for (uint32_t j = 0; j < m->path->count && !found; j++) {
+            if (j == i || (__state_test(states, j)
+                    && __get_child(node, &segments[j]) == child)) {
+                found = (j < i);
+                __state_add(m, next, j + 1);
+            }
+        }
+        if (!found && __match(m, child, next)) return 1;
+    }
+    return 0;
+}
 
-int main(void)
+/* Returns non-zero when the callback stops the search. */
+static int __match(SimpleYamlMatch* m, SimpleYamlNode* node,
+        const uint64_t* states)
 {
-    HashList* doc_list;
-    doc_list = simple_yaml_parse_file("sample.yaml", NULL);
-    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
-        SimpleYamlNode* doc = hashlist_get_at(doc_list, i);
-        SimpleYamlNode* kind_node = simple_yaml_find_node(doc, "kind");
-        SimpleYamlNode* name_node = simple_yaml_find_node(doc, "metadata/name");
-        SimpleYamlNode* app_node = simple_yaml_find_node(doc, "spec/selector/app");
-        printf("Document %d\n", i);
-        printf("  %s = %s\n", kind_node->name, kind_node->value);
-        printf("  %s = %s\n", name_node->name, name_node->value);
-        if (app_node) printf("  %s = %s\n", app_node->name, app_node->value);
+    uint64_t matched = (uint64_t)1 << (m->path->count % 64);
+    uint64_t current;
+    if (m->words == 1) {
+        /* A single key state (i.e. the segments before a "**") is
+        followed by lookup. */
+        current = states[0];
+        while (current && (current & (current - 1)) == 0
+                && !(current & (m->path->wildcards | matched))) {
+            uint32_t i = __builtin_ctzll(current);
+            node = __get_child(node, &m->path->segments[i]);
+            if (node == NULL) return 0;
+            current = 0;
+            __state_add(m, &current, i + 1);
+        }
+        states = &current;
+    }
+    if (__state_test(states, m->path->count)) {
+        m->count++;
+        if (m->callback && m->callback(node, m->data)) return 1;
+    }
+    if (node->node_type != YAML_MAPPING_NODE
+            && node->node_type != YAML_SEQUENCE_NODE) return 0;
+    if (m->words == 1 && (states[0] & ~matched) == 0) return 0;
+    bool wildcard = (m->words == 1 && (states[0] & m->path->wildcards));
+    for (uint32_t i = 0; m->words > 1 && i < m->path->count && !wildcard; i++) {
+        wildcard = __state_test(states, i)
+                && m->path->segments[i].type != SIMPLE_YAML_PATH_KEY;
+    }
 
-        SimpleYamlNode* ports_node = simple_yaml_find_node(doc, "spec/ports");
-        if (ports_node == NULL) continue;
-        if (ports_node->node_type != YAML_SEQUENCE_NODE) continue;
-        for (uint32_t port_index = 0; port_index < hashlist_length(&ports_node->sequence); port_index++) {
-            SimpleYamlNode* port_node = hashlist_get_at(&ports_node->sequence, port_index);
-            SimpleYamlNode* _n = simple_yaml_find_node(port_node, "targetPort");
-            if (_n) printf("  %s = %s\n", _n->name, _n->value);
+    /* States of the children (paths longer than 63 segments allocate). */
+    uint64_t word;
+    uint64_t* next = &word;
+    if (m->words > 1) {
+        next = malloc(m->words * sizeof(uint64_t));
+        if (next == NULL) {
+            errno = ENOMEM;
+            return 1;
         }
     }
+    int rc = 0;
+    if (!wildcard) {
+        rc = __match_keys(m, node, states, next);
+    } else if (node->node_type == YAML_MAPPING_NODE) {
+        bool merge = (node->flags & SIMPLE_YAML_NODE_MERGE);
+        for (uint32_t j = 0; j < node->mapping.count && rc == 0; j++) {
+            SimpleYamlMappingEntry* entry = &node->mapping.entries[j];
+            if (merge && __is_merge_entry(entry)) continue;
+            rc = __match_child(m, entry->node, entry->key, entry->length, 0,
+                    states, next);
+        }
+        for (uint32_t j = 0; merge && j < node->mapping.count && rc == 0; j++) {
+            SimpleYamlMappingEntry* entry = &node->mapping.entries[j];
+            if (!__is_merge_entry(entry)) continue;
+            rc = __match_merged(m, node, entry->node, 0, states, next);
+        }
+    } else {
+        uint32_t length = hashlist_length(&node->sequence);
+        for (uint32_t j = 0; j < length && rc == 0; j++) {
+            rc = __match_child(m, hashlist_get_at(&node->sequence, j),
+                    NULL, 0, j, states, next);
+        }
+    }
+    if (next != &word) free(next);
+    return rc;
+}
 
-    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
-        SimpleYamlNode* doc = hashlist_get_at(doc_list, i);
-        simple_yaml_destroy_node(doc);
+uint32_t simple_yaml_match_path(SimpleYamlNode* parent,
+        const SimpleYamlPath* path, SimpleYamlMatchCallback callback, void* data)
+{
+    SimpleYamlMatch m = { path, callback, data, 0, path->count / 64 + 1 };
+    if (parent == NULL) return 0;
+    if (m.words == 1 && path->descend == 0) {
+        __match_segment(&m, parent, 0);
+        return m.count;
+    }
+    uint64_t word = 0;
+    uint64_t* states = &word;
+    if (m.words > 1) {
+        states = calloc(m.words, sizeof(uint64_t));
+        if (states == NULL) {
+            errno = ENOMEM;
+            return 0;
+        }
     }
-    hashlist_destroy(doc_list);
-    free(doc_list);
+    __state_add(&m, states, 0);
+    __match(&m, parent, states);
+    if (states != &word) free(states);
+    return m.count;
+}
 
-    exit(0);
+static int __append_match(SimpleYamlNode* node, void* data)
+{
+    return hashlist_append((HashList*)data, node) != HASHMAP_SUCCESS;
+}
+
+uint32_t simple_yaml_find_all(
+        SimpleYamlNode* parent, const SimpleYamlPath* path, HashList* results)
+{
+    return simple_yaml_match_path(parent, path, __append_match, results);
+}
+
+static int __first_match(SimpleYamlNode* node, void* data)
+{
+    *(SimpleYamlNode**)data = node;
+    return 1;
+}
+
+SimpleYamlNode* simple_yaml_find_node_path(
+        SimpleYamlNode* parent, const SimpleYamlPath* path)
+{
+    SimpleYamlNode* node = NULL;
+    simple_yaml_match_path(parent, path, __first_match, &node);
+    return node;
+}
+
+SimpleYamlNode* simple_yaml_find_node(SimpleYamlNode* parent, const char* path)
+{
+    /* Wildcards are evaluated with a compiled path. */
+    if (strchr(path, '*')) {
+        SimpleYamlPath* compiled = simple_yaml_path_compile(path);
+        if (compiled == NULL) return NULL;
+        SimpleYamlNode* node = simple_yaml_find_node_path(parent, compiled);
+        simple_yaml_path_destroy(compiled);
+        return node;
+    }
+
+    /* Walk the path in place (reentrant, no allocation). */
+    SimpleYamlNode* node = parent;
+    const char* token = path;
+    while (node) {
+        while (*token == '/') token++;
+        if (*token == '\0') break;
+        size_t length = strcspn(token, "/");
+        if (node->node_type == YAML_SEQUENCE_NODE) {
+            uint32_t index = __parse_index(token, length);
+            if (index == SIMPLE_YAML_PATH_NO_INDEX) return NULL;
+            node = hashlist_get_at(&node->sequence, index);
+            token += length;
+            continue;
+        }
+        if (node->node_type != YAML_MAPPING_NODE) return NULL;
+        node = __mapping_lookup(node, token, length, 0, false);
+        token += length;
+    }
+    return node;
 }
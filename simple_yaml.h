@@ -10,36 +10,478 @@ MIT License
 #include <stdbool.h>
 #include <stdint.h>
 #include <yaml.h>
+#include <arena.h>
 #include <hashmap.h>
 #include <hashlist.h>
 
 
+#define SIMPLE_YAML_MAPPING_INDEX_THRESHOLD     8
+
+/* Node flags. */
+#define SIMPLE_YAML_NODE_VALUE_VIEW     0x0001  /* value references the source. */
+#define SIMPLE_YAML_NODE_NAME_INTERNED  0x0002  /* name is an interned key. */
+#define SIMPLE_YAML_NODE_KEYS_INTERNED  0x0004  /* All mapping keys are interned. */
+#define SIMPLE_YAML_NODE_QUOTED         0x0008  /* Quoted, block or tagged scalar. */
+#define SIMPLE_YAML_NODE_MERGE          0x0010  /* Mapping has merge (<<) keys. */
+#define SIMPLE_YAML_NODE_RESOLVED       0x0020  /* Document, scalars resolved. */
+
+/* Default limit of the nodes added to a document by aliases. */
+#define SIMPLE_YAML_ALIAS_LIMIT                 1000000
+
+
 typedef struct SimpleYamlNode SimpleYamlNode;
+typedef struct SimpleYamlKeys SimpleYamlKeys;
+
+typedef struct SimpleYamlMappingEntry {
+    const char*         key;
+    uint32_t            length;
+    SimpleYamlNode*     node;
+} SimpleYamlMappingEntry;
+
+/* Mapping storage. Entries are kept in an array (in insertion order) which
+is searched linearly, a hashed index is added once the number of entries
+exceeds the index threshold. A duplicate key replaces the node of the
+existing entry, which keeps its position.
+
+Merge keys (<<) remain as entries (in document order) which reference the
+merged mapping, or sequence of mappings. Their keys are not copied, a lookup
+which misses the own entries of a mapping searches the merged mappings. */
+typedef struct SimpleYamlMapping {
+    SimpleYamlMappingEntry* entries;
+    uint32_t            count;
+    uint32_t            capacity;
+    HashMap*            index;
+} SimpleYamlMapping;
+
+/* Scalar types, resolved with the YAML 1.2 core schema. */
+typedef enum SimpleYamlScalarType {
+    SIMPLE_YAML_SCALAR_UNRESOLVED = 0,
+    SIMPLE_YAML_SCALAR_NULL,
+    SIMPLE_YAML_SCALAR_BOOL,
+    SIMPLE_YAML_SCALAR_INT,
+    SIMPLE_YAML_SCALAR_FLOAT,
+    SIMPLE_YAML_SCALAR_STRING,
+} SimpleYamlScalarType;
+
+typedef struct SimpleYamlScalar {
+    SimpleYamlScalarType type;
+    int                 error;      /* ERANGE if the number overflowed. */
+    union {
+        bool            boolean;
+        int64_t         integer;
+        double          real;
+    } value;
+} SimpleYamlScalar;
 
 typedef struct SimpleYamlNode  {
     char*               name;
     yaml_node_type_t    node_type;
-    /* Node storage. */
+    uint32_t            flags;
+    /* Node storage. A value which is a view (see simple_yaml_parse_buffer)
+    is not NUL terminated, use value_length. */
     char*               value;
-    HashMap             mapping;
+    size_t              value_length;
+    /* The resolved value, cached by the first accessor which needs it. For
+    a quoted scalar (a string) this is the value as if plain, which the
+    value accessors convert. */
+    SimpleYamlScalar    scalar;
+    SimpleYamlMapping   mapping;
     HashList            sequence;
-    /* Document structure. */
+    /* Document structure. A node referenced by aliases is shared, it keeps
+    the name and parent of the anchored node (the key of each reference is
+    held by its mapping entry). */
     SimpleYamlNode*     parent;
+    uint32_t            refs;       /* References by aliases, or doc_lists. */
+    /* Storage, when set the node is allocated from the document arena. */
+    Arena*              arena;
 } SimpleYamlNode;
 
+/* Compiled path, see simple_yaml_path_compile(). */
+#define SIMPLE_YAML_PATH_NO_INDEX   UINT32_MAX
+
+typedef enum SimpleYamlPathSegmentType {
+    SIMPLE_YAML_PATH_KEY = 0,   /* Mapping key, or sequence index. */
+    SIMPLE_YAML_PATH_ANY,       /* "*", any child. */
+    SIMPLE_YAML_PATH_DESCEND,   /* "**", any descendant (or the node). */
+} SimpleYamlPathSegmentType;
+
+typedef struct SimpleYamlPathSegment {
+    const char*         key;
+    uint32_t            length;
+    SimpleYamlPathSegmentType type;
+    uint64_t            hash;
+    uint32_t            index;
+} SimpleYamlPathSegment;
+
+typedef struct SimpleYamlPath {
+    uint32_t                count;
+    /* Bit masks of the wildcard ("*" and "**") and "**" segments, only of
+    paths with less than 64 segments. */
+    uint64_t                wildcards;
+    uint64_t                descend;
+    SimpleYamlPathSegment   segments[];
+} SimpleYamlPath;
+
+typedef struct SimpleYamlOptions {
+    /* Allocate each document (nodes, keys, scalars and collection storage)
+    from its own Arena, destroying the root node releases the document. */
+    bool                use_arena;
+    size_t              arena_block_size;   /* 0 for the default size. */
+    /* Scalars which appear unchanged in the source buffer (no escapes or
+    folding) reference the buffer rather than being copied. The buffer
+    must outlive the documents. */
+    bool                zero_copy;
+    /* Selective parsing, a NULL terminated list of paths (i.e. "kind",
+    "metadata/name", "spec/ports", wildcards are supported). Only matching
+    nodes (with their subtree) and their ancestors are built. Below a
+    wildcard, collections which may contain a match are built, and are left
+    empty when none does. Unselected sequence items are kept as empty
+    (YAML_NO_NODE) nodes so that item indexes are preserved. */
+    const char**        select;
+    /* Intern mapping keys in this table, each distinct key is then stored
+    once (with its hash) for all documents parsed with the table, and keys
+    compare by pointer. The table must outlive the documents. */
+    SimpleYamlKeys*     keys;
+    /* Parse the documents of a multi-document stream with this many
+    threads (0 or 1 parses serially). Requires the whole stream in memory,
+    simple_yaml_parse_file_alt() maps the file. */
+    uint32_t            threads;
+    /* Resolve the type and value of each scalar while parsing, rather than
+    on first access. The value accessors then do not modify the documents,
+    which may be read by several threads. */
+    bool                resolve_scalars;
+    /* Aliases reference the anchored node, which is shared rather than
+    copied. The parse fails (EOVERFLOW) if the aliases of a document would
+    add more than this many nodes when expanded (0 for the default,
+    SIMPLE_YAML_ALIAS_LIMIT), or EINVAL for an undefined anchor. When parsing
+    selectively, an alias of an anchor which was not selected (or only
+    partly) is skipped. */
+    uint64_t            alias_limit;
+} SimpleYamlOptions;
+
+/* Counters of the calling thread, collected when the library is compiled
+with SIMPLE_YAML_STATS defined (make STATS=1), otherwise they remain zero.
+Documents parsed in parallel are counted by the worker threads. */
+typedef struct SimpleYamlStats {
+    uint64_t            events;             /* libyaml events processed. */
+    uint64_t            nodes;              /* Nodes created. */
+    uint64_t            mappings;
+    uint64_t            sequences;
+    uint64_t            scalars;
+    uint64_t            scalar_views;       /* Scalars not copied (zero_copy). */
+    uint64_t            key_bytes;          /* Bytes copied for keys. */
+    uint64_t            scalar_bytes;       /* Bytes copied for scalars. */
+    uint64_t            hashmap_resizes;
+    uint64_t            hashmap_relayouts;
+    uint64_t            hashmap_lookups;
+    uint64_t            hashmap_probes;     /* Buckets visited by lookups. */
+    uint64_t            hashmap_max_probe;
+    uint64_t            parse_ns;           /* Time spent in libyaml. */
+    uint64_t            build_ns;           /* Time spent building nodes. */
+} SimpleYamlStats;
+
+typedef struct SimpleYamlMmap {
+    void*               data;
+    size_t              length;
+} SimpleYamlMmap;
+
 
 SimpleYamlNode* simple_yaml_create_node(char* name, SimpleYamlNode* parent);
+SimpleYamlNode* simple_yaml_create_root_node(Arena* arena);
 void simple_yaml_set_mapping(SimpleYamlNode* parent);
 void simple_yaml_set_sequence(SimpleYamlNode* node);
 void simple_yaml_set_scalar(SimpleYamlNode* node, const char* value);
+void simple_yaml_set_scalar_view(SimpleYamlNode* node, const char* value, size_t length);
 void simple_yaml_destroy_node(SimpleYamlNode* node);
 
+SimpleYamlNode* simple_yaml_mapping_get(SimpleYamlNode* node, const char* key);
+/* Iterate the entries of a mapping in document order, index 0 to length-1.
+simple_yaml_mapping_get_at() returns NULL if the index is out of range, or
+the node is not a mapping. */
+uint32_t simple_yaml_mapping_length(SimpleYamlNode* node);
+const SimpleYamlMappingEntry* simple_yaml_mapping_get_at(
+        SimpleYamlNode* node, uint32_t index);
+void simple_yaml_set_mapping_index_threshold(uint32_t threshold);
+uint32_t simple_yaml_get_mapping_index_threshold(void);
+
 HashList* simple_yaml_parse_file(const char* filename, HashList* doc_list);
+HashList* simple_yaml_parse_file_alt(const char* filename, HashList* doc_list,
+        const SimpleYamlOptions* options);
+HashList* simple_yaml_parse_buffer(const char* buffer, size_t length,
+        HashList* doc_list, const SimpleYamlOptions* options);
+/* Parse a memory mapped file. When map is provided the mapping is kept, and
+scalars reference it (zero_copy), release with simple_yaml_munmap() after the
+documents are destroyed. */
+HashList* simple_yaml_parse_mmap(const char* filename, HashList* doc_list,
+        const SimpleYamlOptions* options, SimpleYamlMmap* map);
+void simple_yaml_munmap(SimpleYamlMmap* map);
+/* Parse with options->threads, documents are split at their "---" markers
+and parsed by a pool of threads (each with its own parser and allocator)
+then returned in their original order. Streams with directives are parsed
+serially. */
+HashList* simple_yaml_parse_buffer_parallel(const char* buffer, size_t length,
+        HashList* doc_list, const SimpleYamlOptions* options);
+
+/* Reload a stream, reusing the unchanged documents of previous (the
+doc_list returned by the last reload with this SimpleYamlReload, initially
+zeroed, or NULL). The stream is split at its "---" markers, each part is
+hashed, and only the parts which changed since the last reload are parsed
+(unchanged parts are matched by hash, in order, so inserted, removed or
+moved documents do not change the others). A reused document is shared by
+previous and the new doc_list (counted by refs), each doc_list is destroyed
+as usual. The changes are document
+indexes, replaced and added of the new doc_list (replaced_previous is the
+index in previous of each replaced document), and removed of previous. Use
+the same options for each reload, zero_copy and threads are not used.
+Returns the new doc_list, or NULL (errno is set) when a changed part can
+not be parsed, reload is then unchanged. Release with
+simple_yaml_reload_release(). */
+typedef struct SimpleYamlReload {
+    uint32_t*           replaced;
+    uint32_t*           replaced_previous;
+    uint32_t            replaced_count;
+    uint32_t*           added;
+    uint32_t            added_count;
+    uint32_t*           removed;
+    uint32_t            removed_count;
+    uint32_t            reused;     /* Documents not parsed. */
+    /* Private. */
+    const HashList*     doc_list;
+    struct SimpleYamlRange* ranges;
+    uint32_t            range_count;
+} SimpleYamlReload;
+
+HashList* simple_yaml_reload_buffer(SimpleYamlReload* reload,
+        HashList* previous, const char* buffer, size_t length,
+        const SimpleYamlOptions* options);
+HashList* simple_yaml_reload_file(SimpleYamlReload* reload,
+        HashList* previous, const char* filename,
+        const SimpleYamlOptions* options);
+void simple_yaml_reload_release(SimpleYamlReload* reload);
+
+/* Shared documents, read by several threads while a reloader replaces them.
+A snapshot is a published doc_list, simple_yaml_shared_acquire() returns
+the current snapshot (without a lock), which remains valid until released.
+simple_yaml_shared_publish() makes doc_list the current snapshot, the
+previous snapshot is destroyed (with its documents) when its last reader
+releases it. Publishers are serialised, and wait briefly for readers which
+are acquiring the previous snapshot. simple_yaml_shared_destroy() releases
+the current snapshot, snapshots held by readers remain valid.
 
+Lookups (simple_yaml_find_node(), simple_yaml_mapping_get(), paths and
+iteration) do not modify the documents. The value accessors resolve scalars
+on first use, so the scalars of each document are resolved before it is
+shared: documents parsed with SimpleYamlOptions.resolve_scalars (which
+simple_yaml_reload_buffer() passes on) are marked SIMPLE_YAML_NODE_RESOLVED,
+otherwise simple_yaml_shared_create() and simple_yaml_shared_publish() walk
+the document. A reused document is shared by two doc_lists, which may be
+destroyed by different threads. */
+typedef struct SimpleYamlSnapshot {
+    HashList*           doc_list;
+    uint64_t            version;    /* Publication number, from 1. */
+    /* Private. */
+    uint32_t            refs;
+} SimpleYamlSnapshot;
+typedef struct SimpleYamlShared SimpleYamlShared;
+
+SimpleYamlShared* simple_yaml_shared_create(HashList* doc_list);
+void simple_yaml_shared_destroy(SimpleYamlShared* shared);
+int simple_yaml_shared_publish(SimpleYamlShared* shared, HashList* doc_list);
+const SimpleYamlSnapshot* simple_yaml_shared_acquire(SimpleYamlShared* shared);
+void simple_yaml_snapshot_release(const SimpleYamlSnapshot* snapshot);
+
+/* Document iterator, each call to simple_yaml_stream_next_document() parses
+and returns the next document of the stream (the caller owns, and destroys,
+each document). Returns NULL at the end of the stream, or on error (when
+errno is set). */
+typedef struct SimpleYamlStream SimpleYamlStream;
+SimpleYamlStream* simple_yaml_stream_open(const char* filename,
+        const SimpleYamlOptions* options);
+SimpleYamlStream* simple_yaml_stream_open_buffer(const char* buffer,
+        size_t length, const SimpleYamlOptions* options);
+SimpleYamlNode* simple_yaml_stream_next_document(SimpleYamlStream* stream);
+void simple_yaml_stream_close(SimpleYamlStream* stream);
+
+/* Key interning table (see SimpleYamlOptions.keys), which may be shared by
+several threads. simple_yaml_keys_find() returns NULL if the key is not
+interned. The hash (hashmap_default_hash_length) and length of an interned key are
+stored with it. */
+SimpleYamlKeys* simple_yaml_keys_create(void);
+void simple_yaml_keys_destroy(SimpleYamlKeys* keys);
+const char* simple_yaml_keys_intern(SimpleYamlKeys* keys, const char* key);
+const char* simple_yaml_keys_find(SimpleYamlKeys* keys, const char* key);
+uint32_t simple_yaml_keys_count(SimpleYamlKeys* keys);
+uint64_t simple_yaml_keys_hash(const char* interned);
+size_t simple_yaml_keys_length(const char* interned);
+
+void simple_yaml_stats_get(SimpleYamlStats* stats);
+void simple_yaml_stats_reset(void);
+
+/* Paths are a "/" separated list of segments: a mapping key, a sequence
+index (i.e. "spec/ports/0/port"), "*" for any child, or "**" for the node
+and any of its descendants. With wildcards the first match is returned. */
 SimpleYamlNode* simple_yaml_find_node(SimpleYamlNode* parent, const char* path);
+/* Compile a path (i.e. "spec/selector/app") for repeated use, the compiled
+path is read-only and may be shared between threads. */
+SimpleYamlPath* simple_yaml_path_compile(const char* path);
+void simple_yaml_path_destroy(SimpleYamlPath* path);
+SimpleYamlNode* simple_yaml_find_node_path(SimpleYamlNode* parent, const SimpleYamlPath* path);
+/* Find all matching nodes in a single traversal (document order). The
+callback returns non-zero to stop the search. Returns the number of matches. */
+typedef int (*SimpleYamlMatchCallback)(SimpleYamlNode* node, void* data);
+uint32_t simple_yaml_match_path(SimpleYamlNode* parent, const SimpleYamlPath* path,
+        SimpleYamlMatchCallback callback, void* data);
+/* Append all matching nodes to results. */
+uint32_t simple_yaml_find_all(SimpleYamlNode* parent, const SimpleYamlPath* path,
+        HashList* results);
+
+/* Scalar values are resolved once, with the YAML 1.2 core schema, and cached
+on the node (see SimpleYamlOptions.resolve_scalars). Quoted and block scalars
+are strings. simple_yaml_resolve_scalar() returns NULL if the node is not a
+scalar. The value accessors return 0, EINVAL if the node is not a scalar of
+a compatible type (i.e. 12abc is a string), or ERANGE if the value does not
+fit (the value is then clamped). The accessors also convert the text of
+quoted scalars (i.e. "8080", resolved once as if plain), a bool may also be one of the YAML 1.1 forms
+(y/yes/on, n/no/off) and an int is also accepted as a double. Numbers are
+classified with SSE2/AVX2 when the CPU supports them, the environment
+variable SIMPLE_YAML_SIMD=none|sse2 limits the selection. */
+const SimpleYamlScalar* simple_yaml_resolve_scalar(SimpleYamlNode* node);
+SimpleYamlScalarType simple_yaml_get_scalar_type(SimpleYamlNode* node);
 int simple_yaml_get_value_as_bool(SimpleYamlNode* node, bool* value);
 int simple_yaml_get_value_as_int(SimpleYamlNode* node, int32_t* value);
 int simple_yaml_get_value_as_uint(SimpleYamlNode* node, uint32_t* value);
+int simple_yaml_get_value_as_int64(SimpleYamlNode* node, int64_t* value);
+int simple_yaml_get_value_as_double(SimpleYamlNode* node, double* value);
+
+
+/* Streaming (visitor) interface. Callbacks are made for each event of the
+YAML stream, with the path of the current node, without building a tree.
+Memory use is proportional to the depth of the documents. */
+typedef enum SimpleYamlEventType {
+    SIMPLE_YAML_EVENT_DOCUMENT_START,
+    SIMPLE_YAML_EVENT_DOCUMENT_END,
+    SIMPLE_YAML_EVENT_KEY,              /* Mapping key, the value follows. */
+    SIMPLE_YAML_EVENT_SCALAR,
+    SIMPLE_YAML_EVENT_ALIAS,            /* value is the anchor name. */
+    SIMPLE_YAML_EVENT_MAPPING_START,
+    SIMPLE_YAML_EVENT_MAPPING_END,
+    SIMPLE_YAML_EVENT_SEQUENCE_START,
+    SIMPLE_YAML_EVENT_SEQUENCE_END,
+} SimpleYamlEventType;
+
+typedef struct SimpleYamlEvent {
+    SimpleYamlEventType type;
+    uint32_t            document;       /* Index of the document. */
+    uint32_t            depth;          /* Number of segments in path. */
+    const char*         path;           /* i.e. "spec/ports/0/targetPort" */
+    size_t              path_length;
+    const char*         key;            /* Key of the node, or NULL. */
+    uint32_t            index;          /* Sequence index (when key is NULL). */
+    const char*         value;          /* Scalar value, or NULL. */
+    size_t              length;
+} SimpleYamlEvent;
+
+/* Callback return values. SKIP skips the document (DOCUMENT_START), the
+value (KEY), or the collection (MAPPING_START and SEQUENCE_START). */
+#define SIMPLE_YAML_VISIT_CONTINUE  0
+#define SIMPLE_YAML_VISIT_SKIP      1
+#define SIMPLE_YAML_VISIT_STOP      2
+
+/* The event, and its strings, are only valid during the callback. */
+typedef int (*SimpleYamlVisitCallback)(const SimpleYamlEvent* event, void* data);
+int simple_yaml_visit_file(const char* filename,
+        SimpleYamlVisitCallback callback, void* data);
+int simple_yaml_visit_buffer(const char* buffer, size_t length,
+        SimpleYamlVisitCallback callback, void* data);
+
+
+
+/* Emit nodes (or the documents of a doc_list, each starting with "---") as
+block style YAML. Output is appended to a growable buffer (zero initialise
+it, or supply a malloc'd one, release with simple_yaml_buffer_release()),
+the data is NUL terminated. Or output is written, in large blocks, to a file
+descriptor. Scalars are written plain when they read back as the same text,
+otherwise (and if quoted in the source) they are double quoted. Nodes shared
+by aliases are written at each reference. Returns 0, or an errno value. */
+typedef struct SimpleYamlBuffer {
+    char*               data;
+    size_t              length;
+    size_t              capacity;
+} SimpleYamlBuffer;
+
+int simple_yaml_emit_buffer(SimpleYamlNode* node, SimpleYamlBuffer* buffer);
+int simple_yaml_emit_fd(SimpleYamlNode* node, int fd);
+int simple_yaml_emit_documents_buffer(HashList* doc_list,
+        SimpleYamlBuffer* buffer);
+int simple_yaml_emit_documents_fd(HashList* doc_list, int fd);
+void simple_yaml_buffer_release(SimpleYamlBuffer* buffer);
+
+
+/* Frozen documents. simple_yaml_freeze() copies the documents of a doc_list
+into a tape, a single read-only allocation: fixed size nodes referenced by
+32-bit indexes, mapping entries (with a hashed index above the index
+threshold), and a pool of deduplicated, NUL terminated, strings. Scalars
+are resolved while freezing, nodes shared by aliases are frozen once. The
+doc_list is not modified (other than resolving scalars) and may be destroyed
+afterwards. Lookups do not modify the tape, so a tape may be read by several
+threads. Paths are as simple_yaml_find_node(), without wildcards. */
+typedef struct SimpleYamlTape SimpleYamlTape;
+typedef uint32_t SimpleYamlTapeRef;
+#define SIMPLE_YAML_TAPE_NONE   0
+
+SimpleYamlTape* simple_yaml_freeze(HashList* doc_list);
+void simple_yaml_tape_destroy(SimpleYamlTape* tape);
+size_t simple_yaml_tape_size(const SimpleYamlTape* tape);
+uint32_t simple_yaml_tape_document_count(const SimpleYamlTape* tape);
+SimpleYamlTapeRef simple_yaml_tape_document(const SimpleYamlTape* tape, uint32_t index);
+SimpleYamlTapeRef simple_yaml_tape_find(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, const char* path);
+SimpleYamlTapeRef simple_yaml_tape_mapping_get(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, const char* key);
+yaml_node_type_t simple_yaml_tape_node_type(const SimpleYamlTape* tape, SimpleYamlTapeRef ref);
+/* Iterate mapping entries (key is set) or sequence items, index 0 to
+length-1. */
+uint32_t simple_yaml_tape_length(const SimpleYamlTape* tape, SimpleYamlTapeRef ref);
+SimpleYamlTapeRef simple_yaml_tape_get_at(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, uint32_t index, const char** key);
+/* Values, as the scalar accessors. Quoted scalars are strings, the YAML 1.1
+bool forms are not accepted. */
+const char* simple_yaml_tape_value(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, size_t* length);
+SimpleYamlScalarType simple_yaml_tape_scalar_type(const SimpleYamlTape* tape, SimpleYamlTapeRef ref);
+int simple_yaml_tape_get_bool(const SimpleYamlTape* tape, SimpleYamlTapeRef ref, bool* value);
+int simple_yaml_tape_get_int64(const SimpleYamlTape* tape, SimpleYamlTapeRef ref, int64_t* value);
+int simple_yaml_tape_get_double(const SimpleYamlTape* tape, SimpleYamlTapeRef ref, double* value);
+/* A tape is position independent, simple_yaml_tape_size() bytes from its
+start may be written to a file and read back (e.g. memory mapped) on a host
+of the same byte order. simple_yaml_tape_validate() checks the layout and that
+every reference is in bounds, returning 0 or EINVAL, simple_yaml_tape_open()
+validates the data and returns it as a tape (not to be destroyed), or NULL
+with errno set. */
+int simple_yaml_tape_validate(const void* data, size_t length);
+const SimpleYamlTape* simple_yaml_tape_open(const void* data, size_t length);
+
+
+/* Cached documents. simple_yaml_cache_open() uses the cache file when it
+matches filename (same size and mtime, or same size and content hash) and is
+valid, the tape is then read in place from the mapped cache. Otherwise the
+file is parsed (with options), frozen, and the cache file is rewritten (via a
+temporary file and rename). A cache that can not be written is reported, the
+parsed tape is still used. Returns 0, or an errno value when the file (any
+of its documents) can not be parsed, a partly parsed file is not cached.
+Release with simple_yaml_cache_close(). */
+typedef struct SimpleYamlCache {
+    const SimpleYamlTape*   tape;
+    bool                    rebuilt;    /* The file was parsed. */
+    /* Private. */
+    SimpleYamlMmap          map;
+    SimpleYamlTape*         owned;
+} SimpleYamlCache;
 
+int simple_yaml_cache_open(SimpleYamlCache* cache, const char* filename,
+        const char* cache_filename, const SimpleYamlOptions* options);
+void simple_yaml_cache_close(SimpleYamlCache* cache);
+/* Check a cache file (header, checksum and tape), returns 0 or EINVAL. */
+int simple_yaml_cache_validate(const void* data, size_t length);
 
 #endif /* SIMPLE_YAML_H */
@@ -0,0 +1,259 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <simple_yaml.h>
+
+
+#define CACHE_MAGIC         0x31435953      /* "SYC1" */
+#define CACHE_VERSION       1
+#define CACHE_BYTE_ORDER    0x01020304
+
+
+/* The cache file is this header, followed by the tape. The tape holds
+integers (and key hashes) in host byte order, a cache written on a host of
+another byte order is rejected. The header size keeps the tape aligned. */
+typedef struct CacheHeader {
+    uint32_t            magic;
+    uint32_t            version;
+    uint32_t            byte_order;
+    uint32_t            header_size;
+    /* The source file. */
+    uint64_t            source_size;
+    int64_t             source_mtime;       /* Nanoseconds. */
+    uint64_t            source_hash;
+    /* The tape. */
+    uint64_t            tape_size;
+    uint64_t            tape_hash;
+    uint64_t            reserved;
+} CacheHeader;
+
+
+static int64_t __mtime(const struct stat* st)
+{
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+/* Map a file, an empty file has no mapping (data is NULL). */
+static int __map(const char* filename, SimpleYamlMmap* map, struct stat* st)
+{
+    memset(map, 0, sizeof(SimpleYamlMmap));
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) return errno;
+    if (fstat(fd, st) == -1) {
+        int rc = errno;
+        close(fd);
+        return rc;
+    }
+    if (st->st_size) {
+        void* data = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int rc = errno;
+            close(fd);
+            return rc;
+        }
+        map->data = data;
+        map->length = st->st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+int simple_yaml_cache_validate(const void* data, size_t length)
+{
+    const CacheHeader* header = data;
+    if (data == NULL || length < sizeof(CacheHeader)) return EINVAL;
+    if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION
+            || header->byte_order != CACHE_BYTE_ORDER
+            || header->header_size != sizeof(CacheHeader)
+            || header->tape_size != length - sizeof(CacheHeader)) {
+        return EINVAL;
+    }
+    /* The hash detects a corrupt (i.e. truncated or partly written) tape,
+    the tape is then checked so that its references are in bounds. */
+    const char* tape = (const char*)data + sizeof(CacheHeader);
+    if (hashmap_default_hash_length(tape, header->tape_size)
+            != header->tape_hash) return EINVAL;
+    return simple_yaml_tape_validate(tape, header->tape_size);
+}
+
+/* Returns true if the cache matches the source, by size and mtime or (when
+only the mtime differs) by the content hash. */
+static bool __fresh(const CacheHeader* header, const char* filename,
+        const struct stat* source)
+{
+    if (header->source_size != (uint64_t)source->st_size) return false;
+    if (header->source_mtime == __mtime(source)) return true;
+    SimpleYamlMmap map;
+    struct stat st;
+    if (__map(filename, &map, &st)) return false;
+    bool fresh = map.length == header->source_size
+            && hashmap_default_hash_length(map.data, map.length)
+                    == header->source_hash;
+    simple_yaml_munmap(&map);
+    return fresh;
+}
+
+/* The source was touched but not changed, record its mtime so that the
+next open does not hash it again. */
+static void __touch(const char* cache_filename, const struct stat* source)
+{
+    int64_t mtime = __mtime(source);
+    int fd = open(cache_filename, O_WRONLY);
+    if (fd == -1) return;
+    if (pwrite(fd, &mtime, sizeof(mtime), offsetof(CacheHeader, source_mtime))
+            != sizeof(mtime)) {
+        perror("Error writing YAML cache");
+    }
+    close(fd);
+}
+
+static int __write(const SimpleYamlTape* tape,
+        const struct stat* source, uint64_t source_hash,
+        const char* cache_filename)
+{
+    CacheHeader header = { 0 };
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.header_size = sizeof(CacheHeader);
+    header.source_size = source->st_size;
+    header.source_mtime = __mtime(source);
+    header.source_hash = source_hash;
+    header.tape_size = simple_yaml_tape_size(tape);
+    header.tape_hash = hashmap_default_hash_length(
+            (const char*)tape, header.tape_size);
+
+    /* Write a temporary file, then rename it, readers see the old or the
+    new cache (never a partial one). */
+    size_t length = strlen(cache_filename);
+    char* temp = malloc(length + 8);
+    if (temp == NULL) return ENOMEM;
+    snprintf(temp, length + 8, "%s.XXXXXX", cache_filename);
+    int fd = mkstemp(temp);
+    if (fd == -1) {
+        int rc = errno;
+        free(temp);
+        return rc;
+    }
+    int rc = 0;
+    const char* parts[] = { (const char*)&header, (const char*)tape };
+    size_t sizes[] = { sizeof(CacheHeader), header.tape_size };
+    for (int i = 0; i < 2 && rc == 0; i++) {
+        size_t offset = 0;
+        while (offset < sizes[i]) {
+            ssize_t n = write(fd, parts[i] + offset, sizes[i] - offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                rc = errno;
+                break;
+            }
+            offset += n;
+        }
+    }
+    if (close(fd) == -1 && rc == 0) rc = errno;
+    if (rc == 0 && rename(temp, cache_filename) == -1) rc = errno;
+    if (rc) unlink(temp);
+    free(temp);
+    return rc;
+}
+
+/* Parse and freeze the source, then write the cache. */
+static int __rebuild(SimpleYamlCache* cache, const char* filename,
+        const char* cache_filename, const SimpleYamlOptions* options)
+{
+    SimpleYamlMmap map;
+    struct stat st;
+    int rc = __map(filename, &map, &st);
+    if (rc) return rc;
+    uint64_t source_hash = hashmap_default_hash_length(map.data, map.length);
+    errno = 0;
+    HashList* doc_list = simple_yaml_parse_buffer(
+            map.data, map.length, NULL, options);
+    /* A partly parsed stream (errno set) is not cached. */
+    if (doc_list == NULL || errno) {
+        rc = errno ? errno : ECANCELED;
+    } else {
+        cache->owned = simple_yaml_freeze(doc_list);
+        rc = cache->owned ? 0 : errno;
+    }
+    if (doc_list) {
+        for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+            simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+        }
+        hashlist_destroy(doc_list);
+        free(doc_list);
+    }
+    simple_yaml_munmap(&map);
+    if (rc) return rc;
+    cache->tape = cache->owned;
+    cache->rebuilt = true;
+
+    /* The parsed tape is used even if the cache can not be written. */
+    rc = __write(cache->owned, &st, source_hash, cache_filename);
+    if (rc) {
+        errno = rc;
+        perror("Error writing YAML cache");
+    }
+    return 0;
+}
+
+int simple_yaml_cache_open(SimpleYamlCache* cache, const char* filename,
+        const char* cache_filename, const SimpleYamlOptions* options)
+{
+    errno = 0;
+    memset(cache, 0, sizeof(SimpleYamlCache));
+    struct stat source;
+    if (stat(filename, &source) == -1) {
+        int rc = errno;
+        perror("Error opening file");
+        return rc;
+    }
+
+    /* Use the cache, in place, when it is valid and fresh. */
+    struct stat st;
+    if (__map(cache_filename, &cache->map, &st) == 0) {
+        const CacheHeader* header = cache->map.data;
+        if (simple_yaml_cache_validate(cache->map.data, cache->map.length) == 0
+                && __fresh(header, filename, &source)) {
+            if (header->source_mtime != __mtime(&source)) {
+                __touch(cache_filename, &source);
+            }
+            cache->tape = simple_yaml_tape_open(
+                    (const char*)cache->map.data + sizeof(CacheHeader),
+                    header->tape_size);
+            return 0;
+        }
+        simple_yaml_munmap(&cache->map);
+    }
+
+    int rc = __rebuild(cache, filename, cache_filename, options);
+    if (rc) {
+        errno = rc;
+        perror("Error building YAML cache");
+        errno = rc;
+    }
+    return rc;
+}
+
+void simple_yaml_cache_close(SimpleYamlCache* cache)
+{
+    if (cache == NULL) return;
+    simple_yaml_munmap(&cache->map);
+    simple_yaml_tape_destroy(cache->owned);
+    memset(cache, 0, sizeof(SimpleYamlCache));
+}
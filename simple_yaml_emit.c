@@ -0,0 +1,454 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <simple_yaml.h>
+
+
+#define EMIT_BLOCK_SIZE     (64 * 1024)     /* Writes to a file descriptor. */
+#define EMIT_INDENT         2
+#define EMIT_SPACES         64
+
+
+/* Character classes, for scalars. */
+#define C_BREAK             0x01    /* Control character, must be quoted. */
+#define C_ESCAPE            0x02    /* Escaped when double quoted. */
+#define C_CHECK             0x04    /* Plain, depending on the neighbours. */
+#define C_INDICATOR         0x08    /* Not plain as the first character. */
+#define C_UNICODE           0x10    /* Lead byte of a possible special. */
+
+static const unsigned char char_class[256] = {
+    [0x00] = C_BREAK | C_ESCAPE, [0x01] = C_BREAK | C_ESCAPE,
+    [0x02] = C_BREAK | C_ESCAPE, [0x03] = C_BREAK | C_ESCAPE,
+    [0x04] = C_BREAK | C_ESCAPE, [0x05] = C_BREAK | C_ESCAPE,
+    [0x06] = C_BREAK | C_ESCAPE, [0x07] = C_BREAK | C_ESCAPE,
+    [0x08] = C_BREAK | C_ESCAPE, [0x09] = C_BREAK | C_ESCAPE,
+    [0x0a] = C_BREAK | C_ESCAPE, [0x0b] = C_BREAK | C_ESCAPE,
+    [0x0c] = C_BREAK | C_ESCAPE, [0x0d] = C_BREAK | C_ESCAPE,
+    [0x0e] = C_BREAK | C_ESCAPE, [0x0f] = C_BREAK | C_ESCAPE,
+    [0x10] = C_BREAK | C_ESCAPE, [0x11] = C_BREAK | C_ESCAPE,
+    [0x12] = C_BREAK | C_ESCAPE, [0x13] = C_BREAK | C_ESCAPE,
+    [0x14] = C_BREAK | C_ESCAPE, [0x15] = C_BREAK | C_ESCAPE,
+    [0x16] = C_BREAK | C_ESCAPE, [0x17] = C_BREAK | C_ESCAPE,
+    [0x18] = C_BREAK | C_ESCAPE, [0x19] = C_BREAK | C_ESCAPE,
+    [0x1a] = C_BREAK | C_ESCAPE, [0x1b] = C_BREAK | C_ESCAPE,
+    [0x1c] = C_BREAK | C_ESCAPE, [0x1d] = C_BREAK | C_ESCAPE,
+    [0x1e] = C_BREAK | C_ESCAPE, [0x1f] = C_BREAK | C_ESCAPE,
+    [0x7f] = C_BREAK | C_ESCAPE,
+    ['"'] = C_ESCAPE | C_INDICATOR, ['\\'] = C_ESCAPE,
+    [':'] = C_CHECK | C_INDICATOR, ['#'] = C_CHECK | C_INDICATOR,
+    [' '] = C_INDICATOR, ['-'] = C_INDICATOR, ['?'] = C_INDICATOR,
+    [','] = C_INDICATOR, ['['] = C_INDICATOR, [']'] = C_INDICATOR,
+    ['{'] = C_INDICATOR, ['}'] = C_INDICATOR, ['&'] = C_INDICATOR,
+    ['*'] = C_INDICATOR, ['!'] = C_INDICATOR, ['|'] = C_INDICATOR,
+    ['>'] = C_INDICATOR, ['\''] = C_INDICATOR, ['%'] = C_INDICATOR,
+    ['@'] = C_INDICATOR, ['`'] = C_INDICATOR,
+    [0xc2] = C_UNICODE, [0xe2] = C_UNICODE, [0xef] = C_UNICODE,
+};
+
+static const char spaces[EMIT_SPACES + 1] =
+        "                                                                ";
+
+
+/* Output is written to a growable buffer, or staged in a block which is
+written to the file descriptor when full. */
+typedef struct Emitter {
+    char*               data;
+    size_t              length;
+    size_t              capacity;
+    SimpleYamlBuffer*   buffer;
+    int                 fd;
+    int                 error;
+} Emitter;
+
+
+static int __emit_flush(Emitter* e)
+{
+    size_t offset = 0;
+    while (offset < e->length) {
+        ssize_t n = write(e->fd, e->data + offset, e->length - offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            e->error = errno;
+            return e->error;
+        }
+        offset += n;
+    }
+    e->length = 0;
+    return 0;
+}
+
+/* Make room for length bytes, returns non-zero if the bytes should be
+written directly to the file descriptor (or on error). */
+static int __emit_reserve(Emitter* e, size_t length)
+{
+    if (e->error) return e->error;
+    if (e->buffer == NULL) {
+        if (__emit_flush(e)) return e->error;
+        return length > e->capacity;
+    }
+    /* Keep room for the terminating NUL. */
+    size_t capacity = e->capacity ? e->capacity : 4096;
+    while (capacity < e->length + length + 1) capacity *= 2;
+    char* data = realloc(e->data, capacity);
+    if (data == NULL) {
+        e->error = ENOMEM;
+        return e->error;
+    }
+    e->data = data;
+    e->capacity = capacity;
+    return 0;
+}
+
+static void __emit_write(Emitter* e, const char* s, size_t length)
+{
+    if (length >= e->capacity - e->length && __emit_reserve(e, length)) {
+        if (e->error) return;
+        /* Larger than the block, write through. */
+        Emitter direct = { (char*)s, length, length, NULL, e->fd, 0 };
+        e->error = __emit_flush(&direct);
+        return;
+    }
+    memcpy(e->data + e->length, s, length);
+    e->length += length;
+}
+
+static void __emit_char(Emitter* e, char c)
+{
+    if (e->length + 1 >= e->capacity && __emit_reserve(e, 1)) return;
+    e->data[e->length++] = c;
+}
+
+static void __emit_indent(Emitter* e, uint32_t indent)
+{
+    while (indent > EMIT_SPACES) {
+        __emit_write(e, spaces, EMIT_SPACES);
+        indent -= EMIT_SPACES;
+    }
+    __emit_write(e, spaces, indent);
+}
+
+/* Returns the code point of a special (a line break or non-printable code
+point, which is escaped) at p[i], or 0. */
+static uint32_t __special(const unsigned char* p, size_t i, size_t length)
+{
+    if (p[i] == 0xc2) {
+        /* C1 controls, and NEL. */
+        if (i + 1 < length && p[i + 1] >= 0x80 && p[i + 1] <= 0x9f) {
+            return p[i + 1];
+        }
+    } else if (i + 2 < length && p[i] == 0xe2) {
+        /* Line and paragraph separators. */
+        if (p[i + 1] == 0x80 && (p[i + 2] == 0xa8 || p[i + 2] == 0xa9)) {
+            return 0x2000 | (p[i + 2] & 0x3f);
+        }
+    } else if (i + 2 < length) {
+        /* BOM, and the non-characters U+FFFE and U+FFFF. */
+        if ((p[i + 1] == 0xbb && p[i + 2] == 0xbf)
+                || (p[i + 1] == 0xbf && p[i + 2] >= 0xbe)) {
+            return ((p[i] & 0x0f) << 12) | ((p[i + 1] & 0x3f) << 6)
+                    | (p[i + 2] & 0x3f);
+        }
+    }
+    return 0;
+}
+
+/* Scan the scalar once, returns true if it can be written in the plain
+style (and reads back as the same text). */
+static bool __is_plain(const char* s, size_t length)
+{
+    if (length == 0) return false;
+    const unsigned char* p = (const unsigned char*)s;
+    if (char_class[p[0]] & C_INDICATOR) {
+        /* "-x", "?x" and ":x" are plain. */
+        if (p[0] != '-' && p[0] != '?' && p[0] != ':') return false;
+        if (length == 1 || p[1] == ' ') return false;
+    }
+    if (length >= 3 && (memcmp(s, "---", 3) == 0 || memcmp(s, "...", 3) == 0)) {
+        return false;
+    }
+    if (p[length - 1] == ' ') return false;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = char_class[p[i]];
+        if (c == 0 || c == C_INDICATOR) continue;
+        if (c & C_BREAK) return false;
+        if ((c & C_UNICODE) && __special(p, i, length)) return false;
+        if (p[i] == ':' && (i + 1 == length || p[i + 1] == ' ')) return false;
+        if (p[i] == '#' && p[i - 1] == ' ') return false;
+    }
+    return true;
+}
+
+static void __emit_quoted(Emitter* e, const char* s, size_t length)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    const unsigned char* p = (const unsigned char*)s;
+    size_t start = 0;
+    __emit_char(e, '"');
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = char_class[p[i]];
+        if (!(c & (C_ESCAPE | C_UNICODE))) continue;
+        char escape[6] = { '\\', 0, 0, 0, 0, 0 };
+        size_t n = 2;
+        if (c & C_UNICODE) {
+            uint32_t special = __special(p, i, length);
+            if (special == 0) continue;
+            __emit_write(e, s + start, i - start);
+            start = i + (special < 0x800 ? 2 : 3);
+            i = start - 1;
+            escape[1] = 'u';
+            for (int j = 0; j < 4; j++) {
+                escape[2 + j] = hex[(special >> (12 - 4 * j)) & 0xf];
+            }
+            __emit_write(e, escape, 6);
+            continue;
+        }
+        __emit_write(e, s + start, i - start);
+        start = i + 1;
+        switch (p[i]) {
+            case '"':  escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\t': escape[1] = 't'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\0': escape[1] = '0'; break;
+            default:
+                escape[1] = 'x';
+                escape[2] = hex[p[i] >> 4];
+                escape[3] = hex[p[i] & 0xf];
+                n = 4;
+                break;
+        }
+        __emit_write(e, escape, n);
+    }
+    __emit_write(e, s + start, length - start);
+    __emit_char(e, '"');
+}
+
+static void __emit_key(Emitter* e, SimpleYamlNode* mapping,
+        const SimpleYamlMappingEntry* entry)
+{
+    /* A "<<" key is only plain when it is a merge key. */
+    bool merge = entry->length == 2 && memcmp(entry->key, "<<", 2) == 0;
+    if (merge ? (mapping->flags & SIMPLE_YAML_NODE_MERGE)
+            : __is_plain(entry->key, entry->length)) {
+        __emit_write(e, entry->key, entry->length);
+    } else {
+        __emit_quoted(e, entry->key, entry->length);
+    }
+    __emit_char(e, ':');
+}
+
+/* Scalars which were quoted (or block scalars) remain quoted, so that they
+read back as strings. An empty plain scalar is null, written as nothing. */
+static void __emit_scalar(Emitter* e, SimpleYamlNode* node, bool space)
+{
+    bool quoted = (node->flags & SIMPLE_YAML_NODE_QUOTED);
+    const char* value = node->value ? node->value : "";
+    size_t length = node->value ? node->value_length : 0;
+    if (length == 0 && !quoted) {
+        __emit_char(e, '\n');
+        return;
+    }
+    if (space) __emit_char(e, ' ');
+    if (!quoted && __is_plain(value, length)) {
+        __emit_write(e, value, length);
+    } else {
+        __emit_quoted(e, value, length);
+    }
+    __emit_char(e, '\n');
+}
+
+static void __emit_value(Emitter* e, SimpleYamlNode* node, uint32_t indent,
+        bool item);
+
+/* The first entry is written on the current line when inline is set (the
+mapping is a sequence item). */
+static void __emit_mapping(Emitter* e, SimpleYamlNode* node, uint32_t indent,
+        bool inline_first)
+{
+    for (uint32_t i = 0; i < node->mapping.count && !e->error; i++) {
+        const SimpleYamlMappingEntry* entry = &node->mapping.entries[i];
+        if (i || !inline_first) __emit_indent(e, indent);
+        __emit_key(e, node, entry);
+        __emit_value(e, entry->node, indent + EMIT_INDENT, false);
+    }
+}
+
+static void __emit_sequence(Emitter* e, SimpleYamlNode* node, uint32_t indent,
+        bool inline_first)
+{
+    uint32_t count = hashlist_length(&node->sequence);
+    for (uint32_t i = 0; i < count && !e->error; i++) {
+        if (i || !inline_first) __emit_indent(e, indent);
+        __emit_char(e, '-');
+        __emit_value(e, hashlist_get_at(&node->sequence, i),
+                indent + EMIT_INDENT, true);
+    }
+}
+
+/* Write the value of a key, or sequence item, which has been written up to
+the indicator (":" or "-"). Nested collections are indented. */
+static void __emit_value(Emitter* e, SimpleYamlNode* node, uint32_t indent,
+        bool item)
+{
+    switch (node->node_type) {
+        case YAML_MAPPING_NODE:
+            if (node->mapping.count == 0) {
+                __emit_write(e, " {}\n", 4);
+            } else if (item) {
+                __emit_char(e, ' ');
+                __emit_mapping(e, node, indent, true);
+            } else {
+                __emit_char(e, '\n');
+                __emit_mapping(e, node, indent, false);
+            }
+            break;
+        case YAML_SEQUENCE_NODE:
+            if (hashlist_length(&node->sequence) == 0) {
+                __emit_write(e, " []\n", 4);
+            } else if (item) {
+                __emit_char(e, ' ');
+                __emit_sequence(e, node, indent, true);
+            } else {
+                __emit_char(e, '\n');
+                __emit_sequence(e, node, indent, false);
+            }
+            break;
+        case YAML_SCALAR_NODE:
+            __emit_scalar(e, node, true);
+            break;
+        default:
+            /* Empty (unselected) nodes are null. */
+            __emit_char(e, '\n');
+            break;
+    }
+}
+
+static void __emit_node(Emitter* e, SimpleYamlNode* node, bool document)
+{
+    if (document) __emit_write(e, "---", 3);
+    switch (node->node_type) {
+        case YAML_MAPPING_NODE:
+            /* The value follows "---", otherwise it starts the line. */
+            if (document) {
+                __emit_value(e, node, 0, false);
+            } else if (node->mapping.count == 0) {
+                __emit_write(e, "{}\n", 3);
+            } else {
+                __emit_mapping(e, node, 0, false);
+            }
+            break;
+        case YAML_SEQUENCE_NODE:
+            if (document) {
+                __emit_value(e, node, 0, false);
+            } else if (hashlist_length(&node->sequence) == 0) {
+                __emit_write(e, "[]\n", 3);
+            } else {
+                __emit_sequence(e, node, 0, false);
+            }
+            break;
+        case YAML_SCALAR_NODE:
+            __emit_scalar(e, node, document);
+            break;
+        default:
+            __emit_char(e, '\n');
+            break;
+    }
+}
+
+static int __emit(Emitter* e, SimpleYamlNode* node, HashList* doc_list)
+{
+    errno = 0;
+    if (e->buffer == NULL) {
+        e->data = malloc(EMIT_BLOCK_SIZE);
+        if (e->data == NULL) e->error = ENOMEM;
+        e->capacity = EMIT_BLOCK_SIZE;
+    }
+    if (node) {
+        __emit_node(e, node, false);
+    } else {
+        for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+            __emit_node(e, hashlist_get_at(doc_list, i), true);
+        }
+    }
+    if (e->buffer) {
+        /* Adopt the (grown) buffer, keeping it NUL terminated. */
+        if (e->length == e->capacity) __emit_reserve(e, 0);
+        if (e->data) e->data[e->length] = '\0';
+        e->buffer->data = e->data;
+        e->buffer->length = e->length;
+        e->buffer->capacity = e->capacity;
+    } else {
+        if (e->error == 0) __emit_flush(e);
+        free(e->data);
+    }
+    if (e->error) {
+        errno = e->error;
+        perror("Error emitting YAML");
+        errno = e->error;
+    }
+    return e->error;
+}
+
+static void __emitter_init(Emitter* e, SimpleYamlBuffer* buffer, int fd)
+{
+    memset(e, 0, sizeof(Emitter));
+    e->buffer = buffer;
+    e->fd = fd;
+    if (buffer) {
+        e->data = buffer->data;
+        e->length = buffer->length;
+        e->capacity = buffer->capacity;
+    }
+}
+
+int simple_yaml_emit_buffer(SimpleYamlNode* node, SimpleYamlBuffer* buffer)
+{
+    if (node == NULL || buffer == NULL) return EINVAL;
+    Emitter e;
+    __emitter_init(&e, buffer, -1);
+    return __emit(&e, node, NULL);
+}
+
+int simple_yaml_emit_fd(SimpleYamlNode* node, int fd)
+{
+    if (node == NULL) return EINVAL;
+    Emitter e;
+    __emitter_init(&e, NULL, fd);
+    return __emit(&e, node, NULL);
+}
+
+int simple_yaml_emit_documents_buffer(HashList* doc_list,
+        SimpleYamlBuffer* buffer)
+{
+    if (doc_list == NULL || buffer == NULL) return EINVAL;
+    Emitter e;
+    __emitter_init(&e, buffer, -1);
+    return __emit(&e, NULL, doc_list);
+}
+
+int simple_yaml_emit_documents_fd(HashList* doc_list, int fd)
+{
+    if (doc_list == NULL) return EINVAL;
+    Emitter e;
+    __emitter_init(&e, NULL, fd);
+    return __emit(&e, NULL, doc_list);
+}
+
+void simple_yaml_buffer_release(SimpleYamlBuffer* buffer)
+{
+    if (buffer == NULL) return;
+    free(buffer->data);
+    memset(buffer, 0, sizeof(SimpleYamlBuffer));
+}
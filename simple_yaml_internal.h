@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#ifndef SIMPLE_YAML_INTERNAL_H
+#define SIMPLE_YAML_INTERNAL_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+
+/* Functions shared by the library sources, not part of the API. */
+
+
+/* A document start marker, "---" at the start of a line (p) followed by
+white space or the end of the buffer. */
+static __inline__ bool simple_yaml_is_document_start(const char* p,
+        const char* end)
+{
+    if (end - p < 3 || memcmp(p, "---", 3) != 0) return false;
+    if (end - p == 3) return true;
+    return (p[3] == ' ' || p[3] == '\t' || p[3] == '\r' || p[3] == '\n');
+}
+
+/* A stream in a UTF-16 encoding (detected by its BOM, or a NUL in the
+first two bytes) can not be split. */
+static __inline__ bool simple_yaml_split_encoding(const char* buffer,
+        size_t length)
+{
+    return !(length >= 2 && ((unsigned char)buffer[0] == 0xfe
+            || (unsigned char)buffer[0] == 0xff
+            || buffer[0] == '\0' || buffer[1] == '\0'));
+}
+
+/* Skip a run of "%" lines, comments and blank lines, returns the line after
+the run. The "%" lines are directives when that line is a document start
+marker, elsewhere a "%" line is part of a node (i.e. a quoted scalar) or an
+error which the parse reports. */
+static __inline__ const char* simple_yaml_skip_directives(const char* line,
+        const char* end)
+{
+    while (line < end) {
+        const char* p = line;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p < end && *p != '\n' && *p != '#' && *line != '%') break;
+        line = memchr(line, '\n', end - line);
+        if (line == NULL) return end;
+        line++;
+    }
+    return line;
+}
+
+/* Split a stream into documents. A document start marker can not appear
+inside a node, so a stream can be split at these markers without
+tokenising. Returns the next marker after the line at p, end when there is
+none, or NULL when the stream should not be split (directives, which belong
+to the following document). */
+static __inline__ const char* simple_yaml_split_next(const char* p,
+        const char* end)
+{
+    for (const char* line = p; line < end; ) {
+        if (*line == '%') {
+            line = simple_yaml_skip_directives(line, end);
+            if (simple_yaml_is_document_start(line, end)) return NULL;
+            continue;
+        }
+        if (line != p && simple_yaml_is_document_start(line, end)) {
+            return line;
+        }
+        line = memchr(line, '\n', end - line);
+        if (line == NULL) break;
+        line++;
+    }
+    return end;
+}
+
+#endif /* SIMPLE_YAML_INTERNAL_H */
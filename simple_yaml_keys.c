@@ -0,0 +1,161 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#ifdef __STDC_ALLOC_LIB__
+#define __STDC_WANT_LIB_EXT2__ 1
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <simple_yaml.h>
+
+
+#define KEYS_INITIAL_CAPACITY   256     /* Power of two. */
+
+
+/* Interned keys are stored, with their hash, in the table arena. */
+typedef struct InternedKey {
+    uint64_t            hash;
+    uint32_t            length;
+    char                key[];
+} InternedKey;
+
+struct SimpleYamlKeys {
+    pthread_mutex_t     lock;
+    Arena*              arena;
+    InternedKey**       slots;      /* Open addressing, linear probing. */
+    uint32_t            capacity;
+    uint32_t            count;
+};
+
+
+static inline InternedKey* __interned(const char* key)
+{
+    return (InternedKey*)(key - offsetof(InternedKey, key));
+}
+
+/* Returns the slot of key, either holding the key or empty. */
+static InternedKey** __slot(InternedKey** slots, uint32_t capacity,
+        const char* key, size_t length, uint64_t hash)
+{
+    uint32_t mask = capacity - 1;
+    uint32_t i = hash & mask;
+    while (slots[i]) {
+        InternedKey* k = slots[i];
+        if (k->hash == hash && k->length == length
+                && memcmp(k->key, key, length) == 0) break;
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+static int __grow(SimpleYamlKeys* keys)
+{
+    uint32_t capacity = keys->capacity * 2;
+    InternedKey** slots = calloc(capacity, sizeof(InternedKey*));
+    if (slots == NULL) return ENOMEM;
+    for (uint32_t i = 0; i < keys->capacity; i++) {
+        InternedKey* k = keys->slots[i];
+        if (k == NULL) continue;
+        *__slot(slots, capacity, k->key, k->length, k->hash) = k;
+    }
+    free(keys->slots);
+    keys->slots = slots;
+    keys->capacity = capacity;
+    return 0;
+}
+
+
+SimpleYamlKeys* simple_yaml_keys_create(void)
+{
+    SimpleYamlKeys* keys = calloc(1, sizeof(SimpleYamlKeys));
+    if (keys == NULL) return NULL;
+    keys->arena = arena_create(0);
+    keys->capacity = KEYS_INITIAL_CAPACITY;
+    keys->slots = calloc(keys->capacity, sizeof(InternedKey*));
+    if (keys->arena == NULL || keys->slots == NULL
+            || pthread_mutex_init(&keys->lock, NULL)) {
+        arena_destroy(keys->arena);
+        free(keys->slots);
+        free(keys);
+        return NULL;
+    }
+    return keys;
+}
+
+void simple_yaml_keys_destroy(SimpleYamlKeys* keys)
+{
+    if (keys == NULL) return;
+    pthread_mutex_destroy(&keys->lock);
+    arena_destroy(keys->arena);
+    free(keys->slots);
+    free(keys);
+}
+
+const char* simple_yaml_keys_intern(SimpleYamlKeys* keys, const char* key)
+{
+    size_t length = strlen(key);
+    uint64_t hash = hashmap_default_hash_length(key, length);
+    const char* interned = NULL;
+
+    pthread_mutex_lock(&keys->lock);
+    InternedKey** slot = __slot(
+            keys->slots, keys->capacity, key, length, hash);
+    if (*slot == NULL && (keys->count + 1) * 2 > keys->capacity) {
+        /* Keep the table at most half full. */
+        if (__grow(keys) == 0) {
+            slot = __slot(keys->slots, keys->capacity, key, length, hash);
+        }
+    }
+    if (*slot == NULL && keys->count + 1 < keys->capacity) {
+        InternedKey* k = arena_alloc(
+                keys->arena, sizeof(InternedKey) + length + 1);
+        if (k) {
+            k->hash = hash;
+            k->length = length;
+            memcpy(k->key, key, length + 1);
+            *slot = k;
+            keys->count++;
+        }
+    }
+    if (*slot) interned = (*slot)->key;
+    pthread_mutex_unlock(&keys->lock);
+    return interned;
+}
+
+const char* simple_yaml_keys_find(SimpleYamlKeys* keys, const char* key)
+{
+    size_t length = strlen(key);
+    uint64_t hash = hashmap_default_hash_length(key, length);
+    pthread_mutex_lock(&keys->lock);
+    InternedKey* k = *__slot(
+            keys->slots, keys->capacity, key, length, hash);
+    pthread_mutex_unlock(&keys->lock);
+    return k ? k->key : NULL;
+}
+
+uint32_t simple_yaml_keys_count(SimpleYamlKeys* keys)
+{
+    pthread_mutex_lock(&keys->lock);
+    uint32_t count = keys->count;
+    pthread_mutex_unlock(&keys->lock);
+    return count;
+}
+
+uint64_t simple_yaml_keys_hash(const char* interned)
+{
+    return __interned(interned)->hash;
+}
+
+size_t simple_yaml_keys_length(const char* interned)
+{
+    return __interned(interned)->length;
+}
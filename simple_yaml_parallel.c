@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#ifdef __STDC_ALLOC_LIB__
+#define __STDC_WANT_LIB_EXT2__ 1
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <simple_yaml.h>
+#include <simple_yaml_internal.h>
+
+
+/* Chunks per thread, more chunks balance uneven documents at the cost of
+a parser per chunk. */
+#define PARALLEL_CHUNKS_PER_THREAD  4
+
+
+typedef struct ParallelChunk {
+    const char*         start;
+    size_t              length;
+    HashList            doc_list;
+    int                 error;
+} ParallelChunk;
+
+typedef struct ParallelParse {
+    ParallelChunk*      chunks;
+    uint32_t            count;
+    uint32_t            next;       /* Next chunk to parse, atomic. */
+    SimpleYamlOptions   options;    /* Serial options for each chunk. */
+} ParallelParse;
+
+
+/* Split the buffer into chunks of whole documents, at their document start
+markers. Returns the number of chunks, or 0 when the buffer should be
+parsed serially (see simple_yaml_split_next). */
+static uint32_t __split(const char* buffer, size_t length,
+        ParallelChunk* chunks, uint32_t max_chunks)
+{
+    if (!simple_yaml_split_encoding(buffer, length)) return 0;
+
+    const char* end = buffer + length;
+    size_t target = length / max_chunks;
+    uint32_t count = 0;
+    const char* start = buffer;
+    for (const char* line = buffer; line < end; ) {
+        line = simple_yaml_split_next(line, end);
+        if (line == NULL) return 0;
+        if (line < end && (size_t)(line - start) >= target
+                && count < max_chunks - 1) {
+            chunks[count].start = start;
+            chunks[count].length = line - start;
+            count++;
+            start = line;
+        }
+    }
+    chunks[count].start = start;
+    chunks[count].length = end - start;
+    return count + 1;
+}
+
+static void __parse_chunk(ParallelParse* pp, ParallelChunk* chunk)
+{
+    hashlist_init(&chunk->doc_list);
+    SimpleYamlStream* stream = simple_yaml_stream_open_buffer(
+            chunk->start, chunk->length, &pp->options);
+    if (stream == NULL) {
+        chunk->error = errno ? errno : ECANCELED;
+        return;
+    }
+    SimpleYamlNode* doc;
+    while ((doc = simple_yaml_stream_next_document(stream))) {
+        if (hashlist_append(&chunk->doc_list, doc) != HASHMAP_SUCCESS) {
+            simple_yaml_destroy_node(doc);
+            errno = ENOMEM;
+            break;
+        }
+    }
+    chunk->error = errno;
+    simple_yaml_stream_close(stream);
+}
+
+static void* __worker(void* data)
+{
+    ParallelParse* pp = data;
+    uint32_t i;
+    while ((i = __atomic_fetch_add(&pp->next, 1, __ATOMIC_RELAXED)) < pp->count) {
+        __parse_chunk(pp, &pp->chunks[i]);
+    }
+    return NULL;
+}
+
+static HashList* __assemble(ParallelParse* pp, HashList* doc_list)
+{
+    bool created = false;
+    if (doc_list == NULL) {
+        doc_list = calloc(1, sizeof(HashList));
+        if (doc_list) hashlist_init(doc_list);
+        created = true;
+    }
+
+    /* Documents, in order, up to the first error (as a serial parse). */
+    int error = 0;
+    for (uint32_t i = 0; i < pp->count; i++) {
+        ParallelChunk* chunk = &pp->chunks[i];
+        for (uint32_t j = 0; j < hashlist_length(&chunk->doc_list); j++) {
+            SimpleYamlNode* doc = hashlist_get_at(&chunk->doc_list, j);
+            if (error || doc_list == NULL
+                    || hashlist_append(doc_list, doc) != HASHMAP_SUCCESS) {
+                simple_yaml_destroy_node(doc);
+            }
+        }
+        hashlist_destroy(&chunk->doc_list);
+        if (error == 0) error = chunk->error;
+    }
+
+    if (doc_list == NULL) {
+        errno = ENOMEM;
+        perror("Error creating document list");
+    } else if (error && created && hashlist_length(doc_list) == 0) {
+        hashlist_destroy(doc_list);
+        free(doc_list);
+        doc_list = NULL;
+    }
+    errno = error;
+    return doc_list;
+}
+
+HashList* simple_yaml_parse_buffer_parallel(const char* buffer, size_t length,
+        HashList* doc_list, const SimpleYamlOptions* options)
+{
+    ParallelParse pp = { 0 };
+    if (options) pp.options = *options;
+    uint32_t threads = pp.options.threads;
+    pp.options.threads = 0;
+    if (threads <= 1 || buffer == NULL) {
+        return simple_yaml_parse_buffer(buffer, length, doc_list, &pp.options);
+    }
+
+    uint32_t max_chunks = threads * PARALLEL_CHUNKS_PER_THREAD;
+    pp.chunks = calloc(max_chunks, sizeof(ParallelChunk));
+    if (pp.chunks) pp.count = __split(buffer, length, pp.chunks, max_chunks);
+    if (pp.count <= 1) {
+        free(pp.chunks);
+        return simple_yaml_parse_buffer(buffer, length, doc_list, &pp.options);
+    }
+    if (threads > pp.count) threads = pp.count;
+
+    /* The calling thread is also a worker, should a thread fail to start
+    the remaining workers take its share. */
+    pthread_t* workers = calloc(threads - 1, sizeof(pthread_t));
+    uint32_t started = 0;
+    while (workers && started < threads - 1) {
+        if (pthread_create(&workers[started], NULL, __worker, &pp)) break;
+        started++;
+    }
+    __worker(&pp);
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    doc_list = __assemble(&pp, doc_list);
+    free(pp.chunks);
+    return doc_list;
+}
@@ -0,0 +1,415 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <simple_yaml.h>
+#include <simple_yaml_internal.h>
+
+
+#define RELOAD_NONE     UINT32_MAX
+
+
+/* A part of the stream, from one document start marker to the next, and
+the number of documents parsed from it. */
+struct SimpleYamlRange {
+    uint64_t            hash;
+    uint32_t            count;
+};
+
+typedef struct ReloadPart {
+    const char*         start;
+    size_t              length;
+    uint64_t            hash;
+    uint32_t            previous;   /* Matching range of previous. */
+    HashList*           doc_list;   /* Parsed documents. */
+} ReloadPart;
+
+/* A range of previous, by hash. */
+typedef struct ReloadMatch {
+    uint64_t            hash;
+    uint32_t            range;
+} ReloadMatch;
+
+typedef struct Reload {
+    ReloadPart*         parts;
+    uint32_t            count;
+    uint32_t            capacity;
+    /* The ranges of previous. */
+    const struct SimpleYamlRange* ranges;
+    uint32_t            range_count;
+} Reload;
+
+
+static int __add_part(Reload* r, const char* start, size_t length)
+{
+    if (r->count == r->capacity) {
+        uint32_t capacity = r->capacity ? r->capacity * 2 : 64;
+        ReloadPart* parts = realloc(r->parts, capacity * sizeof(ReloadPart));
+        if (parts == NULL) return ENOMEM;
+        r->parts = parts;
+        r->capacity = capacity;
+    }
+    ReloadPart* part = &r->parts[r->count++];
+    memset(part, 0, sizeof(ReloadPart));
+    part->start = start;
+    part->length = length;
+    part->hash = hashmap_default_hash_length(start, length);
+    part->previous = RELOAD_NONE;
+    return 0;
+}
+
+/* Split the stream at its document start markers, as the parallel parse
+does. A stream which should not be split (see simple_yaml_split_next) is a
+single part. */
+static int __split(Reload* r, const char* buffer, size_t length)
+{
+    if (!simple_yaml_split_encoding(buffer, length)) {
+        return __add_part(r, buffer, length);
+    }
+    const char* end = buffer + length;
+    const char* start = buffer;
+    while (start < end) {
+        const char* next = simple_yaml_split_next(start, end);
+        if (next == NULL) {
+            r->count = 0;
+            return __add_part(r, buffer, length);
+        }
+        if (next == end) break;
+        int rc = __add_part(r, start, next - start);
+        if (rc) return rc;
+        start = next;
+    }
+    return __add_part(r, start, end - start);
+}
+
+static int __match_compare(const void* a, const void* b)
+{
+    const ReloadMatch* x = a;
+    const ReloadMatch* y = b;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return (x->range > y->range) - (x->range < y->range);
+}
+
+/* Match the parts with the ranges of previous: the unchanged parts at the
+start and end of the stream, and between them by hash. Each part takes the
+next unused range with its hash (a candidate), and the longest run of parts
+with increasing candidates is matched (matches keep the order of the
+stream). Inserted, removed and moved documents then leave the other parts
+matched. */
+static int __match(Reload* r)
+{
+    uint32_t min = r->count < r->range_count ? r->count : r->range_count;
+    uint32_t head = 0, tail = 0;
+    while (head < min && r->parts[head].hash == r->ranges[head].hash) {
+        r->parts[head].previous = head;
+        head++;
+    }
+    while (tail < min - head && r->parts[r->count - 1 - tail].hash
+            == r->ranges[r->range_count - 1 - tail].hash) {
+        r->parts[r->count - 1 - tail].previous = r->range_count - 1 - tail;
+        tail++;
+    }
+    uint32_t count = r->count - head - tail;
+    uint32_t range_count = r->range_count - head - tail;
+    if (count == 0 || range_count == 0) return 0;
+
+    ReloadMatch* matches = malloc(range_count * sizeof(ReloadMatch)
+            + ((size_t)range_count + 3 * (size_t)count) * sizeof(uint32_t));
+    if (matches == NULL) return ENOMEM;
+    uint32_t* used = (uint32_t*)(matches + range_count);    /* Per hash. */
+    uint32_t* candidates = used + range_count;
+    uint32_t* tails = candidates + count;   /* Last part of a run, by length. */
+    uint32_t* links = tails + count;        /* Previous part of the run. */
+    for (uint32_t i = 0; i < range_count; i++) {
+        matches[i].hash = r->ranges[head + i].hash;
+        matches[i].range = head + i;
+        used[i] = 0;
+    }
+    qsort(matches, range_count, sizeof(ReloadMatch), __match_compare);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t hash = r->parts[head + i].hash;
+        uint32_t low = 0, high = range_count;
+        while (low < high) {
+            uint32_t mid = low + (high - low) / 2;
+            if (matches[mid].hash < hash) low = mid + 1;
+            else high = mid;
+        }
+        candidates[i] = RELOAD_NONE;
+        uint32_t next = low + (low < range_count ? used[low] : 0);
+        if (next < range_count && matches[next].hash == hash) {
+            candidates[i] = matches[next].range;
+            used[low]++;
+        }
+    }
+
+    /* The longest increasing run of candidates (patience sorting). */
+    uint32_t length = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (candidates[i] == RELOAD_NONE) continue;
+        uint32_t low = 0, high = length;
+        while (low < high) {
+            uint32_t mid = low + (high - low) / 2;
+            if (candidates[tails[mid]] < candidates[i]) low = mid + 1;
+            else high = mid;
+        }
+        links[i] = low ? tails[low - 1] : RELOAD_NONE;
+        tails[low] = i;
+        if (low == length) length++;
+    }
+    for (uint32_t i = length ? tails[length - 1] : RELOAD_NONE;
+            i != RELOAD_NONE; i = links[i]) {
+        r->parts[head + i].previous = candidates[i];
+    }
+    free(matches);
+    return 0;
+}
+
+static int __parse_parts(Reload* r, const SimpleYamlOptions* options)
+{
+    /* Scalars are copied, the buffer is not kept. */
+    SimpleYamlOptions _options = { 0 };
+    if (options) _options = *options;
+    _options.zero_copy = false;
+    _options.threads = 0;
+    for (uint32_t i = 0; i < r->count; i++) {
+        ReloadPart* part = &r->parts[i];
+        if (part->previous != RELOAD_NONE) continue;
+        errno = 0;
+        part->doc_list = simple_yaml_parse_buffer(
+                part->start, part->length, NULL, &_options);
+        int rc = errno;
+        if (part->doc_list == NULL || rc) return rc ? rc : ECANCELED;
+    }
+    return 0;
+}
+
+static void __release_parts(Reload* r)
+{
+    for (uint32_t i = 0; i < r->count; i++) {
+        HashList* doc_list = r->parts[i].doc_list;
+        if (doc_list == NULL) continue;
+        for (uint32_t j = 0; j < hashlist_length(doc_list); j++) {
+            simple_yaml_destroy_node(hashlist_get_at(doc_list, j));
+        }
+        hashlist_destroy(doc_list);
+        free(doc_list);
+    }
+    free(r->parts);
+}
+
+/* Changed documents, between two reused parts (or the ends). Documents are
+paired in order (replaced), the remainder of either side is added or
+removed. */
+static void __changes(SimpleYamlReload* reload, uint32_t previous,
+        uint32_t previous_count, uint32_t index, uint32_t count)
+{
+    uint32_t paired = count < previous_count ? count : previous_count;
+    for (uint32_t i = 0; i < paired; i++) {
+        reload->replaced[reload->replaced_count] = index + i;
+        reload->replaced_previous[reload->replaced_count] = previous + i;
+        reload->replaced_count++;
+    }
+    for (uint32_t i = paired; i < count; i++) {
+        reload->added[reload->added_count++] = index + i;
+    }
+    for (uint32_t i = paired; i < previous_count; i++) {
+        reload->removed[reload->removed_count++] = previous + i;
+    }
+}
+
+/* Build the new doc_list (reused documents are shared with previous) and
+its ranges, and record the changes. */
+static int __assemble(Reload* r, SimpleYamlReload* reload, HashList* previous,
+        HashList* doc_list, struct SimpleYamlRange* ranges)
+{
+    uint32_t range = 0, previous_index = 0, index = 0;
+    uint32_t previous_count = 0, count = 0;
+    for (uint32_t i = 0; i <= r->count; i++) {
+        ReloadPart* part = i < r->count ? &r->parts[i] : NULL;
+        if (part) ranges[i].hash = part->hash;
+        if (part && part->previous == RELOAD_NONE) {
+            uint32_t length = hashlist_length(part->doc_list);
+            for (uint32_t j = 0; j < length; j++) {
+                if (hashlist_append(doc_list,
+                        hashlist_get_at(part->doc_list, j)) != HASHMAP_SUCCESS) {
+                    return ENOMEM;
+                }
+            }
+            ranges[i].count = length;
+            count += length;
+            continue;
+        }
+        uint32_t next = part ? part->previous : r->range_count;
+        for (; range < next; range++) previous_count += r->ranges[range].count;
+        __changes(reload, previous_index, previous_count, index, count);
+        previous_index += previous_count;
+        index += count;
+        previous_count = count = 0;
+        if (part == NULL) break;
+
+        uint32_t length = r->ranges[range++].count;
+        for (uint32_t j = 0; j < length; j++) {
+            if (hashlist_append(doc_list, hashlist_get_at(
+                    previous, previous_index + j)) != HASHMAP_SUCCESS) {
+                return ENOMEM;
+            }
+        }
+        ranges[i].count = length;
+        reload->reused += length;
+        previous_index += length;
+        index += length;
+    }
+    return 0;
+}
+
+HashList* simple_yaml_reload_buffer(SimpleYamlReload* reload,
+        HashList* previous, const char* buffer, size_t length,
+        const SimpleYamlOptions* options)
+{
+    errno = 0;
+    if (buffer == NULL) buffer = "";
+
+    /* The ranges describe previous when it is the doc_list of the last
+    reload, otherwise no document is reused. */
+    Reload r = { 0 };
+    uint32_t previous_length = previous ? hashlist_length(previous) : 0;
+    uint32_t range_documents = 0;
+    for (uint32_t i = 0; i < reload->range_count; i++) {
+        range_documents += reload->ranges[i].count;
+    }
+    struct SimpleYamlRange unknown = { .count = previous_length };
+    bool known = previous && previous == reload->doc_list
+            && previous_length == range_documents;
+    r.ranges = known ? reload->ranges : &unknown;
+    r.range_count = known ? reload->range_count : (previous_length ? 1 : 0);
+
+    int rc = __split(&r, buffer, length);
+    if (rc == 0 && known) rc = __match(&r);
+    if (rc == 0) rc = __parse_parts(&r, options);
+
+    HashList* doc_list = NULL;
+    struct SimpleYamlRange* ranges = NULL;
+    uint32_t* indexes = NULL;
+    SimpleYamlReload _reload = *reload;
+    if (rc == 0) {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < r.count; i++) {
+            count += r.parts[i].previous == RELOAD_NONE
+                    ? hashlist_length(r.parts[i].doc_list)
+                    : r.ranges[r.parts[i].previous].count;
+        }
+        doc_list = calloc(1, sizeof(HashList));
+        ranges = calloc(r.count, sizeof(struct SimpleYamlRange));
+        indexes = calloc(3 * (size_t)count + previous_length + 1,
+                sizeof(uint32_t));
+        if (doc_list == NULL || ranges == NULL || indexes == NULL
+                || hashlist_init(doc_list) != HASHMAP_SUCCESS) {
+            rc = ENOMEM;
+        } else {
+            _reload.replaced = indexes;
+            _reload.replaced_previous = indexes + count;
+            _reload.added = indexes + 2 * count;
+            _reload.removed = indexes + 3 * count;
+            _reload.replaced_count = _reload.added_count = 0;
+            _reload.removed_count = _reload.reused = 0;
+            rc = __assemble(&r, &_reload, previous, doc_list, ranges);
+        }
+    }
+    if (rc) {
+        if (doc_list) {
+            hashlist_destroy(doc_list);
+            free(doc_list);
+        }
+        free(ranges);
+        free(indexes);
+        __release_parts(&r);
+        errno = rc;
+        perror("Error reloading YAML documents");
+        errno = rc;
+        return NULL;
+    }
+
+    /* Reused documents are now also referenced by the new doc_list. The
+    parsed documents are owned by the new doc_list. */
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < r.count; i++) {
+        ReloadPart* part = &r.parts[i];
+        if (part->doc_list) {
+            hashlist_destroy(part->doc_list);
+            free(part->doc_list);
+        } else {
+            for (uint32_t j = 0; j < ranges[i].count; j++) {
+                SimpleYamlNode* doc = hashlist_get_at(doc_list, index + j);
+                if (doc) __atomic_fetch_add(&doc->refs, 1, __ATOMIC_RELAXED);
+            }
+        }
+        index += ranges[i].count;
+    }
+    free(r.parts);
+    simple_yaml_reload_release(reload);
+    *reload = _reload;
+    reload->doc_list = doc_list;
+    reload->ranges = ranges;
+    reload->range_count = r.count;
+    return doc_list;
+}
+
+HashList* simple_yaml_reload_file(SimpleYamlReload* reload,
+        HashList* previous, const char* filename,
+        const SimpleYamlOptions* options)
+{
+    errno = 0;
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        perror("Error opening file");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("Error opening file");
+        close(fd);
+        return NULL;
+    }
+    size_t length = st.st_size;
+    void* data = NULL;
+    if (length) {
+        data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("Error mapping file");
+            close(fd);
+            return NULL;
+        }
+    }
+    close(fd);
+
+    HashList* doc_list = simple_yaml_reload_buffer(
+            reload, previous, data, length, options);
+    if (length) {
+        int error = errno;
+        munmap(data, length);
+        errno = error;
+    }
+    return doc_list;
+}
+
+void simple_yaml_reload_release(SimpleYamlReload* reload)
+{
+    if (reload == NULL) return;
+    free(reload->replaced);
+    free(reload->ranges);
+    memset(reload, 0, sizeof(SimpleYamlReload));
+}
@@ -0,0 +1,551 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#ifdef __STDC_ALLOC_LIB__
+#define __STDC_WANT_LIB_EXT2__ 1
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <simple_yaml.h>
+
+
+#define SIMPLE_YAML_NUMBER_LEN  (64+1)
+
+
+static bool __equal(const char* value, size_t length, const char* s)
+{
+    size_t n = strlen(s);
+    return length == n && memcmp(value, s, n) == 0;
+}
+
+/* Match one of the (lowercase, Capitalised or UPPERCASE) forms of word, as
+the core schema does for null, true, false and .inf. */
+static bool __equal_word(const char* value, size_t length, const char* word)
+{
+    size_t n = strlen(word);
+    if (length != n) return false;
+    bool lower = true, upper = true;
+    for (size_t i = 0; i < n; i++) {
+        char c = value[i];
+        char u = (word[i] >= 'a' && word[i] <= 'z') ? word[i] - 32 : word[i];
+        /* The first letter may be capitalised in either form. */
+        bool first = (i == 0 || (i == 1 && word[0] == '.'));
+        if (c != word[i] && !(first && c == u)) lower = false;
+        if (c != u) upper = false;
+    }
+    return lower || upper;
+}
+
+static bool __is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int __digit_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 16;
+}
+
+/* Unsigned digits in base, returns false if any character is not a digit,
+sets ERANGE if the value exceeds limit. The error is only set when the
+digits are parsed, the scalar may otherwise still be a float. */
+static bool __parse_digits(const char* s, size_t length, unsigned base,
+        uint64_t limit, uint64_t* value, int* error)
+{
+    uint64_t v = 0;
+    bool overflow = false;
+    if (length == 0) return false;
+    for (size_t i = 0; i < length; i++) {
+        unsigned d = __digit_value(s[i]);
+        if (d >= base) return false;
+        if (v > (limit - d) / base) {
+            overflow = true;
+            v = limit;
+        } else if (!overflow) {
+            v = v * base + d;
+        }
+    }
+    if (overflow) *error = ERANGE;
+    *value = v;
+    return true;
+}
+
+static bool __resolve_int(const char* s, size_t length, SimpleYamlScalar* scalar)
+{
+    uint64_t v;
+    if (length > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'o')) {
+        /* Hexadecimal and octal (unsigned in the core schema). */
+        if (!__parse_digits(s + 2, length - 2, s[1] == 'x' ? 16 : 8,
+                INT64_MAX, &v, &scalar->error)) return false;
+        scalar->value.integer = v;
+        return true;
+    }
+    bool negative = (s[0] == '-');
+    size_t sign = (s[0] == '-' || s[0] == '+');
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : INT64_MAX;
+    if (!__parse_digits(s + sign, length - sign, 10, limit, &v,
+            &scalar->error)) return false;
+    if (negative) {
+        scalar->value.integer = (v == (uint64_t)INT64_MAX + 1)
+                ? INT64_MIN : -(int64_t)v;
+    } else {
+        scalar->value.integer = v;
+    }
+    return true;
+}
+
+/* [-+]? ( \. [0-9]+ | [0-9]+ ( \. [0-9]* )? ) ( [eE] [-+]? [0-9]+ )? */
+static bool __is_float(const char* s, size_t length)
+{
+    size_t i = 0, digits = 0;
+    if (i < length && (s[i] == '-' || s[i] == '+')) i++;
+    while (i < length && __is_digit(s[i])) i++, digits++;
+    if (i < length && s[i] == '.') {
+        i++;
+        while (i < length && __is_digit(s[i])) i++, digits++;
+    }
+    if (digits == 0) return false;
+    if (i < length && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        if (i < length && (s[i] == '-' || s[i] == '+')) i++;
+        if (i == length || !__is_digit(s[i])) return false;
+        while (i < length && __is_digit(s[i])) i++;
+    }
+    return i == length;
+}
+
+static bool __resolve_float(const char* s, size_t length, SimpleYamlScalar* scalar)
+{
+    size_t sign = (s[0] == '-' || s[0] == '+');
+    if (__equal_word(s + sign, length - sign, ".inf")) {
+        scalar->value.real = (s[0] == '-') ? -INFINITY : INFINITY;
+        return true;
+    }
+    if (__equal(s, length, ".nan") || __equal(s, length, ".NaN")
+            || __equal(s, length, ".NAN")) {
+        scalar->value.real = NAN;
+        return true;
+    }
+    if (!__is_float(s, length)) return false;
+
+    /* The value may be a view (not NUL terminated). */
+    char buffer[SIMPLE_YAML_NUMBER_LEN];
+    char* copy = buffer;
+    if (length >= sizeof(buffer)) copy = malloc(length + 1);
+    if (copy == NULL) return false;
+    memcpy(copy, s, length);
+    copy[length] = '\0';
+    scalar->value.real = strtod(copy, NULL);
+    if (copy != buffer) free(copy);
+    /* Only overflow is an error, underflow rounds towards zero. */
+    if (isinf(scalar->value.real)) scalar->error = ERANGE;
+    return true;
+}
+
+/* Scalar classification. The characters of a (short) scalar are classified
+in a single pass, with SSE2 or AVX2 where available, into masks (bit i for
+byte i) from which int and float scalars are recognised and then parsed
+without strtod. Longer, or unusual, numbers take the checked path above. */
+#define CLASSIFY_LEN    64
+
+typedef struct ScalarClass {
+    uint64_t            digit;
+    uint64_t            sign;       /* + or - */
+    uint64_t            dot;
+    uint64_t            exp;        /* e or E */
+    uint64_t            other;
+} ScalarClass;
+
+/* The buffer is padded to CLASSIFY_LEN, bytes past length are ignored. */
+typedef void (*ClassifyFunc)(const uint8_t* s, size_t length, ScalarClass* c);
+
+static void __classify_generic(const uint8_t* s, size_t length, ScalarClass* c)
+{
+    memset(c, 0, sizeof(ScalarClass));
+    for (size_t i = 0; i < length; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        uint8_t ch = s[i];
+        if (ch >= '0' && ch <= '9') c->digit |= bit;
+        else if (ch == '+' || ch == '-') c->sign |= bit;
+        else if (ch == '.') c->dot |= bit;
+        else if ((ch | 0x20) == 'e') c->exp |= bit;
+        else c->other |= bit;
+    }
+}
+
+static inline uint64_t __length_mask(size_t length)
+{
+    return length >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << length) - 1;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMPLE_YAML_SIMD_X86
+#include <immintrin.h>
+
+__attribute__((target("sse2")))
+static void __classify_sse2(const uint8_t* s, size_t length, ScalarClass* c)
+{
+    uint64_t digit = 0, sign = 0, dot = 0, exp = 0;
+    for (size_t i = 0; i < length; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        /* Unsigned (v - '0') <= 9. */
+        __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+        __m128i is_sign = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+        __m128i is_dot = _mm_cmpeq_epi8(v, _mm_set1_epi8('.'));
+        __m128i is_exp = _mm_cmpeq_epi8(
+                _mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('e'));
+        digit |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_digit) << i;
+        sign |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_sign) << i;
+        dot |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_dot) << i;
+        exp |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_exp) << i;
+    }
+    uint64_t mask = __length_mask(length);
+    c->digit = digit & mask;
+    c->sign = sign & mask;
+    c->dot = dot & mask;
+    c->exp = exp & mask;
+    c->other = ~(digit | sign | dot | exp) & mask;
+}
+
+__attribute__((target("avx2")))
+static void __classify_avx2(const uint8_t* s, size_t length, ScalarClass* c)
+{
+    uint64_t digit = 0, sign = 0, dot = 0, exp = 0;
+    for (size_t i = 0; i < length; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        __m256i is_digit = _mm256_cmpeq_epi8(
+                _mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+        __m256i is_sign = _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('+')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+        __m256i is_dot = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'));
+        __m256i is_exp = _mm256_cmpeq_epi8(
+                _mm256_or_si256(v, _mm256_set1_epi8(0x20)),
+                _mm256_set1_epi8('e'));
+        digit |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_digit) << i;
+        sign |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_sign) << i;
+        dot |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_dot) << i;
+        exp |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_exp) << i;
+    }
+    uint64_t mask = __length_mask(length);
+    c->digit = digit & mask;
+    c->sign = sign & mask;
+    c->dot = dot & mask;
+    c->exp = exp & mask;
+    c->other = ~(digit | sign | dot | exp) & mask;
+}
+#endif
+
+/* Select the implementation on first use, SIMPLE_YAML_SIMD=none|sse2|avx2
+limits the selection (i.e. for testing). */
+static ClassifyFunc __classify_select(void)
+{
+    const char* simd = getenv("SIMPLE_YAML_SIMD");
+    if (simd && strcmp(simd, "none") == 0) return __classify_generic;
+#ifdef SIMPLE_YAML_SIMD_X86
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("sse2")) return __classify_generic;
+    if (simd && strcmp(simd, "sse2") == 0) return __classify_sse2;
+    if (__builtin_cpu_supports("avx2")) return __classify_avx2;
+    return __classify_sse2;
+#else
+    return __classify_generic;
+#endif
+}
+
+static void __classify_dispatch(const uint8_t* s, size_t length, ScalarClass* c);
+static ClassifyFunc classify = __classify_dispatch;
+
+static void __classify_dispatch(const uint8_t* s, size_t length, ScalarClass* c)
+{
+    ClassifyFunc f = __classify_select();
+    __atomic_store_n(&classify, f, __ATOMIC_RELAXED);
+    f(s, length, c);
+}
+
+static void __classify(const char* s, size_t length, ScalarClass* c)
+{
+    /* Shorter than a vector, the loop is quicker than the dispatch. */
+    if (length < 16) {
+        __classify_generic((const uint8_t*)s, length, c);
+        return;
+    }
+    /* Copy, the value may be a view at the end of a mapped buffer. The
+    padding is not initialised, it is masked from the result. */
+    uint8_t buffer[CLASSIFY_LEN] __attribute__((aligned(32)));
+    memcpy(buffer, s, length);
+    __atomic_load_n(&classify, __ATOMIC_RELAXED)(buffer, length, c);
+}
+
+/* Eight decimal digits at a time (SWAR), at most 19 digits (no overflow). */
+static uint64_t __parse_decimal(const char* s, size_t length)
+{
+    uint64_t v = 0;
+    size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= length; i += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, s + i, 8);
+        chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+        chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+        chunk = ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+        v = v * 100000000 + chunk;
+    }
+#endif
+    for (; i < length; i++) v = v * 10 + (s[i] - '0');
+    return v;
+}
+
+/* [-+]? [0-9]+ */
+static bool __fast_int(const char* s, size_t length, const ScalarClass* c,
+        SimpleYamlScalar* scalar)
+{
+    if (c->dot || c->exp || c->other || (c->sign & ~(uint64_t)1)) return false;
+    size_t sign = c->sign & 1;
+    size_t n = length - sign;
+    if (n == 0) return false;
+    if (n > 19) return __resolve_int(s, length, scalar);
+    uint64_t v = __parse_decimal(s + sign, n);
+    bool negative = (s[0] == '-');
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : INT64_MAX;
+    if (v > limit) {
+        scalar->error = ERANGE;
+        v = limit;
+    }
+    if (negative) {
+        scalar->value.integer = (v == (uint64_t)INT64_MAX + 1)
+                ? INT64_MIN : -(int64_t)v;
+    } else {
+        scalar->value.integer = v;
+    }
+    return true;
+}
+
+static const double exact_powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* The float pattern (see __is_float) from the masks. Returns false if the
+scalar is not a float, or is not exactly representable with a single
+multiply/divide (more than 19 digits, a mantissa above 2^53 or an exponent
+beyond 10^22, Clinger's fast path), __resolve_float then decides. */
+static bool __fast_float(const char* s, size_t length, const ScalarClass* c,
+        SimpleYamlScalar* scalar)
+{
+    uint64_t exp = c->exp, dot = c->dot;
+    if (c->other || (exp & (exp - 1)) || (dot & (dot - 1))) return false;
+    uint64_t mantissa = exp ? exp - 1 : __length_mask(length);
+    if ((dot & ~mantissa) || !(c->digit & mantissa)) return false;
+    if (c->sign & ~((uint64_t)1 | (exp << 1))) return false;
+    size_t end = exp ? (size_t)__builtin_ctzll(exp) : length;
+    size_t point = dot ? (size_t)__builtin_ctzll(dot) : end;
+    size_t i = c->sign & 1;
+    size_t int_n = point - i;
+    size_t frac_n = dot ? end - point - 1 : 0;
+    if (int_n + frac_n > 19) return false;
+
+    int64_t e = -(int64_t)frac_n;
+    if (exp) {
+        size_t j = end + 1;
+        bool negative = false;
+        if (c->sign & ((uint64_t)1 << j)) negative = (s[j++] == '-');
+        if (j == length || length - j > 4) return false;
+        int64_t v = __parse_decimal(s + j, length - j);
+        e += negative ? -v : v;
+    }
+    uint64_t m = __parse_decimal(s + i, int_n);
+    for (size_t k = 0; k < frac_n; k++) m *= 10;
+    m += __parse_decimal(s + point + 1, frac_n);
+    if (m > ((uint64_t)1 << 53) || e < -22 || e > 22) return false;
+
+    double v = (double)m;
+    v = (e < 0) ? v / exact_powers[-e] : v * exact_powers[e];
+    scalar->value.real = (s[0] == '-') ? -v : v;
+    return true;
+}
+
+static void __resolve(const char* s, size_t length, SimpleYamlScalar* scalar)
+{
+    memset(scalar, 0, sizeof(SimpleYamlScalar));
+    scalar->type = SIMPLE_YAML_SCALAR_STRING;
+    if (length == 0) {
+        scalar->type = SIMPLE_YAML_SCALAR_NULL;
+        return;
+    }
+    switch (s[0]) {
+        case '~':
+        case 'n': case 'N':
+            if (__equal(s, length, "~") || __equal_word(s, length, "null")) {
+                scalar->type = SIMPLE_YAML_SCALAR_NULL;
+            }
+            break;
+        case 't': case 'T':
+        case 'f': case 'F':
+            if (__equal_word(s, length, "true")) {
+                scalar->type = SIMPLE_YAML_SCALAR_BOOL;
+                scalar->value.boolean = true;
+            } else if (__equal_word(s, length, "false")) {
+                scalar->type = SIMPLE_YAML_SCALAR_BOOL;
+                scalar->value.boolean = false;
+            }
+            break;
+        case '-': case '+': case '.':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            if (length <= CLASSIFY_LEN) {
+                ScalarClass c;
+                __classify(s, length, &c);
+                if (__fast_int(s, length, &c, scalar)) {
+                    scalar->type = SIMPLE_YAML_SCALAR_INT;
+                    break;
+                }
+                if (__fast_float(s, length, &c, scalar)) {
+                    scalar->type = SIMPLE_YAML_SCALAR_FLOAT;
+                    break;
+                }
+            }
+            if (__resolve_int(s, length, scalar)) {
+                scalar->type = SIMPLE_YAML_SCALAR_INT;
+            } else if (__resolve_float(s, length, scalar)) {
+                scalar->type = SIMPLE_YAML_SCALAR_FLOAT;
+            } else {
+                memset(&scalar->value, 0, sizeof(scalar->value));
+                scalar->error = 0;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static const SimpleYamlScalar quoted_scalar = { SIMPLE_YAML_SCALAR_STRING };
+
+/* The value accessors also convert quoted scalars (i.e. port: "8080"), the
+node of a quoted scalar caches its value as if plain. */
+static const SimpleYamlScalar* __value(SimpleYamlNode* node)
+{
+    if (node == NULL || node->node_type != YAML_SCALAR_NODE) return NULL;
+    if (node->scalar.type == SIMPLE_YAML_SCALAR_UNRESOLVED) {
+        __resolve(node->value, node->value_length, &node->scalar);
+    }
+    return &node->scalar;
+}
+
+const SimpleYamlScalar* simple_yaml_resolve_scalar(SimpleYamlNode* node)
+{
+    const SimpleYamlScalar* scalar = __value(node);
+    if (scalar && (node->flags & SIMPLE_YAML_NODE_QUOTED)) {
+        return &quoted_scalar;
+    }
+    return scalar;
+}
+
+SimpleYamlScalarType simple_yaml_get_scalar_type(SimpleYamlNode* node)
+{
+    const SimpleYamlScalar* scalar = simple_yaml_resolve_scalar(node);
+    return scalar ? scalar->type : SIMPLE_YAML_SCALAR_UNRESOLVED;
+}
+
+int simple_yaml_get_value_as_bool(SimpleYamlNode* node, bool* value)
+{
+    assert(node);
+    assert(value);
+    const SimpleYamlScalar* scalar = __value(node);
+    if (scalar == NULL) return EINVAL;
+    if (scalar->type == SIMPLE_YAML_SCALAR_BOOL) {
+        *value = scalar->value.boolean;
+        return 0;
+    }
+    if (scalar->type != SIMPLE_YAML_SCALAR_STRING) return EINVAL;
+    /* The YAML 1.1 forms, which are strings in the core schema. */
+    const char** p;
+    const char* bool_true[] = { "y", "yes", "on", NULL };
+    for (p = bool_true; *p; p++) {
+        if (!__equal_word(node->value, node->value_length, *p)) continue;
+        *value = true;
+        return 0;
+    }
+    const char* bool_false[] = { "n", "no", "off", NULL };
+    for (p = bool_false; *p; p++) {
+        if (!__equal_word(node->value, node->value_length, *p)) continue;
+        *value = false;
+        return 0;
+    }
+    return EINVAL;
+}
+
+int simple_yaml_get_value_as_int64(SimpleYamlNode* node, int64_t* value)
+{
+    assert(node);
+    assert(value);
+    const SimpleYamlScalar* scalar = __value(node);
+    if (scalar == NULL || scalar->type != SIMPLE_YAML_SCALAR_INT) return EINVAL;
+    *value = scalar->value.integer;
+    return scalar->error;
+}
+
+int simple_yaml_get_value_as_int(SimpleYamlNode* node, int32_t* value)
+{
+    int64_t v;
+    int rc = simple_yaml_get_value_as_int64(node, &v);
+    if (rc == EINVAL) return rc;
+    if (v > INT32_MAX) {
+        v = INT32_MAX;
+        rc = ERANGE;
+    } else if (v < INT32_MIN) {
+        v = INT32_MIN;
+        rc = ERANGE;
+    }
+    *value = v;
+    return rc;
+}
+
+int simple_yaml_get_value_as_uint(SimpleYamlNode* node, uint32_t* value)
+{
+    int64_t v;
+    int rc = simple_yaml_get_value_as_int64(node, &v);
+    if (rc == EINVAL) return rc;
+    if (v > UINT32_MAX) {
+        v = UINT32_MAX;
+        rc = ERANGE;
+    } else if (v < 0) {
+        v = 0;
+        rc = ERANGE;
+    }
+    *value = v;
+    return rc;
+}
+
+int simple_yaml_get_value_as_double(SimpleYamlNode* node, double* value)
+{
+    assert(node);
+    assert(value);
+    const SimpleYamlScalar* scalar = __value(node);
+    if (scalar == NULL) return EINVAL;
+    if (scalar->type == SIMPLE_YAML_SCALAR_FLOAT) {
+        *value = scalar->value.real;
+        return scalar->error;
+    }
+    if (scalar->type == SIMPLE_YAML_SCALAR_INT) {
+        *value = scalar->value.integer;
+        return scalar->error;
+    }
+    return EINVAL;
+}
@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <simple_yaml.h>
+
+
+/* Readers acquire the current snapshot without a lock:
+
+    enter  entering[epoch & 1]++, retried if the epoch changed meanwhile
+    load   current, then its refs++
+    leave  entering[epoch & 1]--
+
+A publisher swaps current, advances the epoch, and waits until no reader
+is entering with the previous epoch. Any reader which loaded the previous
+snapshot has then counted its reference, and the publisher can drop its own
+reference. Readers which enter after the swap load the new snapshot. The
+last reference (of a reader or the publisher) destroys the snapshot. */
+struct SimpleYamlShared {
+    SimpleYamlSnapshot* current;
+    uint64_t            version;
+    uint32_t            epoch;
+    uint32_t            entering[2];
+    pthread_mutex_t     publish;    /* Publishers, not readers. */
+};
+
+
+static void __resolve_node(SimpleYamlNode* node)
+{
+    switch (node->node_type) {
+        case YAML_MAPPING_NODE:
+            for (uint32_t i = 0; i < node->mapping.count; i++) {
+                __resolve_node(node->mapping.entries[i].node);
+            }
+            break;
+        case YAML_SEQUENCE_NODE:
+            for (uint32_t i = 0; i < hashlist_length(&node->sequence); i++) {
+                __resolve_node(hashlist_get_at(&node->sequence, i));
+            }
+            break;
+        case YAML_SCALAR_NODE:
+            simple_yaml_resolve_scalar(node);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Resolve the scalars of each document not yet resolved, before it can be
+read by several threads. A resolved document is not modified (it may
+already be shared). */
+static void __resolve(HashList* doc_list)
+{
+    if (doc_list == NULL) return;
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        SimpleYamlNode* doc = hashlist_get_at(doc_list, i);
+        if (doc == NULL || (doc->flags & SIMPLE_YAML_NODE_RESOLVED)) continue;
+        __resolve_node(doc);
+        doc->flags |= SIMPLE_YAML_NODE_RESOLVED;
+    }
+}
+
+static SimpleYamlSnapshot* __snapshot_create(HashList* doc_list)
+{
+    SimpleYamlSnapshot* snapshot = calloc(1, sizeof(SimpleYamlSnapshot));
+    if (snapshot == NULL) return NULL;
+    snapshot->doc_list = doc_list;
+    snapshot->refs = 1;
+    return snapshot;
+}
+
+static void __snapshot_destroy(SimpleYamlSnapshot* snapshot)
+{
+    HashList* doc_list = snapshot->doc_list;
+    if (doc_list) {
+        for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+            simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+        }
+        hashlist_destroy(doc_list);
+        free(doc_list);
+    }
+    free(snapshot);
+}
+
+SimpleYamlShared* simple_yaml_shared_create(HashList* doc_list)
+{
+    SimpleYamlShared* shared = calloc(1, sizeof(SimpleYamlShared));
+    if (shared == NULL) {
+        perror("Error creating shared documents");
+        return NULL;
+    }
+    if (pthread_mutex_init(&shared->publish, NULL)) {
+        errno = ENOMEM;
+        perror("Error creating shared documents");
+        free(shared);
+        return NULL;
+    }
+    __resolve(doc_list);
+    shared->current = __snapshot_create(doc_list);
+    if (shared->current == NULL) {
+        perror("Error creating shared documents");
+        pthread_mutex_destroy(&shared->publish);
+        free(shared);
+        return NULL;
+    }
+    shared->current->version = ++shared->version;
+    return shared;
+}
+
+void simple_yaml_shared_destroy(SimpleYamlShared* shared)
+{
+    if (shared == NULL) return;
+    simple_yaml_snapshot_release(shared->current);
+    pthread_mutex_destroy(&shared->publish);
+    free(shared);
+}
+
+int simple_yaml_shared_publish(SimpleYamlShared* shared, HashList* doc_list)
+{
+    __resolve(doc_list);
+    SimpleYamlSnapshot* snapshot = __snapshot_create(doc_list);
+    if (snapshot == NULL) {
+        perror("Error publishing shared documents");
+        return ENOMEM;
+    }
+
+    pthread_mutex_lock(&shared->publish);
+    snapshot->version = ++shared->version;
+    SimpleYamlSnapshot* previous = __atomic_exchange_n(
+            &shared->current, snapshot, __ATOMIC_SEQ_CST);
+    uint32_t epoch = __atomic_fetch_add(&shared->epoch, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&shared->entering[epoch & 1], __ATOMIC_SEQ_CST)) {
+        sched_yield();
+    }
+    pthread_mutex_unlock(&shared->publish);
+
+    simple_yaml_snapshot_release(previous);
+    return 0;
+}
+
+const SimpleYamlSnapshot* simple_yaml_shared_acquire(SimpleYamlShared* shared)
+{
+    uint32_t epoch;
+    while (true) {
+        epoch = __atomic_load_n(&shared->epoch, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&shared->entering[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&shared->epoch, __ATOMIC_SEQ_CST) == epoch) break;
+        __atomic_fetch_sub(&shared->entering[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    }
+    SimpleYamlSnapshot* snapshot =
+            __atomic_load_n(&shared->current, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&snapshot->refs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&shared->entering[epoch & 1], 1, __ATOMIC_RELEASE);
+    return snapshot;
+}
+
+void simple_yaml_snapshot_release(const SimpleYamlSnapshot* snapshot)
+{
+    if (snapshot == NULL) return;
+    SimpleYamlSnapshot* s = (SimpleYamlSnapshot*)snapshot;
+    if (__atomic_sub_fetch(&s->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        __snapshot_destroy(s);
+    }
+}
@@ -0,0 +1,791 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <simple_yaml.h>
+
+
+#define TAPE_MAGIC          0x31545953      /* "SYT1" */
+#define TAPE_VERSION        1
+#define TAPE_ALIGN          8
+
+
+/* The tape is a single allocation, the header is followed by the sections
+(nodes, entries, items, slots and strings). Sections are referenced by
+their offset from the start of the tape, and their content by 32-bit
+indexes, so the tape can be copied (or mapped) to any address. */
+struct SimpleYamlTape {
+    uint32_t            magic;
+    uint32_t            version;
+    uint64_t            size;               /* Of the tape, in bytes. */
+    uint32_t            document_count;
+    uint32_t            documents;          /* Items, the document nodes. */
+    uint32_t            node_count;
+    uint32_t            entry_count;
+    uint32_t            item_count;
+    uint32_t            slot_count;
+    uint32_t            string_length;
+    uint32_t            nodes_offset;
+    uint32_t            entries_offset;
+    uint32_t            items_offset;
+    uint32_t            slots_offset;
+    uint32_t            strings_offset;
+};
+
+/* Node 0 is not used (SIMPLE_YAML_TAPE_NONE). For a scalar offset is the
+string, for a mapping the first entry (and slots the first slot of the
+hashed index, if length exceeds the index threshold), for a sequence the
+first item. */
+typedef struct TapeNode {
+    uint8_t             node_type;
+    uint8_t             scalar_type;
+    uint8_t             error;              /* ERANGE (clamped value). */
+    uint8_t             flags;
+    uint32_t            length;             /* Bytes, entries or items. */
+    uint32_t            offset;
+    uint32_t            slots;
+    union {
+        int64_t         integer;            /* Also a bool (0 or 1). */
+        double          real;
+    } value;
+} TapeNode;
+
+typedef struct TapeEntry {
+    uint32_t            key;                /* String offset. */
+    uint32_t            length;
+    uint32_t            node;
+    uint32_t            hash;               /* Low bits of the key hash. */
+} TapeEntry;
+
+
+/* Freeze state, sections are built in separate arrays, then copied into
+the tape. */
+typedef struct Freezer {
+    TapeNode*           nodes;
+    uint32_t            node_count;
+    uint32_t            node_capacity;
+    TapeEntry*          entries;
+    uint32_t            entry_count;
+    uint32_t            entry_capacity;
+    uint32_t*           items;
+    uint32_t            item_count;
+    uint32_t            item_capacity;
+    uint32_t*           slots;
+    uint32_t            slot_count;
+    uint32_t            slot_capacity;
+    char*               strings;
+    size_t              string_length;
+    size_t              string_capacity;
+    /* Deduplication of strings (source string -> offset + 1). */
+    HashMap             string_index;
+    /* Nodes shared by aliases (node -> node index), frozen once. */
+    SimpleYamlNode**    shared_keys;
+    uint32_t*           shared_values;
+    uint32_t            shared_count;
+    uint32_t            shared_capacity;    /* Power of two. */
+    int                 error;
+} Freezer;
+
+
+/* Grow an array (of size elements) to hold count + more elements, returns
+the array (unchanged, with f->error set, on error). Counts are limited to
+32 bits, the tape uses 32-bit indexes. */
+static void* __grow(Freezer* f, void* array, uint32_t* capacity,
+        uint32_t count, uint32_t more, size_t size)
+{
+    if ((uint64_t)count + more <= *capacity) return array;
+    if ((uint64_t)count + more > UINT32_MAX / 2) {
+        f->error = EOVERFLOW;
+        return array;
+    }
+    uint32_t c = *capacity ? *capacity : 64;
+    while (c < count + more) c *= 2;
+    void* a = realloc(array, (size_t)c * size);
+    if (a == NULL) {
+        f->error = ENOMEM;
+        return array;
+    }
+    *capacity = c;
+    return a;
+}
+
+static uint32_t __string(Freezer* f, const char* s, size_t length)
+{
+    uint64_t hash = hashmap_default_hash_length(s, length);
+    uintptr_t offset = (uintptr_t)hashmap_get_hashed(
+            &f->string_index, s, length, hash);
+    if (offset) return offset - 1;
+    if (f->string_length + length + 1 > UINT32_MAX) {
+        f->error = EOVERFLOW;
+        return 0;
+    }
+    if (f->string_length + length + 1 > f->string_capacity) {
+        size_t capacity = f->string_capacity ? f->string_capacity : 4096;
+        while (capacity < f->string_length + length + 1) capacity *= 2;
+        char* strings = realloc(f->strings, capacity);
+        if (strings == NULL) {
+            f->error = ENOMEM;
+            return 0;
+        }
+        f->strings = strings;
+        f->string_capacity = capacity;
+    }
+    offset = f->string_length;
+    memcpy(f->strings + offset, s, length);
+    f->strings[offset + length] = '\0';
+    f->string_length += length + 1;
+    /* The source string (which outlives the freeze) is the key. */
+    if (hashmap_set_hashed(&f->string_index, s, length, hash,
+            (void*)(offset + 1)) == NULL) {
+        f->error = ENOMEM;
+    }
+    return offset;
+}
+
+static uint32_t* __shared_slot(Freezer* f, SimpleYamlNode* node, bool insert)
+{
+    if (insert && (f->shared_count + 1) * 2 > f->shared_capacity) {
+        uint32_t capacity = f->shared_capacity ? f->shared_capacity * 2 : 64;
+        SimpleYamlNode** keys = calloc(capacity, sizeof(SimpleYamlNode*));
+        uint32_t* values = calloc(capacity, sizeof(uint32_t));
+        if (keys == NULL || values == NULL) {
+            free(keys);
+            free(values);
+            f->error = ENOMEM;
+            return NULL;
+        }
+        for (uint32_t i = 0; i < f->shared_capacity; i++) {
+            if (f->shared_keys[i] == NULL) continue;
+            uint32_t j = ((uintptr_t)f->shared_keys[i] >> 4) & (capacity - 1);
+            while (keys[j]) j = (j + 1) & (capacity - 1);
+            keys[j] = f->shared_keys[i];
+            values[j] = f->shared_values[i];
+        }
+        free(f->shared_keys);
+        free(f->shared_values);
+        f->shared_keys = keys;
+        f->shared_values = values;
+        f->shared_capacity = capacity;
+    }
+    if (f->shared_capacity == 0) return NULL;
+    uint32_t mask = f->shared_capacity - 1;
+    uint32_t i = ((uintptr_t)node >> 4) & mask;
+    while (f->shared_keys[i] && f->shared_keys[i] != node) i = (i + 1) & mask;
+    if (f->shared_keys[i] == NULL) {
+        if (!insert) return NULL;
+        f->shared_keys[i] = node;
+        f->shared_count++;
+    }
+    return &f->shared_values[i];
+}
+
+static uint32_t __slot_count(uint32_t count)
+{
+    uint32_t slots = 16;
+    while (slots < count * 2) slots *= 2;
+    return slots;
+}
+
+static uint32_t __freeze_node(Freezer* f, SimpleYamlNode* node);
+
+static uint32_t __freeze_mapping(Freezer* f, uint32_t index,
+        SimpleYamlNode* node)
+{
+    uint32_t count = node->mapping.count;
+    f->entries = __grow(f, f->entries, &f->entry_capacity, f->entry_count,
+            count, sizeof(TapeEntry));
+    if (f->error) return 0;
+    uint32_t first = f->entry_count;
+    f->entry_count += count;
+    for (uint32_t i = 0; i < count && !f->error; i++) {
+        const SimpleYamlMappingEntry* entry = &node->mapping.entries[i];
+        uint32_t key = __string(f, entry->key, entry->length);
+        uint32_t child = __freeze_node(f, entry->node);
+        /* Reference by index, the arrays move as they grow. */
+        TapeEntry* e = &f->entries[first + i];
+        e->key = key;
+        e->length = entry->length;
+        e->node = child;
+        e->hash = hashmap_default_hash_length(entry->key, entry->length);
+    }
+    TapeNode* n = &f->nodes[index];
+    n->length = count;
+    n->offset = first;
+    if (count > SIMPLE_YAML_MAPPING_INDEX_THRESHOLD && !f->error) {
+        /* Hashed index, open addressing (entry index + 1). */
+        uint32_t slots = __slot_count(count);
+        f->slots = __grow(f, f->slots, &f->slot_capacity, f->slot_count,
+                slots, sizeof(uint32_t));
+        if (f->error) return 0;
+        uint32_t* s = f->slots + f->slot_count;
+        memset(s, 0, slots * sizeof(uint32_t));
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t j = f->entries[first + i].hash & (slots - 1);
+            while (s[j]) j = (j + 1) & (slots - 1);
+            s[j] = i + 1;
+        }
+        f->nodes[index].slots = f->slot_count;
+        f->slot_count += slots;
+    }
+    return index;
+}
+
+static uint32_t __freeze_sequence(Freezer* f, uint32_t index,
+        SimpleYamlNode* node)
+{
+    uint32_t count = hashlist_length(&node->sequence);
+    f->items = __grow(f, f->items, &f->item_capacity, f->item_count,
+            count, sizeof(uint32_t));
+    if (f->error) return 0;
+    uint32_t first = f->item_count;
+    f->item_count += count;
+    for (uint32_t i = 0; i < count && !f->error; i++) {
+        uint32_t child = __freeze_node(f, hashlist_get_at(&node->sequence, i));
+        f->items[first + i] = child;
+    }
+    f->nodes[index].length = count;
+    f->nodes[index].offset = first;
+    return index;
+}
+
+static uint32_t __freeze_node(Freezer* f, SimpleYamlNode* node)
+{
+    if (f->error) return 0;
+    if (node->refs) {
+        uint32_t* shared = __shared_slot(f, node, false);
+        if (shared) return *shared;
+    }
+    f->nodes = __grow(f, f->nodes, &f->node_capacity, f->node_count,
+            1, sizeof(TapeNode));
+    if (f->error) return 0;
+    uint32_t index = f->node_count++;
+    TapeNode* n = &f->nodes[index];
+    memset(n, 0, sizeof(TapeNode));
+    n->node_type = node->node_type;
+    n->flags = node->flags & (SIMPLE_YAML_NODE_QUOTED | SIMPLE_YAML_NODE_MERGE);
+    if (node->refs) {
+        uint32_t* shared = __shared_slot(f, node, true);
+        if (shared == NULL) return 0;
+        *shared = index;
+    }
+    if (node->node_type == YAML_MAPPING_NODE) {
+        return __freeze_mapping(f, index, node);
+    }
+    if (node->node_type == YAML_SEQUENCE_NODE) {
+        return __freeze_sequence(f, index, node);
+    }
+    if (node->node_type == YAML_SCALAR_NODE) {
+        const SimpleYamlScalar* scalar = simple_yaml_resolve_scalar(node);
+        uint32_t offset = __string(f, node->value, node->value_length);
+        n = &f->nodes[index];
+        n->offset = offset;
+        n->length = node->value_length;
+        n->scalar_type = scalar->type;
+        n->error = scalar->error;
+        n->value.integer = scalar->value.integer;
+        if (scalar->type == SIMPLE_YAML_SCALAR_FLOAT) {
+            n->value.real = scalar->value.real;
+        } else if (scalar->type == SIMPLE_YAML_SCALAR_BOOL) {
+            n->value.integer = scalar->value.boolean;
+        }
+    }
+    return index;
+}
+
+static size_t __align(size_t offset)
+{
+    return (offset + TAPE_ALIGN - 1) & ~(size_t)(TAPE_ALIGN - 1);
+}
+
+static SimpleYamlTape* __tape_create(Freezer* f, uint32_t document_count,
+        uint32_t documents)
+{
+    size_t nodes = __align(sizeof(SimpleYamlTape));
+    size_t entries = __align(nodes + f->node_count * sizeof(TapeNode));
+    size_t items = __align(entries + f->entry_count * sizeof(TapeEntry));
+    size_t slots = __align(items + f->item_count * sizeof(uint32_t));
+    size_t strings = __align(slots + f->slot_count * sizeof(uint32_t));
+    size_t size = __align(strings + f->string_length);
+    if (size > UINT32_MAX) {
+        f->error = EOVERFLOW;
+        return NULL;
+    }
+    char* data = calloc(1, size);
+    if (data == NULL) {
+        f->error = ENOMEM;
+        return NULL;
+    }
+    SimpleYamlTape* tape = (SimpleYamlTape*)data;
+    tape->magic = TAPE_MAGIC;
+    tape->version = TAPE_VERSION;
+    tape->size = size;
+    tape->document_count = document_count;
+    tape->documents = documents;
+    tape->node_count = f->node_count;
+    tape->entry_count = f->entry_count;
+    tape->item_count = f->item_count;
+    tape->slot_count = f->slot_count;
+    tape->string_length = f->string_length;
+    tape->nodes_offset = nodes;
+    tape->entries_offset = entries;
+    tape->items_offset = items;
+    tape->slots_offset = slots;
+    tape->strings_offset = strings;
+    memcpy(data + nodes, f->nodes, f->node_count * sizeof(TapeNode));
+    memcpy(data + strings, f->strings, f->string_length);
+    if (f->entry_count) {
+        memcpy(data + entries, f->entries, f->entry_count * sizeof(TapeEntry));
+    }
+    if (f->item_count) {
+        memcpy(data + items, f->items, f->item_count * sizeof(uint32_t));
+    }
+    if (f->slot_count) {
+        memcpy(data + slots, f->slots, f->slot_count * sizeof(uint32_t));
+    }
+    return tape;
+}
+
+SimpleYamlTape* simple_yaml_freeze(HashList* doc_list)
+{
+    errno = 0;
+    if (doc_list == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    Freezer f;
+    memset(&f, 0, sizeof(Freezer));
+    if (hashmap_init_length(&f.string_index, 1024, NULL, NULL)
+            != HASHMAP_SUCCESS) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    f.string_index.borrowed_keys = 1;
+
+    /* Node 0 (SIMPLE_YAML_TAPE_NONE) and string 0 ("") are placeholders. */
+    uint32_t count = hashlist_length(doc_list);
+    SimpleYamlTape* tape = NULL;
+    f.nodes = __grow(&f, NULL, &f.node_capacity, 0, 1, sizeof(TapeNode));
+    if (f.nodes) memset(f.nodes, 0, sizeof(TapeNode));
+    f.node_count = 1;
+    __string(&f, "", 0);
+    /* The document nodes are the first items. */
+    uint32_t documents = 0;
+    f.items = __grow(&f, NULL, &f.item_capacity, 0, count ? count : 1,
+            sizeof(uint32_t));
+    f.item_count = count;
+    for (uint32_t i = 0; i < count && !f.error; i++) {
+        uint32_t root = __freeze_node(&f, hashlist_get_at(doc_list, i));
+        f.items[documents + i] = root;
+    }
+    if (!f.error) tape = __tape_create(&f, count, documents);
+
+    hashmap_destroy(&f.string_index);
+    free(f.nodes);
+    free(f.entries);
+    free(f.items);
+    free(f.slots);
+    free(f.strings);
+    free(f.shared_keys);
+    free(f.shared_values);
+    if (f.error) {
+        errno = f.error;
+        perror("Error freezing YAML documents");
+        errno = f.error;
+    }
+    return tape;
+}
+
+
+void simple_yaml_tape_destroy(SimpleYamlTape* tape)
+{
+    free(tape);
+}
+
+size_t simple_yaml_tape_size(const SimpleYamlTape* tape)
+{
+    return tape ? tape->size : 0;
+}
+
+static const TapeNode* __node(const SimpleYamlTape* tape, SimpleYamlTapeRef ref)
+{
+    if (tape == NULL || ref == SIMPLE_YAML_TAPE_NONE || ref >= tape->node_count) {
+        return NULL;
+    }
+    return (const TapeNode*)((const char*)tape + tape->nodes_offset) + ref;
+}
+
+static const TapeEntry* __entries(const SimpleYamlTape* tape)
+{
+    return (const TapeEntry*)((const char*)tape + tape->entries_offset);
+}
+
+static const uint32_t* __items(const SimpleYamlTape* tape)
+{
+    return (const uint32_t*)((const char*)tape + tape->items_offset);
+}
+
+static const char* __strings(const SimpleYamlTape* tape)
+{
+    return (const char*)tape + tape->strings_offset;
+}
+
+uint32_t simple_yaml_tape_document_count(const SimpleYamlTape* tape)
+{
+    return tape ? tape->document_count : 0;
+}
+
+SimpleYamlTapeRef simple_yaml_tape_document(
+        const SimpleYamlTape* tape, uint32_t index)
+{
+    if (tape == NULL || index >= tape->document_count) {
+        return SIMPLE_YAML_TAPE_NONE;
+    }
+    return __items(tape)[tape->documents + index];
+}
+
+yaml_node_type_t simple_yaml_tape_node_type(
+        const SimpleYamlTape* tape, SimpleYamlTapeRef ref)
+{
+    const TapeNode* n = __node(tape, ref);
+    return n ? n->node_type : YAML_NO_NODE;
+}
+
+uint32_t simple_yaml_tape_length(
+        const SimpleYamlTape* tape, SimpleYamlTapeRef ref)
+{
+    const TapeNode* n = __node(tape, ref);
+    if (n == NULL || n->node_type == YAML_SCALAR_NODE) return 0;
+    return n->length;
+}
+
+SimpleYamlTapeRef simple_yaml_tape_get_at(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, uint32_t index, const char** key)
+{
+    const TapeNode* n = __node(tape, ref);
+    if (key) *key = NULL;
+    if (n == NULL || index >= simple_yaml_tape_length(tape, ref)) {
+        return SIMPLE_YAML_TAPE_NONE;
+    }
+    if (n->node_type == YAML_SEQUENCE_NODE) return __items(tape)[n->offset + index];
+    const TapeEntry* entry = &__entries(tape)[n->offset + index];
+    if (key) *key = __strings(tape) + entry->key;
+    return entry->node;
+}
+
+static SimpleYamlTapeRef __lookup(const SimpleYamlTape* tape,
+        const TapeNode* n, const char* key, size_t length, uint32_t hash)
+{
+    const TapeEntry* entries = __entries(tape) + n->offset;
+    const char* strings = __strings(tape);
+    SimpleYamlTapeRef found = SIMPLE_YAML_TAPE_NONE;
+    if (n->length > SIMPLE_YAML_MAPPING_INDEX_THRESHOLD) {
+        const uint32_t* slots =
+                (const uint32_t*)((const char*)tape + tape->slots_offset) + n->slots;
+        uint32_t mask = __slot_count(n->length) - 1;
+        for (uint32_t j = hash & mask; slots[j]; j = (j + 1) & mask) {
+            const TapeEntry* entry = &entries[slots[j] - 1];
+            if (entry->hash == hash && entry->length == length
+                    && memcmp(strings + entry->key, key, length) == 0) {
+                found = entry->node;
+                break;
+            }
+        }
+    } else {
+        for (uint32_t i = 0; i < n->length; i++) {
+            const TapeEntry* entry = &entries[i];
+            if (entry->hash == hash && entry->length == length
+                    && memcmp(strings + entry->key, key, length) == 0) {
+                found = entry->node;
+                break;
+            }
+        }
+    }
+    if (found || !(n->flags & SIMPLE_YAML_NODE_MERGE)) return found;
+
+    /* Merge keys (<<), search the merged mappings in order. */
+    for (uint32_t i = 0; i < n->length && !found; i++) {
+        const TapeEntry* entry = &entries[i];
+        if (entry->length != 2 || memcmp(strings + entry->key, "<<", 2)) continue;
+        const TapeNode* merge = __node(tape, entry->node);
+        if (merge->node_type == YAML_MAPPING_NODE) {
+            found = __lookup(tape, merge, key, length, hash);
+        } else if (merge->node_type == YAML_SEQUENCE_NODE) {
+            const uint32_t* items = __items(tape) + merge->offset;
+            for (uint32_t j = 0; j < merge->length && !found; j++) {
+                const TapeNode* item = __node(tape, items[j]);
+                if (item->node_type != YAML_MAPPING_NODE) continue;
+                found = __lookup(tape, item, key, length, hash);
+            }
+        }
+    }
+    return found;
+}
+
+SimpleYamlTapeRef simple_yaml_tape_mapping_get(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, const char* key)
+{
+    const TapeNode* n = __node(tape, ref);
+    if (n == NULL || n->node_type != YAML_MAPPING_NODE) return SIMPLE_YAML_TAPE_NONE;
+    size_t length = strlen(key);
+    return __lookup(tape, n, key, length, hashmap_default_hash_length(key, length));
+}
+
+SimpleYamlTapeRef simple_yaml_tape_find(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, const char* path)
+{
+    const char* token = path;
+    while (__node(tape, ref)) {
+        const TapeNode* n = __node(tape, ref);
+        while (*token == '/') token++;
+        if (*token == '\0') break;
+        size_t length = strcspn(token, "/");
+        if (n->node_type == YAML_SEQUENCE_NODE) {
+            /* Sequence index, digits only. */
+            uint64_t index = 0;
+            for (size_t i = 0; i < length; i++) {
+                if (token[i] < '0' || token[i] > '9' || index > UINT32_MAX) {
+                    return SIMPLE_YAML_TAPE_NONE;
+                }
+                index = index * 10 + (token[i] - '0');
+            }
+            if (index >= n->length) return SIMPLE_YAML_TAPE_NONE;
+            ref = __items(tape)[n->offset + index];
+        } else if (n->node_type == YAML_MAPPING_NODE) {
+            ref = __lookup(tape, n, token, length,
+                    hashmap_default_hash_length(token, length));
+        } else {
+            return SIMPLE_YAML_TAPE_NONE;
+        }
+        token += length;
+    }
+    return ref;
+}
+
+const char* simple_yaml_tape_value(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, size_t* length)
+{
+    const TapeNode* n = __node(tape, ref);
+    if (n == NULL || n->node_type != YAML_SCALAR_NODE) return NULL;
+    if (length) *length = n->length;
+    return __strings(tape) + n->offset;
+}
+
+SimpleYamlScalarType simple_yaml_tape_scalar_type(
+        const SimpleYamlTape* tape, SimpleYamlTapeRef ref)
+{
+    const TapeNode* n = __node(tape, ref);
+    if (n == NULL || n->node_type != YAML_SCALAR_NODE) {
+        return SIMPLE_YAML_SCALAR_UNRESOLVED;
+    }
+    return n->scalar_type;
+}
+
+int simple_yaml_tape_get_bool(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, bool* value)
+{
+    const TapeNode* n = __node(tape, ref);
+    if (n == NULL || n->node_type != YAML_SCALAR_NODE
+            || n->scalar_type != SIMPLE_YAML_SCALAR_BOOL) return EINVAL;
+    *value = n->value.integer != 0;
+    return 0;
+}
+
+int simple_yaml_tape_get_int64(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, int64_t* value)
+{
+    const TapeNode* n = __node(tape, ref);
+    if (n == NULL || n->node_type != YAML_SCALAR_NODE
+            || n->scalar_type != SIMPLE_YAML_SCALAR_INT) return EINVAL;
+    *value = n->value.integer;
+    return n->error;
+}
+
+int simple_yaml_tape_get_double(const SimpleYamlTape* tape,
+        SimpleYamlTapeRef ref, double* value)
+{
+    const TapeNode* n = __node(tape, ref);
+    if (n == NULL || n->node_type != YAML_SCALAR_NODE) return EINVAL;
+    if (n->scalar_type == SIMPLE_YAML_SCALAR_INT) {
+        *value = (double)n->value.integer;
+        return n->error;
+    }
+    if (n->scalar_type != SIMPLE_YAML_SCALAR_FLOAT) return EINVAL;
+    *value = n->value.real;
+    return n->error;
+}
+
+/* Bounds of the sections, and of each reference, so that the accessors of a
+valid tape only read within it. */
+static bool __section(const SimpleYamlTape* tape, uint32_t offset,
+        uint32_t count, size_t size)
+{
+    return offset >= sizeof(SimpleYamlTape) && offset % TAPE_ALIGN == 0
+            && (uint64_t)offset + (uint64_t)count * size <= tape->size;
+}
+
+static bool __string_valid(const SimpleYamlTape* tape, uint32_t offset,
+        uint32_t length)
+{
+    return (uint64_t)offset + length < tape->string_length
+            && __strings(tape)[offset + length] == '\0';
+}
+
+static bool __ref_valid(const SimpleYamlTape* tape, uint32_t ref)
+{
+    return ref != SIMPLE_YAML_TAPE_NONE && ref < tape->node_count;
+}
+
+static bool __node_valid(const SimpleYamlTape* tape, const TapeNode* n)
+{
+    switch (n->node_type) {
+        case YAML_NO_NODE:
+            return true;
+        case YAML_SCALAR_NODE:
+            return n->scalar_type <= SIMPLE_YAML_SCALAR_STRING
+                    && __string_valid(tape, n->offset, n->length);
+        case YAML_SEQUENCE_NODE:
+            return (uint64_t)n->offset + n->length <= tape->item_count;
+        case YAML_MAPPING_NODE:
+            break;
+        default:
+            return false;
+    }
+    if ((uint64_t)n->offset + n->length > tape->entry_count) return false;
+    if (n->length <= SIMPLE_YAML_MAPPING_INDEX_THRESHOLD) return true;
+    uint32_t slot_count = __slot_count(n->length);
+    if ((uint64_t)n->slots + slot_count > tape->slot_count) return false;
+    /* Each slot is empty or an entry, some slots are empty (which ends a
+    probe). */
+    const uint32_t* slots =
+            (const uint32_t*)((const char*)tape + tape->slots_offset) + n->slots;
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        if (slots[i] > n->length) return false;
+        if (slots[i]) used++;
+    }
+    return used == n->length;
+}
+
+/* Merge sources of a mapping (mappings merged directly, or from a merged
+sequence), *entry and *item track the position. */
+static uint32_t __merge_next(const SimpleYamlTape* tape, const TapeNode* n,
+        uint32_t* entry, uint32_t* item)
+{
+    if (!(n->flags & SIMPLE_YAML_NODE_MERGE)) return SIMPLE_YAML_TAPE_NONE;
+    const TapeEntry* entries = __entries(tape) + n->offset;
+    const char* strings = __strings(tape);
+    for (; *entry < n->length; (*entry)++, *item = 0) {
+        const TapeEntry* e = &entries[*entry];
+        if (e->length != 2 || memcmp(strings + e->key, "<<", 2)) continue;
+        const TapeNode* merge = __node(tape, e->node);
+        if (merge->node_type == YAML_MAPPING_NODE) {
+            if (*item == 0) {
+                (*item)++;
+                return e->node;
+            }
+        } else if (merge->node_type == YAML_SEQUENCE_NODE) {
+            const uint32_t* items = __items(tape) + merge->offset;
+            while (*item < merge->length) {
+                uint32_t ref = items[(*item)++];
+                if (__node(tape, ref)->node_type == YAML_MAPPING_NODE) return ref;
+            }
+        }
+    }
+    return SIMPLE_YAML_TAPE_NONE;
+}
+
+typedef struct MergeFrame {
+    uint32_t            ref;
+    uint32_t            entry;
+    uint32_t            item;
+} MergeFrame;
+
+/* Merged lookups follow merge sources, which a parsed document can not make
+into a cycle. Returns 0, EINVAL if the merges of the tape form a cycle (or
+ENOMEM). */
+static int __merge_acyclic(const SimpleYamlTape* tape)
+{
+    enum { WHITE = 0, GREY, BLACK };
+    uint8_t* state = calloc(tape->node_count, sizeof(uint8_t));
+    MergeFrame* stack = malloc(tape->node_count * sizeof(MergeFrame));
+    int rc = (state && stack) ? 0 : ENOMEM;
+    for (uint32_t i = 1; i < tape->node_count && rc == 0; i++) {
+        const TapeNode* n = __node(tape, i);
+        if (state[i] || n->node_type != YAML_MAPPING_NODE
+                || !(n->flags & SIMPLE_YAML_NODE_MERGE)) continue;
+        uint32_t depth = 0;
+        stack[depth++] = (MergeFrame){ .ref = i };
+        state[i] = GREY;
+        while (depth && rc == 0) {
+            MergeFrame* frame = &stack[depth - 1];
+            uint32_t ref = __merge_next(tape, __node(tape, frame->ref),
+                    &frame->entry, &frame->item);
+            if (ref == SIMPLE_YAML_TAPE_NONE) {
+                state[frame->ref] = BLACK;
+                depth--;
+            } else if (state[ref] == GREY) {
+                rc = EINVAL;
+            } else if (state[ref] == WHITE) {
+                state[ref] = GREY;
+                stack[depth++] = (MergeFrame){ .ref = ref };
+            }
+        }
+    }
+    free(state);
+    free(stack);
+    return rc;
+}
+
+int simple_yaml_tape_validate(const void* data, size_t length)
+{
+    const SimpleYamlTape* tape = data;
+    if (data == NULL || length < sizeof(SimpleYamlTape)
+            || (uintptr_t)data % TAPE_ALIGN) return EINVAL;
+    if (tape->magic != TAPE_MAGIC || tape->version != TAPE_VERSION
+            || tape->size != length) return EINVAL;
+    if (!__section(tape, tape->nodes_offset, tape->node_count, sizeof(TapeNode))
+            || !__section(tape, tape->entries_offset, tape->entry_count,
+                    sizeof(TapeEntry))
+            || !__section(tape, tape->items_offset, tape->item_count,
+                    sizeof(uint32_t))
+            || !__section(tape, tape->slots_offset, tape->slot_count,
+                    sizeof(uint32_t))
+            || !__section(tape, tape->strings_offset, tape->string_length, 1)
+            || tape->node_count == 0 || tape->string_length == 0
+            || __strings(tape)[tape->string_length - 1] != '\0'
+            || (uint64_t)tape->documents + tape->document_count
+                    > tape->item_count) return EINVAL;
+
+    for (uint32_t i = 1; i < tape->node_count; i++) {
+        if (!__node_valid(tape, __node(tape, i))) return EINVAL;
+    }
+    const TapeEntry* entries = __entries(tape);
+    for (uint32_t i = 0; i < tape->entry_count; i++) {
+        if (!__string_valid(tape, entries[i].key, entries[i].length)
+                || !__ref_valid(tape, entries[i].node)) return EINVAL;
+    }
+    const uint32_t* items = __items(tape);
+    for (uint32_t i = 0; i < tape->item_count; i++) {
+        if (!__ref_valid(tape, items[i])) return EINVAL;
+    }
+    return __merge_acyclic(tape);
+}
+
+const SimpleYamlTape* simple_yaml_tape_open(const void* data, size_t length)
+{
+    int rc = simple_yaml_tape_validate(data, length);
+    if (rc) {
+        errno = rc;
+        return NULL;
+    }
+    return data;
+}
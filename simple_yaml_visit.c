@@ -0,0 +1,329 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#ifdef __STDC_ALLOC_LIB__
+#define __STDC_WANT_LIB_EXT2__ 1
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <yaml.h>
+#include <simple_yaml.h>
+
+
+#define VISIT_INDEX_LEN     (10+1)
+
+
+typedef struct VisitFrame {
+    yaml_node_type_t    node_type;      /* Mapping or sequence. */
+    size_t              path_length;    /* Path of the collection. */
+    size_t              key_offset;     /* Key of the collection in path. */
+    uint32_t            index;          /* Index of the collection. */
+    uint32_t            count;          /* Items, or keys and values, seen. */
+} VisitFrame;
+
+typedef struct Visitor {
+    yaml_parser_t           parser;
+    SimpleYamlVisitCallback callback;
+    void*                   data;
+    /* Collection stack, and the path of the current node. */
+    VisitFrame*             frames;
+    uint32_t                depth;
+    uint32_t                capacity;
+    char*                   path;
+    size_t                  path_length;
+    size_t                  path_capacity;
+    /* Event passed to the callback. */
+    SimpleYamlEvent         event;
+} Visitor;
+
+
+static int __path_set(Visitor* v, size_t base, const char* key, size_t length)
+{
+    size_t sep = base ? 1 : 0;
+    size_t required = base + sep + length + 1;
+    if (required > v->path_capacity) {
+        size_t capacity = v->path_capacity ? v->path_capacity : 256;
+        while (capacity < required) capacity *= 2;
+        char* path = realloc(v->path, capacity);
+        if (path == NULL) return ENOMEM;
+        v->path = path;
+        v->path_capacity = capacity;
+    }
+    if (sep) v->path[base] = '/';
+    memcpy(v->path + base + sep, key, length);
+    v->path_length = base + sep + length;
+    v->path[v->path_length] = '\0';
+    v->event.key = v->path + base + sep;
+    return 0;
+}
+
+static int __push(Visitor* v, yaml_node_type_t node_type)
+{
+    if (v->depth == v->capacity) {
+        uint32_t capacity = v->capacity ? v->capacity * 2 : 16;
+        VisitFrame* frames = realloc(v->frames, capacity * sizeof(VisitFrame));
+        if (frames == NULL) return ENOMEM;
+        v->frames = frames;
+        v->capacity = capacity;
+    }
+    VisitFrame* frame = &v->frames[v->depth++];
+    frame->node_type = node_type;
+    frame->path_length = v->path_length;
+    frame->key_offset = v->event.key ? (size_t)(v->event.key - v->path) : SIZE_MAX;
+    frame->index = v->event.index;
+    frame->count = 0;
+    return 0;
+}
+
+static void __pop(Visitor* v)
+{
+    VisitFrame* frame = &v->frames[--v->depth];
+    v->path_length = frame->path_length;
+    if (v->path) v->path[v->path_length] = '\0';
+    v->event.key = (frame->key_offset != SIZE_MAX)
+            ? v->path + frame->key_offset : NULL;
+    v->event.index = frame->index;
+}
+
+/* Consume the events of the node which starts with event (a scalar, alias or
+the start of a collection). */
+static int __skip_node(Visitor* v, yaml_event_t* event)
+{
+    int level = 0;
+    do {
+        switch (event->type) {
+            case YAML_MAPPING_START_EVENT:
+            case YAML_SEQUENCE_START_EVENT:
+                level++;
+                break;
+            case YAML_MAPPING_END_EVENT:
+            case YAML_SEQUENCE_END_EVENT:
+                level--;
+                break;
+            default:
+                break;
+        }
+        yaml_event_delete(event);
+        if (level == 0) return 0;
+        if (!yaml_parser_parse(&v->parser, event)) return ECANCELED;
+    } while (true);
+}
+
+static int __skip_document(Visitor* v, yaml_event_t* event)
+{
+    do {
+        bool end = (event->type == YAML_DOCUMENT_END_EVENT);
+        yaml_event_delete(event);
+        if (end) return 0;
+        if (!yaml_parser_parse(&v->parser, event)) return ECANCELED;
+    } while (true);
+}
+
+static int __callback(Visitor* v, SimpleYamlEventType type)
+{
+    v->event.type = type;
+    v->event.depth = v->depth;
+    v->event.path = v->path ? v->path : "";
+    v->event.path_length = v->path_length;
+    return v->callback(&v->event, v->data);
+}
+
+/* Position the path at the next node of the current collection, is_key is
+set when that node is a mapping key. */
+static int __next_node(Visitor* v, bool* is_key)
+{
+    *is_key = false;
+    if (v->depth == 0) {
+        v->event.key = NULL;
+        v->event.index = 0;
+        v->path_length = 0;
+        if (v->path) v->path[0] = '\0';
+        return 0;
+    }
+    VisitFrame* frame = &v->frames[v->depth - 1];
+    if (frame->node_type == YAML_SEQUENCE_NODE) {
+        char index[VISIT_INDEX_LEN];
+        int length = snprintf(index, sizeof(index), "%u", frame->count);
+        int rc = __path_set(v, frame->path_length, index, length);
+        v->event.key = NULL;
+        v->event.index = frame->count++;
+        return rc;
+    }
+    *is_key = (frame->count++ % 2 == 0);
+    return 0;
+}
+
+/* Skip the value following a mapping key. */
+static int __skip_value(Visitor* v, yaml_event_t* event)
+{
+    yaml_event_delete(event);
+    if (!yaml_parser_parse(&v->parser, event)) return ECANCELED;
+    v->frames[v->depth - 1].count++;
+    return __skip_node(v, event);
+}
+
+static int __visit(Visitor* v)
+{
+    yaml_event_t event;
+    int action = SIMPLE_YAML_VISIT_CONTINUE;
+    int rc = 0;
+    do {
+        if (!yaml_parser_parse(&v->parser, &event)) return ECANCELED;
+
+        bool is_key = false;
+        switch (event.type) {
+            case YAML_DOCUMENT_START_EVENT:
+                v->depth = 0;
+                __next_node(v, &is_key);
+                action = __callback(v, SIMPLE_YAML_EVENT_DOCUMENT_START);
+                if (action == SIMPLE_YAML_VISIT_SKIP) {
+                    rc = __skip_document(v, &event);
+                    v->event.document++;
+                    if (rc) return rc;
+                    continue;
+                }
+                break;
+            case YAML_DOCUMENT_END_EVENT:
+                action = __callback(v, SIMPLE_YAML_EVENT_DOCUMENT_END);
+                v->event.document++;
+                break;
+            case YAML_SCALAR_EVENT:
+            case YAML_ALIAS_EVENT:
+            case YAML_MAPPING_START_EVENT:
+            case YAML_SEQUENCE_START_EVENT:
+                rc = __next_node(v, &is_key);
+                if (rc) break;
+                if (is_key && event.type != YAML_SCALAR_EVENT) {
+                    /* Complex keys are not supported, skip the key and
+                    the value. */
+                    rc = __skip_node(v, &event);
+                    if (rc == 0) {
+                        rc = __skip_value(v, &event);
+                    }
+                    if (rc) return rc;
+                    continue;
+                }
+                if (is_key) {
+                    rc = __path_set(v, v->frames[v->depth - 1].path_length,
+                            (const char*)event.data.scalar.value,
+                            event.data.scalar.length);
+                    if (rc) break;
+                    v->event.index = 0;
+                    action = __callback(v, SIMPLE_YAML_EVENT_KEY);
+                    if (action == SIMPLE_YAML_VISIT_SKIP) {
+                        rc = __skip_value(v, &event);
+                        if (rc) return rc;
+                        continue;
+                    }
+                } else if (event.type == YAML_SCALAR_EVENT) {
+                    v->event.value = (const char*)event.data.scalar.value;
+                    v->event.length = event.data.scalar.length;
+                    action = __callback(v, SIMPLE_YAML_EVENT_SCALAR);
+                } else if (event.type == YAML_ALIAS_EVENT) {
+                    v->event.value = (const char*)event.data.alias.anchor;
+                    v->event.length = strlen(v->event.value);
+                    action = __callback(v, SIMPLE_YAML_EVENT_ALIAS);
+                } else {
+                    yaml_node_type_t node_type =
+                            (event.type == YAML_MAPPING_START_EVENT)
+                            ? YAML_MAPPING_NODE : YAML_SEQUENCE_NODE;
+                    action = __callback(v, (node_type == YAML_MAPPING_NODE)
+                            ? SIMPLE_YAML_EVENT_MAPPING_START
+                            : SIMPLE_YAML_EVENT_SEQUENCE_START);
+                    if (action == SIMPLE_YAML_VISIT_SKIP) {
+                        rc = __skip_node(v, &event);
+                        if (rc) return rc;
+                        continue;
+                    }
+                    rc = __push(v, node_type);
+                }
+                v->event.value = NULL;
+                v->event.length = 0;
+                break;
+            case YAML_MAPPING_END_EVENT:
+            case YAML_SEQUENCE_END_EVENT:
+                __pop(v);
+                action = __callback(v, (event.type == YAML_MAPPING_END_EVENT)
+                        ? SIMPLE_YAML_EVENT_MAPPING_END
+                        : SIMPLE_YAML_EVENT_SEQUENCE_END);
+                break;
+            case YAML_STREAM_END_EVENT:
+                yaml_event_delete(&event);
+                return 0;
+            default:
+                break;
+        }
+        yaml_event_delete(&event);
+        if (rc) return rc;
+        if (action == SIMPLE_YAML_VISIT_STOP) return 0;
+    } while (true);
+}
+
+static int __visitor_run(Visitor* v)
+{
+    int rc = __visit(v);
+    if (rc) {
+        errno = rc;
+        perror("Error while visiting YAML stream");
+    }
+    yaml_parser_delete(&v->parser);
+    free(v->frames);
+    free(v->path);
+    return rc;
+}
+
+static int __visitor_init(
+        Visitor* v, SimpleYamlVisitCallback callback, void* data)
+{
+    memset(v, 0, sizeof(Visitor));
+    v->callback = callback;
+    v->data = data;
+    if (!yaml_parser_initialize(&v->parser)) {
+        if (errno==0) errno = ECANCELED;
+        perror("Error initializing parser");
+        return errno;
+    }
+    return 0;
+}
+
+int simple_yaml_visit_file(const char* filename,
+        SimpleYamlVisitCallback callback, void* data)
+{
+    errno = 0;
+    FILE *file_handle = fopen(filename, "r");
+    if (file_handle == NULL) {
+        if (errno==0) errno = EINVAL;
+        perror("Error opening file");
+        return errno;
+    }
+    Visitor v;
+    int rc = __visitor_init(&v, callback, data);
+    if (rc == 0) {
+        yaml_parser_set_input_file(&v.parser, file_handle);
+        rc = __visitor_run(&v);
+    }
+    fclose(file_handle);
+    return rc;
+}
+
+int simple_yaml_visit_buffer(const char* buffer, size_t length,
+        SimpleYamlVisitCallback callback, void* data)
+{
+    errno = 0;
+    Visitor v;
+    int rc = __visitor_init(&v, callback, data);
+    if (rc) return rc;
+    if (buffer == NULL) buffer = "";
+    yaml_parser_set_input_string(
+            &v.parser, (const unsigned char*)buffer, length);
+    return __visitor_run(&v);
+}
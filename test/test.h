@@ -0,0 +1,49 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+#ifndef SIMPLE_YAML_TEST_H
+#define SIMPLE_YAML_TEST_H
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simple_yaml.h>
+
+
+/* Checks report the failing expression and continue, a test program
+returns test_result() (non-zero when any check failed). */
+static int test_failures;
+
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+        test_failures++; \
+    } \
+} while (0)
+
+static __inline__ int test_result(const char* name)
+{
+    printf("%-16s %s\n", name, test_failures ? "FAILED" : "ok");
+    return test_failures ? 1 : 0;
+}
+
+static __inline__ HashList* test_parse(const char* yaml,
+        const SimpleYamlOptions* options)
+{
+    return simple_yaml_parse_buffer(yaml, strlen(yaml), NULL, options);
+}
+
+static __inline__ void test_destroy(HashList* doc_list)
+{
+    if (doc_list == NULL) return;
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        simple_yaml_destroy_node(hashlist_get_at(doc_list, i));
+    }
+    hashlist_destroy(doc_list);
+    free(doc_list);
+}
+
+#endif /* SIMPLE_YAML_TEST_H */
@@ -0,0 +1,118 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Anchors and aliases, with duplicate keys and merge keys (each document is
+parsed with and without an arena). */
+
+#include <errno.h>
+#include "test.h"
+
+
+static int64_t __int(SimpleYamlNode* doc, const char* path)
+{
+    int64_t value = -1;
+    SimpleYamlNode* node = simple_yaml_find_node(doc, path);
+    if (node == NULL || simple_yaml_get_value_as_int64(node, &value)) return -1;
+    return value;
+}
+
+static SimpleYamlNode* __parse_one(
+        const char* yaml, bool use_arena, HashList** doc_list)
+{
+    SimpleYamlOptions options = { .use_arena = use_arena };
+    *doc_list = test_parse(yaml, &options);
+    CHECK(*doc_list && hashlist_length(*doc_list) == 1);
+    if (*doc_list == NULL) return NULL;
+    return hashlist_get_at(*doc_list, 0);
+}
+
+/* A duplicate key replaces the anchored node, the alias still resolves. */
+static void test_duplicate_key(bool use_arena)
+{
+    HashList* doc_list;
+    SimpleYamlNode* doc = __parse_one(
+            "a: &x {b: 1}\na: 2\nc: *x\n", use_arena, &doc_list);
+    CHECK(__int(doc, "a") == 2);
+    CHECK(__int(doc, "c/b") == 1);
+    test_destroy(doc_list);
+
+    doc = __parse_one("a: &x 1\na: 2\nb: *x\n", use_arena, &doc_list);
+    CHECK(__int(doc, "a") == 2);
+    CHECK(__int(doc, "b") == 1);
+    test_destroy(doc_list);
+
+    /* The anchor is within the replaced node. */
+    doc = __parse_one("a: {b: &x 1}\na: 2\nc: *x\n", use_arena, &doc_list);
+    CHECK(__int(doc, "a") == 2);
+    CHECK(__int(doc, "c") == 1);
+    test_destroy(doc_list);
+
+    /* The alias is replaced, the anchored node remains. */
+    doc = __parse_one("a: &x [1, 2]\nb: *x\nb: 3\nc: *x\n", use_arena, &doc_list);
+    CHECK(__int(doc, "a/1") == 2);
+    CHECK(__int(doc, "b") == 3);
+    CHECK(__int(doc, "c/0") == 1);
+    test_destroy(doc_list);
+
+    /* A redefined anchor. */
+    doc = __parse_one("a: &x 1\nb: &x 2\na: 3\nc: *x\n", use_arena, &doc_list);
+    CHECK(__int(doc, "a") == 3);
+    CHECK(__int(doc, "c") == 2);
+    test_destroy(doc_list);
+
+    /* The anchored document root. */
+    doc = __parse_one("&r {a: 1}\n", use_arena, &doc_list);
+    CHECK(__int(doc, "a") == 1);
+    test_destroy(doc_list);
+}
+
+static void test_merge(bool use_arena)
+{
+    HashList* doc_list;
+    SimpleYamlNode* doc = __parse_one(
+            "base: &b {x: 1, y: 2}\n"
+            "m:\n  <<: *b\n  y: 3\n"
+            "n:\n  <<: [{z: 4}, *b]\n"
+            "base: 5\n",
+            use_arena, &doc_list);
+    CHECK(__int(doc, "base") == 5);
+    CHECK(__int(doc, "m/x") == 1);
+    CHECK(__int(doc, "m/y") == 3);
+    CHECK(__int(doc, "n/x") == 1);
+    CHECK(__int(doc, "n/z") == 4);
+    test_destroy(doc_list);
+}
+
+/* Errors release the anchors of the partly parsed document. */
+static void test_errors(bool use_arena)
+{
+    SimpleYamlOptions options = { .use_arena = use_arena };
+    HashList* doc_list = test_parse("a: &x {b: 1}\na: 2\nc: *y\n", &options);
+    CHECK(doc_list == NULL && errno == EINVAL);
+    test_destroy(doc_list);
+
+    /* Anchors do not extend to the following documents. */
+    doc_list = test_parse("--- &x {b: 1}\n--- *x\n", &options);
+    CHECK(doc_list && hashlist_length(doc_list) == 1);
+    CHECK(errno == EINVAL);
+    test_destroy(doc_list);
+
+    options.alias_limit = 4;
+    doc_list = test_parse(
+            "a: &x [1, 2, 3]\nb: [*x, *x]\n", &options);
+    CHECK(doc_list == NULL && errno == EOVERFLOW);
+    test_destroy(doc_list);
+}
+
+
+int main(void)
+{
+    for (int use_arena = 0; use_arena < 2; use_arena++) {
+        test_duplicate_key(use_arena);
+        test_merge(use_arena);
+        test_errors(use_arena);
+    }
+    return test_result("anchors");
+}
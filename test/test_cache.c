@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Cache files, reused when fresh, rebuilt when the source changed or the
+cache is corrupt (files are written to a temporary directory). */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "test.h"
+
+
+static char source[256];
+static char cache_file[256];
+
+
+static void __write_file(const char* filename, const char* data, size_t length)
+{
+    FILE* f = fopen(filename, "w");
+    CHECK(f != NULL);
+    if (f == NULL) return;
+    CHECK(fwrite(data, 1, length, f) == length);
+    fclose(f);
+}
+
+/* Read a file, into a malloc'd (aligned) buffer. */
+static char* __read_file(const char* filename, size_t* length)
+{
+    *length = 0;
+    FILE* f = fopen(filename, "r");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = malloc(size > 0 ? size : 1);
+    if (data && fread(data, 1, size, f) == (size_t)size) {
+        *length = size;
+    }
+    fclose(f);
+    return data;
+}
+
+static void __set_mtime(const char* filename, time_t sec)
+{
+    struct timespec times[2] = { { sec, 0 }, { sec, 0 } };
+    CHECK(utimensat(AT_FDCWD, filename, times, 0) == 0);
+}
+
+/* Open the cache, check rebuilt and the value of "v". */
+static void __open(bool rebuilt, const char* value)
+{
+    SimpleYamlCache cache;
+    CHECK(simple_yaml_cache_open(&cache, source, cache_file, NULL) == 0);
+    CHECK(cache.rebuilt == rebuilt);
+    CHECK(cache.tape != NULL);
+    if (cache.tape) {
+        const char* v = simple_yaml_tape_value(cache.tape,
+                simple_yaml_tape_find(cache.tape,
+                        simple_yaml_tape_document(cache.tape, 0), "v"),
+                NULL);
+        CHECK(v && strcmp(v, value) == 0);
+    }
+    simple_yaml_cache_close(&cache);
+
+    /* The cache file is (now) valid. */
+    size_t length;
+    char* data = __read_file(cache_file, &length);
+    CHECK(data && simple_yaml_cache_validate(data, length) == 0);
+    free(data);
+}
+
+static void test_fresh(void)
+{
+    __write_file(source, "v: one\n", 7);
+    __set_mtime(source, 1000000);
+    __open(true, "one");
+    __open(false, "one");
+    /* Touched, the same content (found by hash). */
+    __set_mtime(source, 2000000);
+    __open(false, "one");
+    __open(false, "one");
+    /* Changed, with the same size and mtime. */
+    __write_file(source, "v: two\n", 7);
+    __set_mtime(source, 2000000);
+    __open(false, "one");
+    /* Changed, with the same size. */
+    __set_mtime(source, 3000000);
+    __open(true, "two");
+    /* Changed size. */
+    __write_file(source, "v: three\n", 9);
+    __set_mtime(source, 3000000);
+    __open(true, "three");
+}
+
+static void test_corrupt(void)
+{
+    size_t length;
+    char* data = __read_file(cache_file, &length);
+    CHECK(data && length > 64);
+    if (data == NULL) return;
+    CHECK(simple_yaml_cache_validate(data, length) == 0);
+    CHECK(simple_yaml_cache_validate(data, 0) == EINVAL);
+    CHECK(simple_yaml_cache_validate(NULL, length) == EINVAL);
+
+    /* Each byte of the header, and the tape, changed. */
+    for (size_t i = 0; i < length; i++) {
+        data[i] ^= 0x10;
+        int rc = simple_yaml_cache_validate(data, length);
+        /* Except the source fields (size, mtime and hash, compared with
+        the source) and the reserved field of the header. */
+        if (i < 16 || (i >= 40 && i < 56) || i >= 64) CHECK(rc == EINVAL);
+        data[i] ^= 0x10;
+    }
+    /* A corrupt cache file is rebuilt. */
+    data[length - 2] ^= 0x10;
+    __write_file(cache_file, data, length);
+    __open(true, "three");
+    __write_file(cache_file, data, length - 8);
+    __open(true, "three");
+    __write_file(cache_file, data, 10);
+    __open(true, "three");
+    __write_file(cache_file, "", 0);
+    __open(true, "three");
+    free(data);
+}
+
+static void test_errors(const char* directory)
+{
+    /* A cache which can not be written, the parsed tape is still used. */
+    char missing[300];
+    snprintf(missing, sizeof(missing), "%s/missing/cache", directory);
+    SimpleYamlCache cache;
+    CHECK(simple_yaml_cache_open(&cache, source, missing, NULL) == 0);
+    CHECK(cache.rebuilt && cache.tape != NULL);
+    simple_yaml_cache_close(&cache);
+
+    /* A source which can not be parsed, or does not exist. */
+    __write_file(source, "v: [\n", 5);
+    CHECK(simple_yaml_cache_open(&cache, source, cache_file, NULL) != 0);
+    CHECK(cache.tape == NULL);
+    simple_yaml_cache_close(&cache);
+
+    /* A stream with a document which can not be parsed, the documents
+    before it are not cached. */
+    __write_file(source, "v: 1\n---\nb: [\n", 14);
+    unlink(cache_file);
+    for (int i = 0; i < 2; i++) {
+        CHECK(simple_yaml_cache_open(&cache, source, cache_file, NULL) != 0);
+        CHECK(cache.tape == NULL);
+        CHECK(access(cache_file, F_OK) == -1);
+        simple_yaml_cache_close(&cache);
+    }
+    unlink(source);
+    CHECK(simple_yaml_cache_open(&cache, source, cache_file, NULL) == ENOENT);
+    simple_yaml_cache_close(&cache);
+}
+
+
+int main(void)
+{
+    char directory[] = "/tmp/test_cache.XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("Error creating directory");
+        return 1;
+    }
+    snprintf(source, sizeof(source), "%s/source.yaml", directory);
+    snprintf(cache_file, sizeof(cache_file), "%s/source.cache", directory);
+    test_fresh();
+    test_corrupt();
+    test_errors(directory);
+    unlink(source);
+    unlink(cache_file);
+    rmdir(directory);
+    return test_result("cache");
+}
@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Emitted YAML, the exact text of small documents and a round trip (the
+emitted documents parse, and emit, as the same text). */
+
+#include "test.h"
+
+
+static char* __emit(const char* yaml, bool documents)
+{
+    HashList* doc_list = test_parse(yaml, NULL);
+    CHECK(doc_list && hashlist_length(doc_list));
+    if (doc_list == NULL || hashlist_length(doc_list) == 0) {
+        test_destroy(doc_list);
+        return NULL;
+    }
+    SimpleYamlBuffer buffer = { 0 };
+    int rc = documents ? simple_yaml_emit_documents_buffer(doc_list, &buffer)
+            : simple_yaml_emit_buffer(hashlist_get_at(doc_list, 0), &buffer);
+    CHECK(rc == 0);
+    test_destroy(doc_list);
+    return buffer.data;
+}
+
+static void __check_emit(const char* yaml, bool documents, const char* expect)
+{
+    char* data = __emit(yaml, documents);
+    if (data == NULL || strcmp(data, expect)) {
+        fprintf(stderr, "emit \"%s\": \"%s\", expected \"%s\"\n",
+                yaml, data ? data : "(null)", expect);
+    }
+    CHECK(data && strcmp(data, expect) == 0);
+    free(data);
+}
+
+static void test_empty(void)
+{
+    __check_emit("{}", false, "{}\n");
+    __check_emit("[]", false, "[]\n");
+    __check_emit("{}", true, "--- {}\n");
+    __check_emit("[]", true, "--- []\n");
+    __check_emit("a: {}\nb: []\n", false, "a: {}\nb: []\n");
+    __check_emit("- {}\n- []\n", false, "- {}\n- []\n");
+    __check_emit("a: {}\n", true, "---\na: {}\n");
+}
+
+static void test_nested(void)
+{
+    __check_emit("a: 1\nb: [x, {c: 2, d: [3]}]\n", false,
+            "a: 1\nb:\n  - x\n  - c: 2\n    d:\n      - 3\n");
+    __check_emit("- - 1\n  - 2\n- k: v\n", false,
+            "- - 1\n  - 2\n- k: v\n");
+    __check_emit("a: \"8080\"\nb: ''\nc:\n", false,
+            "a: \"8080\"\nb: \"\"\nc:\n");
+}
+
+/* The emitted text parses to documents which emit the same text. */
+static void test_round_trip(void)
+{
+    const char* streams[] = {
+        "{}",
+        "[]",
+        "--- {}\n--- []\n---\na: 1\n",
+        "a: &x {b: [1, {}], c: []}\nd: *x\ne: \"a: b\"\nf: 'x # y'\n",
+        "- {}\n- [[], {}]\n- - - 1\n",
+    };
+    for (size_t i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) {
+        char* first = __emit(streams[i], true);
+        char* second = first ? __emit(first, true) : NULL;
+        CHECK(first && second && strcmp(first, second) == 0);
+        free(first);
+        free(second);
+    }
+}
+
+
+int main(void)
+{
+    test_empty();
+    test_nested();
+    test_round_trip();
+    return test_result("emit");
+}
@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* HashMap set, get, remove and clear (with robin-hood displacement). */
+
+#include "test.h"
+
+
+#define TEST_KEYS   2000
+
+
+static void __key(char* buffer, size_t size, uint32_t i)
+{
+    snprintf(buffer, size, "key-%u", i);
+}
+
+static void test_set_get_remove(void)
+{
+    HashMap map;
+    CHECK(hashmap_init_alt(&map, 16, NULL) == HASHMAP_SUCCESS);
+    char key[32];
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        CHECK(hashmap_set(&map, key, (void*)(uintptr_t)(i + 1)) != NULL);
+    }
+    CHECK(map.used_nodes == TEST_KEYS);
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        CHECK(hashmap_get(&map, key) == (void*)(uintptr_t)(i + 1));
+    }
+
+    /* Remove every other key, the others remain reachable (backward shift
+    of displaced nodes). */
+    for (uint32_t i = 0; i < TEST_KEYS; i += 2) {
+        __key(key, sizeof(key), i);
+        CHECK(hashmap_remove(&map, key) == (void*)(uintptr_t)(i + 1));
+    }
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        void* expect = (i % 2) ? (void*)(uintptr_t)(i + 1) : NULL;
+        CHECK(hashmap_get(&map, key) == expect);
+    }
+
+    /* Reinsert with new values. */
+    for (uint32_t i = 0; i < TEST_KEYS; i += 2) {
+        __key(key, sizeof(key), i);
+        hashmap_set(&map, key, (void*)(uintptr_t)(i + 7));
+    }
+    for (uint32_t i = 0; i < TEST_KEYS; i += 2) {
+        __key(key, sizeof(key), i);
+        CHECK(hashmap_get(&map, key) == (void*)(uintptr_t)(i + 7));
+    }
+    CHECK(map.used_nodes == TEST_KEYS);
+    hashmap_destroy(&map);
+}
+
+static void test_clear(void)
+{
+    HashMap map;
+    CHECK(hashmap_init_alt(&map, 16, NULL) == HASHMAP_SUCCESS);
+    char key[32];
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        hashmap_set(&map, key, (void*)(uintptr_t)(i + 1));
+    }
+
+    /* A cleared map has no entries, and is reusable. */
+    hashmap_clear(&map);
+    CHECK(map.used_nodes == 0);
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        CHECK(hashmap_get(&map, key) == NULL);
+    }
+    for (uint32_t i = 0; i < TEST_KEYS; i += 3) {
+        __key(key, sizeof(key), i);
+        hashmap_set(&map, key, (void*)(uintptr_t)(i + 2));
+    }
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        void* expect = (i % 3) ? NULL : (void*)(uintptr_t)(i + 2);
+        CHECK(hashmap_get(&map, key) == expect);
+    }
+    hashmap_clear(&map);
+    hashmap_clear(&map);
+    CHECK(map.used_nodes == 0);
+    hashmap_destroy(&map);
+}
+
+/* Operations are counted while the calling thread has counters set. */
+static void test_counters(void)
+{
+    HashMap map;
+    CHECK(hashmap_init_alt(&map, 16, NULL) == HASHMAP_SUCCESS);
+    HashMapCounters counters = { 0 };
+    hashmap_set_counters(&counters);
+    char key[32];
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        hashmap_set(&map, key, (void*)(uintptr_t)(i + 1));
+    }
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        CHECK(hashmap_get(&map, key) == (void*)(uintptr_t)(i + 1));
+    }
+    CHECK(counters.lookups >= TEST_KEYS);
+    CHECK(counters.probes >= counters.lookups);
+    CHECK(counters.max_probe >= 1);
+
+    hashmap_set_counters(NULL);
+    HashMapCounters before = counters;
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        __key(key, sizeof(key), i);
+        CHECK(hashmap_get(&map, key) == (void*)(uintptr_t)(i + 1));
+    }
+    CHECK(memcmp(&before, &counters, sizeof(counters)) == 0);
+    hashmap_destroy(&map);
+}
+
+
+int main(void)
+{
+    test_set_get_remove();
+    test_clear();
+    test_counters();
+    return test_result("hashmap");
+}
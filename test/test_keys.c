@@ -0,0 +1,186 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Key interning, documents parsed with a table share its keys (compared by
+pointer), also when the table is used by several threads. */
+
+#include <pthread.h>
+#include "test.h"
+
+
+#define TEST_THREADS        8
+#define TEST_KEYS           2000
+
+
+static const char* keys_yaml =
+    "metadata: {name: web, labels: {app: web}}\n"
+    "spec: {ports: [{name: http, port: 80}]}\n";
+
+
+/* The name of the node at path, and its interned key in the table. */
+static const char* __name(SimpleYamlNode* doc, SimpleYamlKeys* keys,
+        const char* path)
+{
+    SimpleYamlNode* node = simple_yaml_find_node(doc, path);
+    CHECK(node && (node->flags & SIMPLE_YAML_NODE_NAME_INTERNED));
+    if (node == NULL) return NULL;
+    CHECK(node->name == simple_yaml_keys_find(keys, node->name));
+    return node->name;
+}
+
+static void test_documents(void)
+{
+    SimpleYamlKeys* keys = simple_yaml_keys_create();
+    CHECK(keys != NULL);
+    if (keys == NULL) return;
+    for (int use_arena = 0; use_arena < 2; use_arena++) {
+        SimpleYamlOptions options = { .keys = keys, .use_arena = use_arena };
+        HashList* first = test_parse(keys_yaml, &options);
+        HashList* second = test_parse(keys_yaml, &options);
+        CHECK(first && hashlist_length(first) == 1);
+        CHECK(second && hashlist_length(second) == 1);
+        if (first == NULL || second == NULL) break;
+        SimpleYamlNode* a = hashlist_get_at(first, 0);
+        SimpleYamlNode* b = hashlist_get_at(second, 0);
+        /* The same key, in each document and at different paths. */
+        CHECK(__name(a, keys, "metadata") == __name(b, keys, "metadata"));
+        CHECK(__name(a, keys, "metadata/name") == __name(b, keys,
+                "spec/ports/0/name"));
+        CHECK(__name(a, keys, "metadata/name") == __name(a, keys,
+                "spec/ports/0/name"));
+        CHECK(a->flags & SIMPLE_YAML_NODE_KEYS_INTERNED);
+        CHECK(simple_yaml_mapping_get(a, "spec")
+                == simple_yaml_find_node(a, "spec"));
+        test_destroy(first);
+        test_destroy(second);
+    }
+    /* metadata, name, labels, app, spec, ports, port. */
+    CHECK(simple_yaml_keys_count(keys) == 7);
+
+    /* Keys of a stream, and the stored hash and length. */
+    SimpleYamlOptions options = { .keys = keys };
+    HashList* doc_list = test_parse("---\nname: a\n---\nname: b\n", &options);
+    CHECK(doc_list && hashlist_length(doc_list) == 2);
+    if (doc_list && hashlist_length(doc_list) == 2) {
+        const char* name = __name(hashlist_get_at(doc_list, 0), keys, "name");
+        CHECK(name == __name(hashlist_get_at(doc_list, 1), keys, "name"));
+        CHECK(name && simple_yaml_keys_length(name) == 4);
+        CHECK(name && simple_yaml_keys_hash(name)
+                == hashmap_default_hash_length("name", 4));
+    }
+    test_destroy(doc_list);
+    CHECK(simple_yaml_keys_count(keys) == 7);
+    simple_yaml_keys_destroy(keys);
+}
+
+static void test_find(void)
+{
+    SimpleYamlKeys* keys = simple_yaml_keys_create();
+    CHECK(keys != NULL);
+    if (keys == NULL) return;
+    CHECK(simple_yaml_keys_find(keys, "unknown") == NULL);
+    CHECK(simple_yaml_keys_find(keys, "") == NULL);
+    const char* key = simple_yaml_keys_intern(keys, "metadata");
+    CHECK(key && strcmp(key, "metadata") == 0);
+    CHECK(simple_yaml_keys_find(keys, "metadata") == key);
+    CHECK(simple_yaml_keys_intern(keys, "metadata") == key);
+    /* A prefix, or an extension, of an interned key is unknown. */
+    CHECK(simple_yaml_keys_find(keys, "meta") == NULL);
+    CHECK(simple_yaml_keys_find(keys, "metadata2") == NULL);
+    /* Find does not intern. */
+    CHECK(simple_yaml_keys_count(keys) == 1);
+    const char* empty = simple_yaml_keys_intern(keys, "");
+    CHECK(empty && empty[0] == '\0' && simple_yaml_keys_length(empty) == 0);
+    CHECK(simple_yaml_keys_find(keys, "") == empty);
+    CHECK(simple_yaml_keys_count(keys) == 2);
+
+    /* The table grows, interned keys keep their address. */
+    const char* interned[TEST_KEYS];
+    char buffer[32];
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        snprintf(buffer, sizeof(buffer), "key_%u", i);
+        interned[i] = simple_yaml_keys_intern(keys, buffer);
+        CHECK(interned[i] && strcmp(interned[i], buffer) == 0);
+    }
+    CHECK(simple_yaml_keys_count(keys) == TEST_KEYS + 2);
+    for (uint32_t i = 0; i < TEST_KEYS; i++) {
+        snprintf(buffer, sizeof(buffer), "key_%u", i);
+        CHECK(simple_yaml_keys_find(keys, buffer) == interned[i]);
+    }
+    CHECK(simple_yaml_keys_find(keys, "metadata") == key);
+    CHECK(simple_yaml_keys_find(keys, "unknown") == NULL);
+    simple_yaml_keys_destroy(keys);
+}
+
+typedef struct Interner {
+    SimpleYamlKeys*     keys;
+    uint32_t            offset;     /* Keys are interned from here. */
+    pthread_t           thread;
+    const char*         interned[TEST_KEYS];
+    const char*         name;       /* Of the parsed documents. */
+    uint64_t            errors;
+} Interner;
+
+static void* __interner(void* data)
+{
+    Interner* t = data;
+    char buffer[32];
+    for (uint32_t n = 0; n < TEST_KEYS; n++) {
+        uint32_t i = (n + t->offset) % TEST_KEYS;
+        snprintf(buffer, sizeof(buffer), "key_%u", i);
+        t->interned[i] = simple_yaml_keys_intern(t->keys, buffer);
+        if (t->interned[i] == NULL || strcmp(t->interned[i], buffer)) {
+            t->errors++;
+        }
+        /* Documents are parsed with the table meanwhile. */
+        if (n % 256) continue;
+        SimpleYamlOptions options = { .keys = t->keys };
+        HashList* doc_list = test_parse(keys_yaml, &options);
+        SimpleYamlNode* node = doc_list ? simple_yaml_find_node(
+                hashlist_get_at(doc_list, 0), "metadata/name") : NULL;
+        if (node == NULL || (t->name && node->name != t->name)) t->errors++;
+        if (node) t->name = node->name;
+        test_destroy(doc_list);
+    }
+    return NULL;
+}
+
+/* Threads intern the same keys (in a different order), each key is interned
+once. */
+static void test_threads(void)
+{
+    SimpleYamlKeys* keys = simple_yaml_keys_create();
+    CHECK(keys != NULL);
+    if (keys == NULL) return;
+    static Interner interners[TEST_THREADS];
+    for (uint32_t i = 0; i < TEST_THREADS; i++) {
+        interners[i] = (Interner){ .keys = keys,
+                .offset = i * (TEST_KEYS / TEST_THREADS) };
+        CHECK(pthread_create(&interners[i].thread, NULL, __interner,
+                &interners[i]) == 0);
+    }
+    for (uint32_t i = 0; i < TEST_THREADS; i++) {
+        pthread_join(interners[i].thread, NULL);
+        CHECK(interners[i].errors == 0);
+    }
+    for (uint32_t i = 1; i < TEST_THREADS; i++) {
+        CHECK(memcmp(interners[i].interned, interners[0].interned,
+                sizeof(interners[0].interned)) == 0);
+        CHECK(interners[i].name == interners[0].name);
+    }
+    CHECK(interners[0].name == simple_yaml_keys_find(keys, "name"));
+    /* The keys, and those of the parsed documents. */
+    CHECK(simple_yaml_keys_count(keys) == TEST_KEYS + 7);
+    simple_yaml_keys_destroy(keys);
+}
+
+
+int main(void)
+{
+    test_documents();
+    test_find();
+    test_threads();
+    return test_result("keys");
+}
@@ -0,0 +1,184 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Parallel parsing, the documents (and errors) of a stream parsed with
+several threads are those of a serial parse. Also the split of a stream at
+its document start markers. */
+
+#include <errno.h>
+#include <simple_yaml_internal.h>
+#include "test.h"
+
+
+#define TEST_DOCUMENTS      64
+
+
+/* Documents with "---" which are not document start markers. */
+static const char* document_yaml[] = {
+    "kind: Service\nmetadata: {name: web}\n",
+    "text: |\n  ---\n  --- not a marker\n  %not a directive\nnext: 1\n",
+    "quoted: \"--- x\"\nsingle: '---'\nfolded: >\n  a\n  ---\n",
+    "---x: 1\n\"---\": 2\n# ---\nlist:\n  - ---a\n  - \"b\n    ---\"\n",
+    "- 1\n- [2, 3]\n- {a: &x 4, b: *x}\n",
+    "scalar\n",
+};
+#define TEST_DOCUMENT_KINDS (sizeof(document_yaml) / sizeof(document_yaml[0]))
+
+
+/* A stream of count documents, with (or without) a leading marker. */
+static char* __stream(const char* prefix, uint32_t count, bool leading)
+{
+    size_t length = strlen(prefix) + 1;
+    for (uint32_t i = 0; i < count; i++) {
+        length += strlen(document_yaml[i % TEST_DOCUMENT_KINDS]) + 4;
+    }
+    char* stream = malloc(length);
+    char* p = stream;
+    p += sprintf(p, "%s", prefix);
+    for (uint32_t i = 0; i < count; i++) {
+        p += sprintf(p, "%s%s", (i || leading) ? "---\n" : "",
+                document_yaml[i % TEST_DOCUMENT_KINDS]);
+    }
+    return stream;
+}
+
+/* Parse, returns the emitted documents, the document count and errno. */
+static char* __parse(const char* yaml, uint32_t threads, uint32_t* count,
+        int* error)
+{
+    SimpleYamlOptions options = { .threads = threads };
+    HashList* doc_list = test_parse(yaml, &options);
+    *error = errno;
+    *count = doc_list ? hashlist_length(doc_list) : 0;
+    SimpleYamlBuffer buffer = { 0 };
+    if (doc_list) {
+        CHECK(simple_yaml_emit_documents_buffer(doc_list, &buffer) == 0);
+    }
+    test_destroy(doc_list);
+    return buffer.data;
+}
+
+/* The stream parsed with each number of threads, compared with a serial
+parse. */
+static void __compare(const char* yaml, uint32_t expect_count, bool failed)
+{
+    uint32_t count;
+    int error;
+    char* serial = __parse(yaml, 0, &count, &error);
+    CHECK(count == expect_count);
+    CHECK(failed ? error != 0 : error == 0);
+    static const uint32_t threads[] = { 1, 2, 3, 4, 8, 16 };
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        uint32_t parallel_count;
+        int parallel_error;
+        char* parallel = __parse(yaml, threads[i], &parallel_count,
+                &parallel_error);
+        if (parallel_count != count || (serial && parallel
+                && strcmp(serial, parallel))) {
+            fprintf(stderr, "parallel (%u threads): %u documents, "
+                    "expected %u\n", threads[i], parallel_count, count);
+        }
+        CHECK(parallel_count == count);
+        CHECK((parallel_error != 0) == (error != 0));
+        CHECK((serial == NULL) == (parallel == NULL));
+        CHECK(serial == NULL || parallel == NULL
+                || strcmp(serial, parallel) == 0);
+        free(parallel);
+    }
+    free(serial);
+}
+
+static void test_documents(void)
+{
+    for (int leading = 0; leading < 2; leading++) {
+        for (uint32_t count = 1; count <= TEST_DOCUMENTS; count *= 4) {
+            char* stream = __stream("", count, leading);
+            __compare(stream, count, false);
+            free(stream);
+        }
+    }
+    /* Explicit document ends, and empty documents. */
+    __compare("a: 1\n...\n---\nb: 2\n...\n--- c\n---\n---\nd: 4\n", 5, false);
+}
+
+static void test_directives(void)
+{
+    /* A stream with directives is parsed serially. */
+    char* stream = __stream("%YAML 1.1\n", TEST_DOCUMENTS, true);
+    __compare(stream, TEST_DOCUMENTS, false);
+    free(stream);
+    stream = __stream("a: 1\n...\n%TAG !e! tag:example.com,2000:\n# tags\n"
+            "---\nb: !e!x 2\n", TEST_DOCUMENTS, true);
+    __compare(stream, TEST_DOCUMENTS + 2, false);
+    free(stream);
+    /* A "%" line in a quoted scalar, not a directive. */
+    stream = __stream("---\nquoted: \"a\n%b\n  c\"\n", TEST_DOCUMENTS, true);
+    __compare(stream, TEST_DOCUMENTS + 1, false);
+    free(stream);
+}
+
+/* Documents up to the first document which can not be parsed. */
+static void test_errors(void)
+{
+    char* stream = __stream("", TEST_DOCUMENTS, true);
+    char* error = malloc(strlen(stream) * 2 + 32);
+    sprintf(error, "%s---\nv: [\n%s", stream, stream);
+    __compare(error, TEST_DOCUMENTS, true);
+    sprintf(error, "---\nv: [\n%s", stream);
+    __compare(error, 0, true);
+    free(error);
+    free(stream);
+}
+
+/* The split points of a stream. */
+static void __check_split(const char* yaml, const char* expect)
+{
+    const char* end = yaml + strlen(yaml);
+    char offsets[256] = "";
+    size_t n = 0;
+    for (const char* p = yaml; p && p < end; ) {
+        p = simple_yaml_split_next(p, end);
+        if (p == NULL) {
+            n += snprintf(offsets + n, sizeof(offsets) - n, "serial");
+        } else if (p < end) {
+            n += snprintf(offsets + n, sizeof(offsets) - n, "%zu ",
+                    (size_t)(p - yaml));
+        }
+    }
+    if (strcmp(offsets, expect)) {
+        fprintf(stderr, "split \"%s\": \"%s\", expected \"%s\"\n",
+                yaml, offsets, expect);
+    }
+    CHECK(strcmp(offsets, expect) == 0);
+}
+
+static void test_split(void)
+{
+    __check_split("", "");
+    __check_split("a: 1\n", "");
+    __check_split("---\na: 1\n", "");
+    __check_split("a: 1\n---\nb: 2\n--- c\n---", "5 14 20 ");
+    __check_split("a: |\n  ---\n---x: 1\n--\n \"---\"\n", "");
+    /* Directives, before a marker. */
+    __check_split("%YAML 1.1\n---\na: 1\n", "serial");
+    __check_split("a: 1\n---\nb: 2\n...\n%TAG ! x:\n\n# c\n---\nc\n",
+            "5 serial");
+    /* A "%" line which is not a directive. */
+    __check_split("--- \"a\n%b\n  c\"\n---\nd\n", "15 ");
+    __check_split("a: 1\n%b\n", "");
+    CHECK(simple_yaml_split_encoding("\xfe\xff", 2) == false);
+    CHECK(simple_yaml_split_encoding("a\0", 2) == false);
+    CHECK(simple_yaml_split_encoding("a: 1\n", 5) == true);
+}
+
+
+int main(void)
+{
+    test_split();
+    test_documents();
+    test_directives();
+    test_errors();
+    return test_result("parallel");
+}
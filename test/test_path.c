@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Paths, exact paths with sequence indexes, "*" and "**" wildcards (at the
+start, middle and end of a path) and matches through merge keys. The
+matches are compared as a list of their values. */
+
+#include "test.h"
+
+
+static const char* service_yaml =
+    "kind: Service\n"
+    "metadata:\n"
+    "  name: web\n"
+    "  labels: {app: web, name: label}\n"
+    "spec:\n"
+    "  ports:\n"
+    "    - {name: http, port: 80}\n"
+    "    - {name: https, port: 443}\n"
+    "  template:\n"
+    "    spec:\n"
+    "      containers:\n"
+    "        - {name: c1, image: i1}\n"
+    "        - {name: c2, image: i2}\n";
+
+static const char* merge_yaml =
+    "base: &base {a: 1, b: 2}\n"
+    "extra: &extra {c: 3, b: 20}\n"
+    "m1: {<<: *base, b: 5}\n"
+    "m2: {<<: [*base, *extra], d: 4}\n"
+    "m3:\n"
+    "  <<: {x: 9}\n"
+    "  y: 8\n"
+    "m4: {<<: *extra, inner: {<<: *base}}\n";
+
+
+/* Scalars as their value, collections as "{name" or "[name". */
+static void __format(char* buffer, size_t size, SimpleYamlNode* node)
+{
+    switch (node->node_type) {
+        case YAML_SCALAR_NODE:
+            snprintf(buffer, size, "%.*s", (int)node->value_length, node->value);
+            break;
+        case YAML_MAPPING_NODE:
+            snprintf(buffer, size, "{%s", node->name ? node->name : "");
+            break;
+        case YAML_SEQUENCE_NODE:
+            snprintf(buffer, size, "[%s", node->name ? node->name : "");
+            break;
+        default:
+            snprintf(buffer, size, "~");
+            break;
+    }
+}
+
+typedef struct Matches {
+    char        text[512];
+    size_t      length;
+    uint32_t    stop;       /* Stop after this many matches (0 for all). */
+    uint32_t    count;
+} Matches;
+
+static int __add_match(SimpleYamlNode* node, void* data)
+{
+    Matches* m = data;
+    char value[64];
+    __format(value, sizeof(value), node);
+    m->length += snprintf(m->text + m->length, sizeof(m->text) - m->length,
+            "%s%s", m->count ? " " : "", value);
+    m->count++;
+    return m->stop && m->count == m->stop;
+}
+
+static void __check_path(SimpleYamlNode* doc, const char* path,
+        const char* expect)
+{
+    SimpleYamlPath* compiled = simple_yaml_path_compile(path);
+    CHECK(compiled != NULL);
+    if (compiled == NULL) return;
+    Matches m = { .length = 0 };
+    uint32_t count = simple_yaml_match_path(doc, compiled, __add_match, &m);
+    if (strcmp(m.text, expect)) {
+        fprintf(stderr, "path \"%s\": \"%s\", expected \"%s\"\n",
+                path, m.text, expect);
+    }
+    CHECK(strcmp(m.text, expect) == 0);
+    CHECK(count == m.count);
+
+    /* The same matches, with find_all, and the first with find_node. */
+    HashList results;
+    hashlist_init(&results);
+    CHECK(simple_yaml_find_all(doc, compiled, &results) == count);
+    CHECK(hashlist_length(&results) == count);
+    SimpleYamlNode* first = simple_yaml_find_node(doc, path);
+    CHECK(first == (count ? hashlist_get_at(&results, 0) : NULL));
+    CHECK(simple_yaml_find_node_path(doc, compiled) == first);
+    hashlist_destroy(&results);
+    simple_yaml_path_destroy(compiled);
+}
+
+static SimpleYamlNode* __document(HashList** doc_list, const char* yaml)
+{
+    *doc_list = test_parse(yaml, NULL);
+    CHECK(*doc_list && hashlist_length(*doc_list) == 1);
+    if (*doc_list == NULL || hashlist_length(*doc_list) == 0) return NULL;
+    return hashlist_get_at(*doc_list, 0);
+}
+
+static void test_exact(void)
+{
+    HashList* doc_list;
+    SimpleYamlNode* doc = __document(&doc_list, service_yaml);
+    if (doc == NULL) return;
+    __check_path(doc, "kind", "Service");
+    __check_path(doc, "/metadata//name/", "web");
+    __check_path(doc, "spec/ports/1/port", "443");
+    __check_path(doc, "spec/ports/0", "{");
+    __check_path(doc, "spec/template/spec/containers/1/image", "i2");
+    __check_path(doc, "", "{");
+    /* No match. */
+    __check_path(doc, "spec/ports/2", "");
+    __check_path(doc, "spec/ports/name", "");
+    __check_path(doc, "spec/ports/-1", "");
+    __check_path(doc, "kind/name", "");
+    __check_path(doc, "missing", "");
+    test_destroy(doc_list);
+}
+
+static void test_wildcard(void)
+{
+    HashList* doc_list;
+    SimpleYamlNode* doc = __document(&doc_list, service_yaml);
+    if (doc == NULL) return;
+    /* "*" in the middle, at the end, and at the start. */
+    __check_path(doc, "spec/ports/*/port", "80 443");
+    __check_path(doc, "spec/*/*/name", "http https");
+    __check_path(doc, "metadata/labels/*", "web label");
+    __check_path(doc, "spec/ports/*", "{ {");
+    __check_path(doc, "*/name", "web");
+    __check_path(doc, "*/*/*/port", "80 443");
+    __check_path(doc, "*", "Service {metadata {spec");
+    /* "**" at the start, in the middle, and at the end. */
+    __check_path(doc, "**/name", "web label http https c1 c2");
+    __check_path(doc, "**/port", "80 443");
+    __check_path(doc, "**/spec/containers/*/image", "i1 i2");
+    __check_path(doc, "spec/**/image", "i1 i2");
+    __check_path(doc, "spec/**/spec/**/name", "c1 c2");
+    __check_path(doc, "metadata/**", "{metadata web {labels web label");
+    __check_path(doc, "spec/ports/**", "[ports { http 80 { https 443");
+    __check_path(doc, "**/**/port", "80 443");
+    __check_path(doc, "**/ports/**/port", "80 443");
+    __check_path(doc, "**/*/port", "80 443");
+    __check_path(doc, "**/missing", "");
+    __check_path(doc, "metadata/name/**", "web");
+
+    /* Every node. */
+    SimpleYamlPath* all = simple_yaml_path_compile("**");
+    CHECK(simple_yaml_match_path(doc, all, NULL, NULL) == 24);
+    simple_yaml_path_destroy(all);
+
+    /* The callback stops the search. */
+    SimpleYamlPath* path = simple_yaml_path_compile("**/name");
+    Matches m = { .stop = 2 };
+    CHECK(simple_yaml_match_path(doc, path, __add_match, &m) == 2);
+    CHECK(strcmp(m.text, "web label") == 0);
+    simple_yaml_path_destroy(path);
+    test_destroy(doc_list);
+}
+
+/* A node which several "**" segments (or key segments after them) reach is
+matched once. */
+static void test_unique(void)
+{
+    HashList* doc_list;
+    SimpleYamlNode* doc = __document(&doc_list,
+            "a: {a: {b: 1, a: {b: 2}}, b: 3}\nx: {y: {b: 4}}\n");
+    if (doc == NULL) return;
+    __check_path(doc, "**/a/**/b", "1 2 3");
+    __check_path(doc, "**/a/**/a/**/b", "1 2");
+    __check_path(doc, "**/*/**/b", "1 2 3 4");
+    __check_path(doc, "**/a/a/b", "1 2");
+    __check_path(doc, "**/a/**", "{a {a 1 {a 2 3");
+    test_destroy(doc_list);
+
+    /* A long path (more states than a word). */
+    char yaml[4096] = "";
+    char path[1024] = "";
+    size_t n = 0, k = 0;
+    for (int i = 0; i < 70; i++) {
+        n += sprintf(yaml + n, "%*sk%d:\n", i, "", i);
+        k += sprintf(path + k, i == 35 ? "**/" : "k%d/", i);
+    }
+    sprintf(yaml + n, "%*sv: end\n", 70, "");
+    sprintf(path + k, "v");
+    doc = __document(&doc_list, yaml);
+    if (doc == NULL) return;
+    __check_path(doc, path, "end");
+    __check_path(doc, "**/k69/v", "end");
+    test_destroy(doc_list);
+}
+
+/* Keys of merged mappings match (in merge order) unless overridden. */
+static void test_merge(void)
+{
+    HashList* doc_list;
+    SimpleYamlNode* doc = __document(&doc_list, merge_yaml);
+    if (doc == NULL) return;
+    __check_path(doc, "m1/a", "1");
+    __check_path(doc, "m1/b", "5");
+    __check_path(doc, "m2/b", "2");
+    __check_path(doc, "m2/c", "3");
+    __check_path(doc, "m3/x", "9");
+    __check_path(doc, "m4/inner/a", "1");
+    __check_path(doc, "m1/*", "5 1");
+    __check_path(doc, "m2/*", "4 1 2 3");
+    __check_path(doc, "m3/*", "8 9");
+    __check_path(doc, "*/b", "2 20 5 2 20");
+    __check_path(doc, "m4/**", "{m4 {inner 1 2 3 20");
+    __check_path(doc, "**/c", "3 3 3");
+    __check_path(doc, "m2/<<", "[<<");
+    test_destroy(doc_list);
+}
+
+
+int main(void)
+{
+    test_exact();
+    test_wildcard();
+    test_unique();
+    test_merge();
+    return test_result("path");
+}
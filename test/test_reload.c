@@ -0,0 +1,157 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Reloads of a stream, the reported changes and the reused documents. Each
+stream is a list of single letter documents ("v: a"), upper case letters
+are edited versions of the lower case documents. */
+
+#include <errno.h>
+#include "test.h"
+
+
+typedef struct Reloader {
+    SimpleYamlReload    reload;
+    HashList*           doc_list;
+    SimpleYamlOptions   options;
+} Reloader;
+
+/* The stream of documents "v: <c>" for each character of values. */
+static char* __stream(const char* values)
+{
+    size_t length = strlen(values);
+    char* stream = malloc(length * 12 + 1);
+    char* p = stream;
+    for (size_t i = 0; i < length; i++) {
+        if (values[i] == '!') {
+            p += sprintf(p, "---\nv: [\n");     /* Can not be parsed. */
+        } else {
+            p += sprintf(p, "---\nv: %c\n", values[i]);
+        }
+    }
+    *p = '\0';
+    return stream;
+}
+
+static void __format(char* buffer, size_t size, const uint32_t* indexes,
+        const uint32_t* previous, uint32_t count)
+{
+    size_t n = 0;
+    buffer[0] = '\0';
+    for (uint32_t i = 0; i < count && n < size; i++) {
+        if (previous) {
+            n += snprintf(buffer + n, size - n, "%s%u<-%u", i ? " " : "",
+                    indexes[i], previous[i]);
+        } else {
+            n += snprintf(buffer + n, size - n, "%s%u", i ? " " : "",
+                    indexes[i]);
+        }
+    }
+}
+
+/* Reload values, and check the changes and the number of reused documents
+(the documents of the previous doc_list which are also in the new one). */
+static void __reload(Reloader* r, const char* values, const char* replaced,
+        const char* added, const char* removed, uint32_t reused)
+{
+    char* stream = __stream(values);
+    HashList* previous = r->doc_list;
+    HashList* doc_list = simple_yaml_reload_buffer(
+            &r->reload, previous, stream, strlen(stream), &r->options);
+    free(stream);
+    CHECK(doc_list != NULL);
+    if (doc_list == NULL) return;
+
+    char text[3][256];
+    __format(text[0], sizeof(text[0]), r->reload.replaced,
+            r->reload.replaced_previous, r->reload.replaced_count);
+    __format(text[1], sizeof(text[1]), r->reload.added, NULL,
+            r->reload.added_count);
+    __format(text[2], sizeof(text[2]), r->reload.removed, NULL,
+            r->reload.removed_count);
+    if (strcmp(text[0], replaced) || strcmp(text[1], added)
+            || strcmp(text[2], removed) || r->reload.reused != reused) {
+        fprintf(stderr, "reload %s: replaced [%s] added [%s] removed [%s] "
+                "reused %u\n", values, text[0], text[1], text[2],
+                r->reload.reused);
+    }
+    CHECK(strcmp(text[0], replaced) == 0);
+    CHECK(strcmp(text[1], added) == 0);
+    CHECK(strcmp(text[2], removed) == 0);
+    CHECK(r->reload.reused == reused);
+
+    /* The documents have the values, reused documents are shared. */
+    CHECK(hashlist_length(doc_list) == strlen(values));
+    uint32_t shared = 0;
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        SimpleYamlNode* doc = hashlist_get_at(doc_list, i);
+        SimpleYamlNode* v = simple_yaml_find_node(doc, "v");
+        CHECK(v && v->value_length == 1 && v->value[0] == values[i]);
+        for (uint32_t j = 0; previous && j < hashlist_length(previous); j++) {
+            if (hashlist_get_at(previous, j) == doc) shared++;
+        }
+    }
+    CHECK(shared == reused);
+    test_destroy(previous);
+    r->doc_list = doc_list;
+}
+
+static void __release(Reloader* r)
+{
+    test_destroy(r->doc_list);
+    simple_yaml_reload_release(&r->reload);
+    memset(r, 0, sizeof(Reloader));
+}
+
+static void test_changes(bool use_arena)
+{
+    Reloader r = { .options.use_arena = use_arena };
+    __reload(&r, "abc", "", "0 1 2", "", 0);
+    __reload(&r, "abc", "", "", "", 3);
+    /* Edited, and appended. */
+    __reload(&r, "aBcd", "1<-1", "3", "", 2);
+    /* Inserted, removed. */
+    __reload(&r, "axBcd", "", "1", "", 4);
+    __reload(&r, "aBd", "", "", "1 3", 3);
+    /* Edited at both ends. */
+    __reload(&r, "ABD", "0<-0 2<-2", "", "", 1);
+    /* Moved, the longest run in order is reused. */
+    __reload(&r, "BDA", "", "2", "0", 2);
+    __reload(&r, "efgBDA", "", "0 1 2", "", 3);
+    __reload(&r, "eAfgBD", "", "1", "5", 5);
+    /* Duplicates are matched in order. */
+    __reload(&r, "aaaa", "0<-0 1<-1 2<-2 3<-3", "", "4 5", 0);
+    __reload(&r, "aaba", "2<-2", "", "", 3);
+    __reload(&r, "aa", "", "", "2 3", 2);
+    __release(&r);
+}
+
+/* A stream which can not be parsed leaves the reload unchanged. */
+static void test_errors(void)
+{
+    Reloader r = { 0 };
+    __reload(&r, "abc", "", "0 1 2", "", 0);
+    char* stream = __stream("a!c");
+    CHECK(simple_yaml_reload_buffer(&r.reload, r.doc_list, stream,
+            strlen(stream), NULL) == NULL);
+    CHECK(errno != 0);
+    free(stream);
+    __reload(&r, "abd", "2<-2", "", "", 2);
+    __release(&r);
+
+    /* Documents not from the last reload are not reused. */
+    HashList* other = test_parse("v: a\n---\nv: b\n", NULL);
+    r.doc_list = other;
+    __reload(&r, "ab", "0<-0 1<-1", "", "", 0);
+    __release(&r);
+}
+
+
+int main(void)
+{
+    test_changes(false);
+    test_changes(true);
+    test_errors();
+    return test_result("reload");
+}
@@ -0,0 +1,264 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Scalar resolution (core schema), with the edge cases of the int and
+float parsers, and the same values from a frozen tape. The test is run again
+with each number classifier (SIMPLE_YAML_SIMD=sse2 and none). */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "test.h"
+
+
+typedef struct ScalarCase {
+    const char*             value;
+    SimpleYamlScalarType    type;
+    int                     rc;     /* Of the int64 or double accessor. */
+    double                  real;   /* The expected value (as a double). */
+} ScalarCase;
+
+static const ScalarCase scalar_cases[] = {
+    { "0",                      SIMPLE_YAML_SCALAR_INT,     0,      0 },
+    { "-42",                    SIMPLE_YAML_SCALAR_INT,     0,      -42 },
+    { "+7",                     SIMPLE_YAML_SCALAR_INT,     0,      7 },
+    { "0x1F",                   SIMPLE_YAML_SCALAR_INT,     0,      31 },
+    { "0o17",                   SIMPLE_YAML_SCALAR_INT,     0,      15 },
+    { "9223372036854775807",    SIMPLE_YAML_SCALAR_INT,     0,      9223372036854775807.0 },
+    { "-9223372036854775808",   SIMPLE_YAML_SCALAR_INT,     0,      -9223372036854775808.0 },
+    { "9223372036854775808",    SIMPLE_YAML_SCALAR_INT,     ERANGE, 9223372036854775807.0 },
+    { "-9223372036854775809",   SIMPLE_YAML_SCALAR_INT,     ERANGE, -9223372036854775808.0 },
+    { "123456789012345678901234567890", SIMPLE_YAML_SCALAR_INT, ERANGE, 9223372036854775807.0 },
+    { "0xFFFFFFFFFFFFFFFFF",    SIMPLE_YAML_SCALAR_INT,     ERANGE, 9223372036854775807.0 },
+    /* Long integer parts, the int parse overflows before it fails. */
+    { "12345678901234567890.5", SIMPLE_YAML_SCALAR_FLOAT,   0,      12345678901234567890.5 },
+    { "123456789012345678901234567890.5", SIMPLE_YAML_SCALAR_FLOAT, 0, 123456789012345678901234567890.5 },
+    { "99999999999999999999e0", SIMPLE_YAML_SCALAR_FLOAT,   0,      99999999999999999999e0 },
+    { "1.5",                    SIMPLE_YAML_SCALAR_FLOAT,   0,      1.5 },
+    { "-.5e-3",                 SIMPLE_YAML_SCALAR_FLOAT,   0,      -.5e-3 },
+    { "1e400",                  SIMPLE_YAML_SCALAR_FLOAT,   ERANGE, INFINITY },
+    { "1e-400",                 SIMPLE_YAML_SCALAR_FLOAT,   0,      0 },
+    { "-.inf",                  SIMPLE_YAML_SCALAR_FLOAT,   0,      -INFINITY },
+    /* Floats which are not exact with a single multiply/divide (Clinger's
+    fast path), a mantissa above 2^53, more than 19 digits, or an exponent
+    beyond 10^22. */
+    { "9007199254740993.0",     SIMPLE_YAML_SCALAR_FLOAT,   0,      9007199254740993.0 },
+    { "0.12345678901234567891", SIMPLE_YAML_SCALAR_FLOAT,   0,      0.12345678901234567891 },
+    { "1e23",                   SIMPLE_YAML_SCALAR_FLOAT,   0,      1e23 },
+    { "1.5e-23",                SIMPLE_YAML_SCALAR_FLOAT,   0,      1.5e-23 },
+    { "123456789012345678e5",   SIMPLE_YAML_SCALAR_FLOAT,   0,      123456789012345678e5 },
+    { "4.9e-324",               SIMPLE_YAML_SCALAR_FLOAT,   0,      4.9e-324 },
+    { "12abc",                  SIMPLE_YAML_SCALAR_STRING,  EINVAL, 0 },
+    { "1.2.3",                  SIMPLE_YAML_SCALAR_STRING,  EINVAL, 0 },
+    { "123456789012345678901234567890x", SIMPLE_YAML_SCALAR_STRING, EINVAL, 0 },
+    { "~",                      SIMPLE_YAML_SCALAR_NULL,    EINVAL, 0 },
+    { "true",                   SIMPLE_YAML_SCALAR_BOOL,    EINVAL, 0 },
+};
+#define SCALAR_CASES (sizeof(scalar_cases) / sizeof(scalar_cases[0]))
+
+
+static void __check_node(const ScalarCase* c, SimpleYamlNode* node)
+{
+    CHECK(simple_yaml_get_scalar_type(node) == c->type);
+    double real = 0;
+    int rc = simple_yaml_get_value_as_double(node, &real);
+    if (rc != c->rc || (rc != EINVAL && real != c->real)) {
+        fprintf(stderr, "%s: rc %d, value %.17g\n", c->value, rc, real);
+    }
+    CHECK(rc == c->rc);
+    if (rc != EINVAL) CHECK(real == c->real);
+    if (c->type == SIMPLE_YAML_SCALAR_INT) {
+        int64_t integer = 0;
+        CHECK(simple_yaml_get_value_as_int64(node, &integer) == c->rc);
+        CHECK((double)integer == c->real);
+    }
+}
+
+static void __check_tape(const ScalarCase* c, const SimpleYamlTape* tape)
+{
+    SimpleYamlTapeRef ref = simple_yaml_tape_find(
+            tape, simple_yaml_tape_document(tape, 0), "v");
+    CHECK(simple_yaml_tape_scalar_type(tape, ref) == c->type);
+    double real = 0;
+    int rc = simple_yaml_tape_get_double(tape, ref, &real);
+    CHECK(rc == c->rc);
+    if (rc != EINVAL) CHECK(real == c->real);
+}
+
+static void test_scalars(bool resolve_scalars)
+{
+    SimpleYamlOptions options = { .resolve_scalars = resolve_scalars };
+    for (size_t i = 0; i < SCALAR_CASES; i++) {
+        const ScalarCase* c = &scalar_cases[i];
+        char yaml[128];
+        snprintf(yaml, sizeof(yaml), "v: %s\n", c->value);
+        HashList* doc_list = test_parse(yaml, &options);
+        CHECK(doc_list && hashlist_length(doc_list) == 1);
+        if (doc_list == NULL) continue;
+        SimpleYamlNode* node = simple_yaml_find_node(
+                hashlist_get_at(doc_list, 0), "v");
+        CHECK(node != NULL);
+        if (node) __check_node(c, node);
+
+        SimpleYamlTape* tape = simple_yaml_freeze(doc_list);
+        CHECK(tape != NULL);
+        if (tape) __check_tape(c, tape);
+        simple_yaml_tape_destroy(tape);
+        test_destroy(doc_list);
+    }
+}
+
+/* Scalars of the lengths at the vector boundaries of the classifiers (and
+past CLASSIFY_LEN), a prefix and suffix around a repeated character. Up to
+27 characters (19 digits) a number may take the fast path, the characters
+of the suffix are then classified past the first vector. */
+typedef struct LengthCase {
+    const char*             prefix;
+    char                    fill;
+    const char*             suffix;
+    SimpleYamlScalarType    type;
+} LengthCase;
+
+static const LengthCase length_cases[] = {
+    { "",       '1',    "",     SIMPLE_YAML_SCALAR_INT },
+    { "-",      '0',    "7",    SIMPLE_YAML_SCALAR_INT },
+    { "0.",     '0',    "5",    SIMPLE_YAML_SCALAR_FLOAT },
+    { "+1",     '0',    "e-3",  SIMPLE_YAML_SCALAR_FLOAT },
+    { "",       '2',    ".",    SIMPLE_YAML_SCALAR_FLOAT },
+    { ".",      '5',    "",     SIMPLE_YAML_SCALAR_FLOAT },
+    { "-",      '9',    "E+2",  SIMPLE_YAML_SCALAR_FLOAT },
+    { "-1.",    '2',    "e-12", SIMPLE_YAML_SCALAR_FLOAT },
+    { "1.5e",   '0',    "1",    SIMPLE_YAML_SCALAR_FLOAT },
+    { "",       '3',    "x",    SIMPLE_YAML_SCALAR_STRING },
+    { "",       '4',    "-",    SIMPLE_YAML_SCALAR_STRING },
+    { "1",      '0',    "e",    SIMPLE_YAML_SCALAR_STRING },
+    { "1.",     '2',    ".3",   SIMPLE_YAML_SCALAR_STRING },
+    { "x",      '6',    "",     SIMPLE_YAML_SCALAR_STRING },
+    /* Characters next to those of the classes. */
+    { "1",      '2',    ":3",   SIMPLE_YAML_SCALAR_STRING },
+    { "",       '0',    "/",    SIMPLE_YAML_SCALAR_STRING },
+    { "1",      '0',    "f1",   SIMPLE_YAML_SCALAR_STRING },
+    { "1",      '0',    ",5",   SIMPLE_YAML_SCALAR_STRING },
+};
+#define LENGTH_CASES (sizeof(length_cases) / sizeof(length_cases[0]))
+
+static const size_t lengths[] = {
+    15, 16, 17, 18, 19, 20, 21, 22, 27, 31, 32, 33, 63, 64, 65,
+};
+
+static void test_lengths(void)
+{
+    for (size_t i = 0; i < LENGTH_CASES; i++) {
+        const LengthCase* l = &length_cases[i];
+        for (size_t j = 0; j < sizeof(lengths) / sizeof(lengths[0]); j++) {
+            char value[80];
+            size_t prefix = strlen(l->prefix);
+            size_t n = lengths[j] - prefix - strlen(l->suffix);
+            memcpy(value, l->prefix, prefix);
+            memset(value + prefix, l->fill, n);
+            strcpy(value + prefix + n, l->suffix);
+
+            /* The expected value, with the C library. */
+            ScalarCase c = { value, l->type, EINVAL, 0 };
+            errno = 0;
+            if (l->type == SIMPLE_YAML_SCALAR_INT) {
+                c.real = (double)strtoll(value, NULL, 10);
+                c.rc = errno;
+            } else if (l->type == SIMPLE_YAML_SCALAR_FLOAT) {
+                c.real = strtod(value, NULL);
+                c.rc = isinf(c.real) ? ERANGE : 0;
+            }
+            char yaml[128];
+            snprintf(yaml, sizeof(yaml), "v: %s\n", value);
+            HashList* doc_list = test_parse(yaml, NULL);
+            CHECK(doc_list && hashlist_length(doc_list) == 1);
+            if (doc_list == NULL) continue;
+            SimpleYamlNode* node = simple_yaml_find_node(
+                    hashlist_get_at(doc_list, 0), "v");
+            CHECK(node != NULL);
+            if (node) __check_node(&c, node);
+            test_destroy(doc_list);
+        }
+    }
+}
+
+/* Run this test with the classifier selection limited. */
+static int __run_simd(const char* program, const char* simd)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        setenv("SIMPLE_YAML_SIMD", simd, 1);
+        execl(program, program, (char*)NULL);
+        _exit(127);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Quoted scalars are strings, the accessors convert their text. */
+static void test_quoted(void)
+{
+    HashList* doc_list = test_parse(
+            "a: \"8080\"\nb: '12345678901234567890.5'\nc: \"1e400\"\n", NULL);
+    CHECK(doc_list != NULL);
+    if (doc_list == NULL) return;
+    SimpleYamlNode* doc = hashlist_get_at(doc_list, 0);
+    CHECK(simple_yaml_get_scalar_type(simple_yaml_find_node(doc, "a"))
+            == SIMPLE_YAML_SCALAR_STRING);
+    int64_t integer = 0;
+    CHECK(simple_yaml_get_value_as_int64(
+            simple_yaml_find_node(doc, "a"), &integer) == 0 && integer == 8080);
+    double real = 0;
+    CHECK(simple_yaml_get_value_as_double(
+            simple_yaml_find_node(doc, "b"), &real) == 0
+            && real == 12345678901234567890.5);
+    CHECK(simple_yaml_get_value_as_double(
+            simple_yaml_find_node(doc, "c"), &real) == ERANGE);
+    /* The conversion is cached, the scalar remains a string. */
+    SimpleYamlNode* node = simple_yaml_find_node(doc, "a");
+    CHECK(node->scalar.type == SIMPLE_YAML_SCALAR_INT);
+    CHECK(simple_yaml_get_value_as_int64(node, &integer) == 0
+            && integer == 8080);
+    CHECK(simple_yaml_resolve_scalar(node)->type == SIMPLE_YAML_SCALAR_STRING);
+    test_destroy(doc_list);
+
+    /* Resolved while parsing, the accessors do not modify the node. */
+    SimpleYamlOptions options = { .resolve_scalars = true };
+    doc_list = test_parse("a: \"8080\"\nb: 'web'\n", &options);
+    CHECK(doc_list != NULL);
+    if (doc_list == NULL) return;
+    doc = hashlist_get_at(doc_list, 0);
+    node = simple_yaml_find_node(doc, "a");
+    CHECK(node->scalar.type == SIMPLE_YAML_SCALAR_INT
+            && node->scalar.value.integer == 8080);
+    CHECK(simple_yaml_get_scalar_type(node) == SIMPLE_YAML_SCALAR_STRING);
+    node = simple_yaml_find_node(doc, "b");
+    CHECK(node->scalar.type == SIMPLE_YAML_SCALAR_STRING);
+    CHECK(simple_yaml_get_value_as_int64(node, &integer) == EINVAL);
+    test_destroy(doc_list);
+}
+
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    test_scalars(false);
+    test_scalars(true);
+    test_lengths();
+    test_quoted();
+    const char* simd = getenv("SIMPLE_YAML_SIMD");
+    if (simd) {
+        char name[32];
+        snprintf(name, sizeof(name), "scalar (%s)", simd);
+        return test_result(name);
+    }
+    CHECK(__run_simd(argv[0], "sse2") == 0);
+    CHECK(__run_simd(argv[0], "none") == 0);
+    return test_result("scalar");
+}
@@ -0,0 +1,220 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Selective parsing, the documents built for a list of selected paths
+(compared as emitted text). */
+
+#include "test.h"
+
+
+static const char* service_yaml =
+    "kind: Service\n"
+    "metadata: {name: web, labels: {app: web, tier: front}}\n"
+    "spec:\n"
+    "  ports: [{port: 80, name: http}, {port: 443, name: https}]\n"
+    "  selector: {app: web}\n";
+
+static const char* anchor_yaml =
+    "a: &x {b: 1, c: 2}\n"
+    "d: *x\n"
+    "e: {b: *x, f: 4}\n"
+    "g: [*x, {b: 5}]\n";
+
+
+/* Parse yaml selecting paths (NULL terminated), the first document is
+emitted. */
+static char* __select(const char* yaml, const char** paths, bool use_arena)
+{
+    SimpleYamlOptions options = { .select = paths, .use_arena = use_arena };
+    HashList* doc_list = test_parse(yaml, &options);
+    CHECK(doc_list && hashlist_length(doc_list));
+    if (doc_list == NULL || hashlist_length(doc_list) == 0) {
+        test_destroy(doc_list);
+        return NULL;
+    }
+    SimpleYamlBuffer buffer = { 0 };
+    CHECK(simple_yaml_emit_buffer(hashlist_get_at(doc_list, 0), &buffer) == 0);
+    test_destroy(doc_list);
+    return buffer.data;
+}
+
+static void __check_select(const char* yaml, const char** paths,
+        const char* expect)
+{
+    for (int use_arena = 0; use_arena < 2; use_arena++) {
+        char* data = __select(yaml, paths, use_arena);
+        if (data == NULL || strcmp(data, expect)) {
+            fprintf(stderr, "select \"%s\": \"%s\", expected \"%s\"\n",
+                    paths[0], data ? data : "(null)", expect);
+        }
+        CHECK(data && strcmp(data, expect) == 0);
+        free(data);
+    }
+}
+
+static void test_exact(void)
+{
+    __check_select(service_yaml, (const char*[]){ "kind", NULL },
+            "kind: Service\n");
+    __check_select(service_yaml,
+            (const char*[]){ "kind", "metadata/name", NULL },
+            "kind: Service\nmetadata:\n  name: web\n");
+    /* Sequence items by index, the earlier items are kept (empty). */
+    __check_select(service_yaml, (const char*[]){ "spec/ports/1", NULL },
+            "spec:\n  ports:\n    -\n    - port: 443\n      name: https\n");
+    __check_select(service_yaml, (const char*[]){ "spec/ports/1/port", NULL },
+            "spec:\n  ports:\n    -\n    - port: 443\n");
+    /* Nothing matches, the document is empty. */
+    __check_select(service_yaml, (const char*[]){ "missing", NULL }, "{}\n");
+    __check_select(service_yaml, (const char*[]){ "kind/name", NULL },
+            "{}\n");
+
+    /* The selected nodes are found at their paths. */
+    const char* paths[] = { "spec/ports/1/port", NULL };
+    SimpleYamlOptions options = { .select = paths };
+    HashList* doc_list = test_parse(service_yaml, &options);
+    CHECK(doc_list && hashlist_length(doc_list) == 1);
+    if (doc_list && hashlist_length(doc_list)) {
+        SimpleYamlNode* doc = hashlist_get_at(doc_list, 0);
+        SimpleYamlNode* ports = simple_yaml_find_node(doc, "spec/ports");
+        CHECK(ports && hashlist_length(&ports->sequence) == 2);
+        SimpleYamlNode* port = ports ? hashlist_get_at(&ports->sequence, 1)
+                : NULL;
+        int64_t value = 0;
+        CHECK(simple_yaml_get_value_as_int64(
+                simple_yaml_mapping_get(port, "port"), &value) == 0
+                && value == 443);
+        CHECK(ports && ((SimpleYamlNode*)hashlist_get_at(&ports->sequence, 0))
+                ->node_type == YAML_NO_NODE);
+        CHECK(simple_yaml_find_node(doc, "kind") == NULL);
+    }
+    test_destroy(doc_list);
+}
+
+static void test_wildcard(void)
+{
+    __check_select(service_yaml, (const char*[]){ "spec/ports/*/port", NULL },
+            "spec:\n  ports:\n    - port: 80\n    - port: 443\n");
+    /* Collections which may contain a match are left empty. */
+    __check_select(service_yaml, (const char*[]){ "*/name", NULL },
+            "metadata:\n  name: web\nspec: {}\n");
+    __check_select(service_yaml, (const char*[]){ "**/app", NULL },
+            "metadata:\n  labels:\n    app: web\n"
+            "spec:\n  ports:\n    - {}\n    - {}\n  selector:\n    app: web\n");
+    __check_select(service_yaml, (const char*[]){ "spec/**/name", NULL },
+            "spec:\n  ports:\n    - name: http\n    - name: https\n"
+            "  selector: {}\n");
+    __check_select(service_yaml, (const char*[]){ "metadata/**", NULL },
+            "metadata:\n  name: web\n  labels:\n    app: web\n"
+            "    tier: front\n");
+    __check_select("a: 1\nb: [2, {c: 3}]\n", (const char*[]){ "**", NULL },
+            "a: 1\nb:\n  - 2\n  - c: 3\n");
+}
+
+/* A selected node includes its whole subtree, also when a path selects part
+of it. */
+static void test_subtree(void)
+{
+    const char* spec = "spec:\n  ports:\n    - port: 80\n      name: http\n"
+            "    - port: 443\n      name: https\n"
+            "  selector:\n    app: web\n";
+    __check_select(service_yaml, (const char*[]){ "spec", NULL }, spec);
+    __check_select(service_yaml,
+            (const char*[]){ "spec/ports/0/port", "spec", NULL }, spec);
+    __check_select(service_yaml,
+            (const char*[]){ "spec", "spec/ports/*/name", NULL }, spec);
+    __check_select(service_yaml,
+            (const char*[]){ "spec/selector/app", "spec/ports", NULL },
+            "spec:\n  ports:\n    - port: 80\n      name: http\n"
+            "    - port: 443\n      name: https\n"
+            "  selector:\n    app: web\n");
+}
+
+/* Complex keys are skipped (with their value), with or without a
+selection. */
+static void test_complex_keys(void)
+{
+    const char* yaml =
+        "? [k1, k2]\n: {b: 3}\n"
+        "a: {b: 1, ? {k: v} : [x], c: 2}\n"
+        "? {k: v}\n: [x]\n"
+        "c: 3\n";
+    __check_select(yaml, (const char*[]){ "a/c", "c", NULL },
+            "a:\n  c: 2\nc: 3\n");
+    __check_select(yaml, (const char*[]){ "a", NULL }, "a:\n  b: 1\n  c: 2\n");
+    __check_select(yaml, (const char*[]){ "**/b", NULL }, "a:\n  b: 1\n");
+    __check_select(yaml, (const char*[]){ "**", NULL },
+            "a:\n  b: 1\n  c: 2\nc: 3\n");
+}
+
+static void test_aliases(void)
+{
+    /* The anchor is selected. */
+    __check_select(anchor_yaml, (const char*[]){ "a", "d", NULL },
+            "a:\n  b: 1\n  c: 2\nd:\n  b: 1\n  c: 2\n");
+    __check_select(anchor_yaml, (const char*[]){ "a", "e/b", NULL },
+            "a:\n  b: 1\n  c: 2\ne:\n  b:\n    b: 1\n    c: 2\n");
+    /* The anchor is not selected, aliases are skipped (sequence items are
+    kept, empty). */
+    __check_select(anchor_yaml, (const char*[]){ "d", NULL }, "{}\n");
+    __check_select(anchor_yaml, (const char*[]){ "e", NULL }, "e:\n  f: 4\n");
+    __check_select(anchor_yaml, (const char*[]){ "g", NULL },
+            "g:\n  -\n  - b: 5\n");
+    /* The anchor is partly selected, aliases are skipped rather than
+    referencing part of the anchored node. */
+    __check_select(anchor_yaml, (const char*[]){ "*/b", NULL },
+            "a:\n  b: 1\ne: {}\ng:\n  -\n  -\n");
+    __check_select(anchor_yaml, (const char*[]){ "a/b", "d", NULL },
+            "a:\n  b: 1\n");
+    __check_select(anchor_yaml, (const char*[]){ "**", NULL },
+            "a:\n  b: 1\n  c: 2\nd:\n  b: 1\n  c: 2\n"
+            "e:\n  b:\n    b: 1\n    c: 2\n  f: 4\n"
+            "g:\n  - b: 1\n    c: 2\n  - b: 5\n");
+    /* An anchor redefined by a node which is not selected. */
+    const char* yaml = "x: &s 1\ny: &s [2]\nz: [*s]\n";
+    __check_select(yaml, (const char*[]){ "x", "z", NULL },
+            "x: 1\nz:\n  -\n");
+    __check_select(yaml, (const char*[]){ "y", "z", NULL },
+            "y:\n  - 2\nz:\n  - - 2\n");
+    /* Each item is selected, but not the node. */
+    __check_select(yaml, (const char*[]){ "x", "y/0", "z", NULL },
+            "x: 1\ny:\n  - 2\nz:\n  -\n");
+}
+
+/* Each document of a stream is selected. */
+static void test_documents(void)
+{
+    const char* paths[] = { "kind", "spec/*", NULL };
+    SimpleYamlOptions options = { .select = paths };
+    HashList* doc_list = test_parse(
+            "---\nkind: A\nx: 1\n---\nkind: B\nspec: {y: [2], z: 3}\n"
+            "---\n[1, 2]\n---\nscalar\n", &options);
+    CHECK(doc_list && hashlist_length(doc_list) == 4);
+    if (doc_list) {
+        SimpleYamlBuffer buffer = { 0 };
+        CHECK(simple_yaml_emit_documents_buffer(doc_list, &buffer) == 0);
+        const char* expect = "---\nkind: A\n---\nkind: B\nspec:\n  y:\n"
+                "    - 2\n  z: 3\n---\n-\n-\n--- scalar\n";
+        if (buffer.data == NULL || strcmp(buffer.data, expect)) {
+            fprintf(stderr, "select documents: \"%s\"\n",
+                    buffer.data ? buffer.data : "(null)");
+        }
+        CHECK(buffer.data && strcmp(buffer.data, expect) == 0);
+        free(buffer.data);
+    }
+    test_destroy(doc_list);
+}
+
+
+int main(void)
+{
+    test_exact();
+    test_wildcard();
+    test_subtree();
+    test_complex_keys();
+    test_aliases();
+    test_documents();
+    return test_result("select");
+}
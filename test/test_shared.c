@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Shared documents, scalars are resolved before documents are shared, and
+readers see each published snapshot (run with a thread sanitizer to check
+that readers do not modify the documents). */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include "test.h"
+
+
+#define TEST_READERS        4
+#define TEST_PUBLISHES      200
+
+
+static const char* shared_yaml =
+    "---\nport: 80\nname: web\nratio: 0.5\nlist: [1, two, \"3\"]\n"
+    "---\nbase: &b {x: 1}\nm: {<<: *b, y: true}\n";
+
+
+static bool __resolved(SimpleYamlNode* node)
+{
+    switch (node->node_type) {
+        case YAML_MAPPING_NODE:
+            for (uint32_t i = 0; i < simple_yaml_mapping_length(node); i++) {
+                if (!__resolved(simple_yaml_mapping_get_at(node, i)->node)) {
+                    return false;
+                }
+            }
+            return true;
+        case YAML_SEQUENCE_NODE:
+            for (uint32_t i = 0; i < hashlist_length(&node->sequence); i++) {
+                if (!__resolved(hashlist_get_at(&node->sequence, i))) {
+                    return false;
+                }
+            }
+            return true;
+        case YAML_SCALAR_NODE:
+            return node->scalar.type != SIMPLE_YAML_SCALAR_UNRESOLVED;
+        default:
+            return true;
+    }
+}
+
+static bool __all_resolved(HashList* doc_list)
+{
+    for (uint32_t i = 0; i < hashlist_length(doc_list); i++) {
+        SimpleYamlNode* doc = hashlist_get_at(doc_list, i);
+        if (!(doc->flags & SIMPLE_YAML_NODE_RESOLVED)) return false;
+        if (!__resolved(doc)) return false;
+    }
+    return true;
+}
+
+static void test_resolve(void)
+{
+    SimpleYamlOptions options = { .resolve_scalars = true };
+    HashList* resolved = test_parse(shared_yaml, &options);
+    HashList* lazy = test_parse(shared_yaml, NULL);
+    CHECK(resolved && lazy);
+    if (resolved == NULL || lazy == NULL) {
+        test_destroy(resolved);
+        test_destroy(lazy);
+        return;
+    }
+    CHECK(__all_resolved(resolved));
+    CHECK(!(((SimpleYamlNode*)hashlist_get_at(lazy, 0))->flags
+            & SIMPLE_YAML_NODE_RESOLVED));
+
+    SimpleYamlShared* shared = simple_yaml_shared_create(lazy);
+    CHECK(shared != NULL);
+    CHECK(__all_resolved(lazy));
+    lazy = test_parse(shared_yaml, NULL);
+    CHECK(simple_yaml_shared_publish(shared, lazy) == 0);
+    CHECK(__all_resolved(lazy));
+    CHECK(simple_yaml_shared_publish(shared, resolved) == 0);
+    const SimpleYamlSnapshot* s = simple_yaml_shared_acquire(shared);
+    CHECK(s->doc_list == resolved && s->version == 3);
+    simple_yaml_snapshot_release(s);
+    simple_yaml_shared_destroy(shared);
+}
+
+typedef struct Reader {
+    SimpleYamlShared*   shared;
+    uint32_t*           stop;
+    pthread_t           thread;
+    uint64_t            errors;
+} Reader;
+
+static void* __reader(void* data)
+{
+    Reader* r = data;
+    uint64_t version = 0;
+    while (!__atomic_load_n(r->stop, __ATOMIC_RELAXED)) {
+        const SimpleYamlSnapshot* s = simple_yaml_shared_acquire(r->shared);
+        SimpleYamlNode* doc = hashlist_get_at(s->doc_list, 0);
+        int64_t port = 0;
+        double ratio = 0;
+        if (s->version < version
+                || simple_yaml_get_value_as_int64(
+                        simple_yaml_find_node(doc, "port"), &port)
+                || port != 80
+                || simple_yaml_get_value_as_double(
+                        simple_yaml_find_node(doc, "ratio"), &ratio)
+                || ratio != 0.5) {
+            r->errors++;
+        }
+        version = s->version;
+        simple_yaml_snapshot_release(s);
+    }
+    return NULL;
+}
+
+/* Documents parsed without resolve_scalars, published while read. */
+static void test_readers(void)
+{
+    SimpleYamlShared* shared = simple_yaml_shared_create(
+            test_parse(shared_yaml, NULL));
+    CHECK(shared != NULL);
+    if (shared == NULL) return;
+    uint32_t stop = 0;
+    Reader readers[TEST_READERS];
+    for (uint32_t i = 0; i < TEST_READERS; i++) {
+        readers[i] = (Reader){ .shared = shared, .stop = &stop };
+        CHECK(pthread_create(&readers[i].thread, NULL, __reader,
+                &readers[i]) == 0);
+    }
+    for (uint32_t i = 0; i < TEST_PUBLISHES; i++) {
+        HashList* doc_list = test_parse(shared_yaml, NULL);
+        CHECK(doc_list && simple_yaml_shared_publish(shared, doc_list) == 0);
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < TEST_READERS; i++) {
+        pthread_join(readers[i].thread, NULL);
+        CHECK(readers[i].errors == 0);
+    }
+    simple_yaml_shared_destroy(shared);
+}
+
+
+int main(void)
+{
+    test_resolve();
+    test_readers();
+    return test_result("shared");
+}
@@ -0,0 +1,196 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Frozen tapes, lookups on a copy of a tape, and validation of corrupt
+tapes (which must be rejected, or otherwise be safe to read). */
+
+#include <errno.h>
+#include "test.h"
+
+
+#define TEST_VISIT_BUDGET   10000
+
+
+static const char* tape_yaml =
+    "---\n"
+    "kind: Service\n"
+    "metadata: {name: web, labels: &labels {app: web, tier: front}}\n"
+    "spec:\n"
+    "  ports: [{port: 80, protocol: TCP}, {port: 443, protocol: TCP}]\n"
+    "  selector: *labels\n"
+    "  merged: {<<: *labels, tier: back}\n"
+    "  ratio: 0.5\n"
+    "  enabled: true\n"
+    "---\n"
+    "k1: 1\nk2: 2\nk3: 3\nk4: 4\nk5: 5\nk6: 6\nk7: 7\nk8: 8\nk9: 9\n"
+    "k10: 10\nk11: 11\nk12: \"12\"\n";
+
+
+/* A copy of the tape, at an aligned address. */
+static void* __copy(const SimpleYamlTape* tape, size_t* size)
+{
+    *size = simple_yaml_tape_size(tape);
+    void* data = malloc(*size);
+    if (data) memcpy(data, tape, *size);
+    return data;
+}
+
+/* Read every node (with a budget, a corrupt tape may share nodes), including
+merged lookups of a missing key. */
+static void __visit(const SimpleYamlTape* tape, SimpleYamlTapeRef ref,
+        uint32_t* budget)
+{
+    if (*budget == 0) return;
+    (*budget)--;
+    size_t length;
+    switch (simple_yaml_tape_node_type(tape, ref)) {
+        case YAML_MAPPING_NODE:
+            simple_yaml_tape_mapping_get(tape, ref, "missing");
+            /* Fall through. */
+        case YAML_SEQUENCE_NODE:
+            for (uint32_t i = 0; i < simple_yaml_tape_length(tape, ref); i++) {
+                const char* key = NULL;
+                SimpleYamlTapeRef child = simple_yaml_tape_get_at(
+                        tape, ref, i, &key);
+                if (key) simple_yaml_tape_mapping_get(tape, ref, key);
+                __visit(tape, child, budget);
+            }
+            break;
+        case YAML_SCALAR_NODE:
+            simple_yaml_tape_value(tape, ref, &length);
+            simple_yaml_tape_scalar_type(tape, ref);
+            break;
+        default:
+            break;
+    }
+}
+
+static void __visit_all(const SimpleYamlTape* tape)
+{
+    uint32_t budget = TEST_VISIT_BUDGET;
+    for (uint32_t i = 0; i < simple_yaml_tape_document_count(tape); i++) {
+        __visit(tape, simple_yaml_tape_document(tape, i), &budget);
+    }
+}
+
+static void test_lookup(const SimpleYamlTape* frozen)
+{
+    size_t size;
+    void* data = __copy(frozen, &size);
+    CHECK(data != NULL);
+    if (data == NULL) return;
+    const SimpleYamlTape* tape = simple_yaml_tape_open(data, size);
+    CHECK(tape != NULL);
+    if (tape) {
+        CHECK(simple_yaml_tape_document_count(tape) == 2);
+        SimpleYamlTapeRef doc = simple_yaml_tape_document(tape, 0);
+        int64_t port = 0;
+        CHECK(simple_yaml_tape_get_int64(tape,
+                simple_yaml_tape_find(tape, doc, "spec/ports/1/port"),
+                &port) == 0 && port == 443);
+        size_t length = 0;
+        const char* value = simple_yaml_tape_value(tape,
+                simple_yaml_tape_find(tape, doc, "spec/selector/app"), &length);
+        CHECK(value && length == 3 && memcmp(value, "web", 3) == 0);
+        value = simple_yaml_tape_value(tape,
+                simple_yaml_tape_find(tape, doc, "spec/merged/app"), &length);
+        CHECK(value && strcmp(value, "web") == 0);
+        value = simple_yaml_tape_value(tape,
+                simple_yaml_tape_find(tape, doc, "spec/merged/tier"), &length);
+        CHECK(value && strcmp(value, "back") == 0);
+        doc = simple_yaml_tape_document(tape, 1);
+        CHECK(simple_yaml_tape_get_int64(tape,
+                simple_yaml_tape_find(tape, doc, "k11"), &port) == 0
+                && port == 11);
+        CHECK(simple_yaml_tape_scalar_type(tape,
+                simple_yaml_tape_find(tape, doc, "k12"))
+                == SIMPLE_YAML_SCALAR_STRING);
+        CHECK(simple_yaml_tape_find(tape, doc, "k13") == SIMPLE_YAML_TAPE_NONE);
+    }
+    free(data);
+}
+
+static void test_reject(const SimpleYamlTape* frozen)
+{
+    size_t size;
+    uint8_t* data = __copy(frozen, &size);
+    CHECK(data != NULL);
+    if (data == NULL) return;
+    CHECK(simple_yaml_tape_validate(data, size) == 0);
+    CHECK(simple_yaml_tape_validate(NULL, size) == EINVAL);
+    CHECK(simple_yaml_tape_validate(data, 0) == EINVAL);
+    /* Truncated, or with trailing data. */
+    CHECK(simple_yaml_tape_validate(data, size - 8) == EINVAL);
+    CHECK(simple_yaml_tape_validate(data, 16) == EINVAL);
+    uint8_t* longer = calloc(1, size + 8);
+    if (longer) {
+        memcpy(longer, data, size);
+        CHECK(simple_yaml_tape_validate(longer, size + 8) == EINVAL);
+        free(longer);
+    }
+    /* Not aligned. */
+    uint8_t* moved = malloc(size + 4);
+    if (moved) {
+        memcpy(moved + 4, data, size);
+        CHECK(simple_yaml_tape_validate(moved + 4, size) == EINVAL);
+        CHECK(simple_yaml_tape_open(moved + 4, size) == NULL);
+        CHECK(errno == EINVAL);
+        free(moved);
+    }
+    /* Magic and version. */
+    for (size_t i = 0; i < 8; i++) {
+        data[i] ^= 0x40;
+        CHECK(simple_yaml_tape_validate(data, size) == EINVAL);
+        data[i] ^= 0x40;
+    }
+    CHECK(simple_yaml_tape_validate(data, size) == 0);
+    free(data);
+}
+
+/* Every byte changed (to several values), the tape is either rejected or
+can be read, in bounds (run with a sanitizer to check). */
+static void test_corrupt(const SimpleYamlTape* frozen)
+{
+    static const uint8_t masks[] = { 0x01, 0x08, 0x80, 0xff };
+    size_t size;
+    uint8_t* data = __copy(frozen, &size);
+    CHECK(data != NULL);
+    if (data == NULL) return;
+    uint32_t valid = 0, rejected = 0;
+    for (size_t i = 0; i < size; i++) {
+        for (size_t m = 0; m < sizeof(masks); m++) {
+            data[i] ^= masks[m];
+            const SimpleYamlTape* tape = simple_yaml_tape_open(data, size);
+            if (tape) {
+                __visit_all(tape);
+                valid++;
+            } else {
+                rejected++;
+            }
+            data[i] ^= masks[m];
+        }
+    }
+    /* Most changes are to the strings and values (still valid). */
+    CHECK(rejected > 0 && valid > 0);
+    CHECK(simple_yaml_tape_validate(data, size) == 0);
+    free(data);
+}
+
+
+int main(void)
+{
+    HashList* doc_list = test_parse(tape_yaml, NULL);
+    CHECK(doc_list && hashlist_length(doc_list) == 2);
+    SimpleYamlTape* tape = doc_list ? simple_yaml_freeze(doc_list) : NULL;
+    test_destroy(doc_list);
+    CHECK(tape != NULL);
+    if (tape) {
+        test_lookup(tape);
+        test_reject(tape);
+        test_corrupt(tape);
+    }
+    simple_yaml_tape_destroy(tape);
+    return test_result("tape");
+}
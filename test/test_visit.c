@@ -0,0 +1,245 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Streaming (visitor) interface, the events of a stream are compared as a
+trace (one line each), with the callback skipping or stopping at a path. */
+
+#include "test.h"
+
+
+static const char* event_names[] = {
+    "DS", "DE", "KEY", "SCALAR", "ALIAS", "MS", "ME", "SS", "SE",
+};
+
+typedef struct Trace {
+    char                text[16384];
+    size_t              length;
+    /* Return action at the event type with path (NULL for any path). */
+    const char*         path;
+    SimpleYamlEventType type;
+    int                 action;
+} Trace;
+
+/* Each event as "type depth path key|#index [value]". */
+static int __trace(const SimpleYamlEvent* event, void* data)
+{
+    Trace* t = data;
+    CHECK(strlen(event->path) == event->path_length);
+    char node[64];
+    if (event->key) {
+        snprintf(node, sizeof(node), "%s", event->key);
+        /* The key is the last segment of the path. */
+        size_t length = strlen(event->key);
+        CHECK(event->path_length >= length && strcmp(event->path
+                + event->path_length - length, event->key) == 0);
+    } else {
+        snprintf(node, sizeof(node), "#%u", event->index);
+    }
+    t->length += snprintf(t->text + t->length, sizeof(t->text) - t->length,
+            "%s %u %s %s%s%.*s\n", event_names[event->type], event->depth,
+            event->path, node, event->value ? " " : "",
+            (int)event->length, event->value ? event->value : "");
+    if (t->length >= sizeof(t->text)) t->length = sizeof(t->text) - 1;
+    if (event->type == t->type && t->path
+            && strcmp(event->path, t->path) == 0) return t->action;
+    return SIMPLE_YAML_VISIT_CONTINUE;
+}
+
+static void __check_trace(const char* yaml, Trace* t, const char* expect)
+{
+    t->length = 0;
+    t->text[0] = '\0';
+    CHECK(simple_yaml_visit_buffer(yaml, strlen(yaml), __trace, t) == 0);
+    if (strcmp(t->text, expect)) {
+        fprintf(stderr, "visit \"%s\":\n%s\nexpected:\n%s\n",
+                yaml, t->text, expect);
+    }
+    CHECK(strcmp(t->text, expect) == 0);
+}
+
+static void test_paths(void)
+{
+    Trace t = { .path = NULL };
+    __check_trace("a: 1\nb: {c: [x, {d: y}]}\ne: *z\n", &t,
+            "DS 0  #0\n"
+            "MS 0  #0\n"
+            "KEY 1 a a\n"
+            "SCALAR 1 a a 1\n"
+            "KEY 1 b b\n"
+            "MS 1 b b\n"
+            "KEY 2 b/c c\n"
+            "SS 2 b/c c\n"
+            "SCALAR 3 b/c/0 #0 x\n"
+            "MS 3 b/c/1 #1\n"
+            "KEY 4 b/c/1/d d\n"
+            "SCALAR 4 b/c/1/d d y\n"
+            "ME 3 b/c/1 #1\n"
+            "SE 2 b/c c\n"
+            "ME 1 b b\n"
+            "KEY 1 e e\n"
+            "ALIAS 1 e e z\n"
+            "ME 0  #0\n"
+            "DE 0  #0\n");
+}
+
+/* Sequence indexes, at depth and after a nested sequence. */
+static void test_index(void)
+{
+    Trace t = { .path = NULL };
+    __check_trace("- [a, b]\n- c\n- {k: [d]}\n", &t,
+            "DS 0  #0\n"
+            "SS 0  #0\n"
+            "SS 1 0 #0\n"
+            "SCALAR 2 0/0 #0 a\n"
+            "SCALAR 2 0/1 #1 b\n"
+            "SE 1 0 #0\n"
+            "SCALAR 1 1 #1 c\n"
+            "MS 1 2 #2\n"
+            "KEY 2 2/k k\n"
+            "SS 2 2/k k\n"
+            "SCALAR 3 2/k/0 #0 d\n"
+            "SE 2 2/k k\n"
+            "ME 1 2 #2\n"
+            "SE 0  #0\n"
+            "DE 0  #0\n");
+}
+
+/* A long path grows the path buffer. */
+static void test_depth(void)
+{
+    char yaml[2048] = "";
+    char path[1024] = "";
+    size_t n = 0, k = 0;
+    for (int i = 0; i < 20; i++) {
+        n += sprintf(yaml + n, "%*skey_of_some_length_%d:\n", i, "", i);
+        k += sprintf(path + k, "%skey_of_some_length_%d", i ? "/" : "", i);
+    }
+    sprintf(yaml + n, "%*s- v\n", 20, "");
+    sprintf(path + k, "/0");
+    Trace t = { .path = NULL };
+    CHECK(simple_yaml_visit_buffer(yaml, strlen(yaml), __trace, &t) == 0);
+    char expect[1100];
+    snprintf(expect, sizeof(expect), "SCALAR 21 %s #0 v\n", path);
+    CHECK(strstr(t.text, expect) != NULL);
+}
+
+static void test_skip(void)
+{
+    const char* yaml = "a: {b: 1}\nc: [2, 3]\nd: 4\n";
+    /* The value of a key. */
+    Trace t = { .path = "a", .type = SIMPLE_YAML_EVENT_KEY,
+            .action = SIMPLE_YAML_VISIT_SKIP };
+    __check_trace(yaml, &t,
+            "DS 0  #0\n"
+            "MS 0  #0\n"
+            "KEY 1 a a\n"
+            "KEY 1 c c\n"
+            "SS 1 c c\n"
+            "SCALAR 2 c/0 #0 2\n"
+            "SCALAR 2 c/1 #1 3\n"
+            "SE 1 c c\n"
+            "KEY 1 d d\n"
+            "SCALAR 1 d d 4\n"
+            "ME 0  #0\n"
+            "DE 0  #0\n");
+    /* A collection. */
+    t = (Trace){ .path = "c", .type = SIMPLE_YAML_EVENT_SEQUENCE_START,
+            .action = SIMPLE_YAML_VISIT_SKIP };
+    __check_trace(yaml, &t,
+            "DS 0  #0\n"
+            "MS 0  #0\n"
+            "KEY 1 a a\n"
+            "MS 1 a a\n"
+            "KEY 2 a/b b\n"
+            "SCALAR 2 a/b b 1\n"
+            "ME 1 a a\n"
+            "KEY 1 c c\n"
+            "SS 1 c c\n"
+            "KEY 1 d d\n"
+            "SCALAR 1 d d 4\n"
+            "ME 0  #0\n"
+            "DE 0  #0\n");
+    /* A document, the next document is visited. */
+    t = (Trace){ .path = "", .type = SIMPLE_YAML_EVENT_DOCUMENT_START,
+            .action = SIMPLE_YAML_VISIT_SKIP };
+    __check_trace("--- {a: 1}\n--- b\n", &t,
+            "DS 0  #0\n"
+            "DS 0  #0\n");
+}
+
+static void test_stop(void)
+{
+    const char* yaml = "a: {b: 1}\nc: [2, 3]\n---\nd: 4\n";
+    Trace t = { .path = "c/0", .type = SIMPLE_YAML_EVENT_SCALAR,
+            .action = SIMPLE_YAML_VISIT_STOP };
+    __check_trace(yaml, &t,
+            "DS 0  #0\n"
+            "MS 0  #0\n"
+            "KEY 1 a a\n"
+            "MS 1 a a\n"
+            "KEY 2 a/b b\n"
+            "SCALAR 2 a/b b 1\n"
+            "ME 1 a a\n"
+            "KEY 1 c c\n"
+            "SS 1 c c\n"
+            "SCALAR 2 c/0 #0 2\n");
+    t = (Trace){ .path = "", .type = SIMPLE_YAML_EVENT_DOCUMENT_END,
+            .action = SIMPLE_YAML_VISIT_STOP };
+    __check_trace("--- a\n--- b\n", &t,
+            "DS 0  #0\n"
+            "SCALAR 0  #0 a\n"
+            "DE 0  #0\n");
+}
+
+/* Complex keys are skipped with their value, the following keys are
+visited. */
+static void test_complex_keys(void)
+{
+    Trace t = { .path = NULL };
+    __check_trace("? [k1, k2]\n: {b: 3}\na: {? {k: v} : [x], c: 2}\n", &t,
+            "DS 0  #0\n"
+            "MS 0  #0\n"
+            "KEY 1 a a\n"
+            "MS 1 a a\n"
+            "KEY 2 a/c c\n"
+            "SCALAR 2 a/c c 2\n"
+            "ME 1 a a\n"
+            "ME 0  #0\n"
+            "DE 0  #0\n");
+}
+
+static int __document(const SimpleYamlEvent* event, void* data)
+{
+    if (event->type == SIMPLE_YAML_EVENT_SCALAR) {
+        uint32_t* documents = data;
+        documents[event->document]++;
+    }
+    return SIMPLE_YAML_VISIT_CONTINUE;
+}
+
+static void test_documents(void)
+{
+    uint32_t documents[3] = { 0 };
+    const char* yaml = "--- [a, b]\n--- c\n--- {d: e}\n";
+    CHECK(simple_yaml_visit_buffer(yaml, strlen(yaml), __document,
+            documents) == 0);
+    CHECK(documents[0] == 2 && documents[1] == 1 && documents[2] == 1);
+    /* A parse error. */
+    Trace t = { .path = NULL };
+    CHECK(simple_yaml_visit_buffer("a: [1\n", 6, __trace, &t) != 0);
+}
+
+
+int main(void)
+{
+    test_paths();
+    test_index();
+    test_depth();
+    test_skip();
+    test_stop();
+    test_complex_keys();
+    test_documents();
+    return test_result("visit");
+}
@@ -0,0 +1,164 @@
+/*
+Copyright (c) 2021 Timothy Rule
+MIT License
+*/
+
+/* Zero-copy parsing, scalars which appear unchanged in the buffer are views
+at their position in the buffer (after multibyte characters, which libyaml
+marks count as one), other scalars are copied. */
+
+#include "test.h"
+
+
+typedef struct ViewCheck {
+    const char*     path;
+    const char*     value;
+    /* The text before the value in the buffer (its first occurrence), or
+    NULL when the value is copied. */
+    const char*     before;
+} ViewCheck;
+
+
+static const char* multibyte_yaml =
+    "ключ: значение\n"
+    "日本語: \"語 x\"\n"
+    "emoji😀: '😀 y'\n"
+    "é: [α, β, \"γ\"]\n"
+    "after: plain\n"
+    "last: \"quoted\"\n";
+
+static const ViewCheck multibyte_checks[] = {
+    { "ключ", "значение", "ключ: " },
+    { "日本語", "語 x", "日本語: \"" },
+    { "emoji😀", "😀 y", "emoji😀: '" },
+    { "é/0", "α", "é: [" },
+    { "é/1", "β", "α, " },
+    { "é/2", "γ", "β, \"" },
+    { "after", "plain", "after: " },
+    { "last", "quoted", "last: \"" },
+};
+
+static const char* copy_yaml =
+    "single: 'it''s'\n"
+    "double: \"a\\tb\"\n"
+    "escaped: \"\\u00e9t\\u00e9\"\n"
+    "folded: >\n  one\n  two\n"
+    "literal: |\n  line\n"
+    "plain: multi\n  line\n"
+    "ü: 'view'\n"
+    "both: \"x\\\"y\"\n"
+    "end: \"z\"\n";
+
+static const ViewCheck copy_checks[] = {
+    { "single", "it's", NULL },
+    { "double", "a\tb", NULL },
+    { "escaped", "\xc3\xa9t\xc3\xa9", NULL },
+    { "folded", "one two\n", NULL },
+    { "literal", "line\n", NULL },
+    { "plain", "multi line", NULL },
+    { "ü", "view", "ü: '" },
+    { "both", "x\"y", NULL },
+    { "end", "z", "end: \"" },
+};
+
+
+static void __check_views(SimpleYamlNode* doc, const char* buffer,
+        const ViewCheck* checks, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const ViewCheck* c = &checks[i];
+        SimpleYamlNode* node = simple_yaml_find_node(doc, c->path);
+        CHECK(node && node->node_type == YAML_SCALAR_NODE);
+        if (node == NULL) continue;
+        size_t length = strlen(c->value);
+        bool view = (node->flags & SIMPLE_YAML_NODE_VALUE_VIEW);
+        if (node->value_length != length
+                || memcmp(node->value, c->value, length)) {
+            fprintf(stderr, "zero copy %s: \"%.*s\", expected \"%s\"\n",
+                    c->path, (int)node->value_length, node->value, c->value);
+        }
+        CHECK(node->value_length == length
+                && memcmp(node->value, c->value, length) == 0);
+        if (c->before) {
+            const char* at = strstr(buffer, c->before);
+            CHECK(at && view && node->value == at + strlen(c->before));
+        } else {
+            CHECK(!view);
+            CHECK(node->value[length] == '\0');
+        }
+    }
+}
+
+static void __check_buffer(const char* yaml, const ViewCheck* checks,
+        size_t count)
+{
+    for (int use_arena = 0; use_arena < 2; use_arena++) {
+        SimpleYamlOptions options = { .zero_copy = true,
+                .use_arena = use_arena };
+        HashList* doc_list = simple_yaml_parse_buffer(
+                yaml, strlen(yaml), NULL, &options);
+        CHECK(doc_list && hashlist_length(doc_list) == 1);
+        if (doc_list && hashlist_length(doc_list)) {
+            __check_views(hashlist_get_at(doc_list, 0), yaml, checks, count);
+        }
+        test_destroy(doc_list);
+    }
+}
+
+static void test_multibyte(void)
+{
+    __check_buffer(multibyte_yaml, multibyte_checks,
+            sizeof(multibyte_checks) / sizeof(multibyte_checks[0]));
+}
+
+static void test_copied(void)
+{
+    __check_buffer(copy_yaml, copy_checks,
+            sizeof(copy_checks) / sizeof(copy_checks[0]));
+}
+
+/* Line breaks (CRLF) and a byte order mark. */
+static void test_line_breaks(void)
+{
+    static const ViewCheck checks[] = {
+        { "a", "1", "a: " },
+        { "b", "x y", "b: \"" },
+        { "ä", "z", "ä: " },
+    };
+    __check_buffer("a: 1\r\nb: \"x y\"\r\n\r\nä: z\r\n", checks, 3);
+    __check_buffer("\xef\xbb\xbf" "a: 1\nb: \"x y\"\nä: z\n", checks, 3);
+}
+
+/* The position in the buffer is kept across the documents of a stream, and
+with the document iterator. */
+static void test_documents(void)
+{
+    static const ViewCheck first[] = { { "k", "ö1", "k: " } };
+    static const ViewCheck second[] = { { "k", "ö2", "k: \"" } };
+    static const ViewCheck third[] = { { "k/0", "ö3", "[" } };
+    const char* yaml = "---\nk: ö1\n---\nk: \"ö2\"\n---\nk: [ö3]\n";
+    SimpleYamlOptions options = { .zero_copy = true };
+    SimpleYamlStream* stream = simple_yaml_stream_open_buffer(
+            yaml, strlen(yaml), &options);
+    CHECK(stream != NULL);
+    if (stream == NULL) return;
+    const ViewCheck* checks[] = { first, second, third };
+    for (uint32_t i = 0; i < 3; i++) {
+        SimpleYamlNode* doc = simple_yaml_stream_next_document(stream);
+        CHECK(doc != NULL);
+        if (doc) __check_views(doc, yaml, checks[i], 1);
+        simple_yaml_destroy_node(doc);
+    }
+    CHECK(simple_yaml_stream_next_document(stream) == NULL);
+    simple_yaml_stream_close(stream);
+}
+
+
+int main(void)
+{
+    test_multibyte();
+    test_copied();
+    test_line_breaks();
+    test_documents();
+    return test_result("zero_copy");
+}